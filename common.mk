@@ -1,6 +1,5 @@
 # compiler, tools
 CC = $(shell type -P clang || echo gcc)
-PKG_CONFIG ?= pkg-config
 
 # flags
 CFLAGS ?= -march=native -O2 -pipe
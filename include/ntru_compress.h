@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_compress.h
+ * This file holds the public API of the message compression
+ * of the pqc NTRU implementation and is meant to be installed
+ * on the client system.
+ * @brief public API, message compression
+ */
+
+#ifndef PUBLIC_NTRU_COMPRESS_H_
+#define PUBLIC_NTRU_COMPRESS_H_
+
+
+#include <ntru.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Registers a preshared dictionary, which makes small messages
+ * that share a lot with it, e.g. records of the same format,
+ * compress much better. It is loaded once and then referenced
+ * by its id in the dict_id of an ntru_compress_policy, the
+ * ciphertext only carries the id. The receiver has to register
+ * the same dictionary under the same id before decrypting.
+ * Dictionaries stay registered until the process exits.
+ *
+ * @param id the id of the dictionary, not 0
+ * @param dict the dictionary, only its last 64 KiB are used
+ * @param len the size of dict
+ * @return true for success, false if the id is 0 or already
+ * registered with different content
+ */
+bool
+ntru_compress_dict_add(uint32_t id, const void *dict, size_t len);
+
+/**
+ * Sets the compression policy of the whole process, which is
+ * used by ntru_encrypt_string() and whenever no policy is
+ * passed to ntru_encrypt_string_compressed().
+ *
+ * @param policy the new policy, NULL to reset it to
+ * NTRU_COMPRESS_FAST with acceleration 1
+ * @return true for success, false if its dictionary is
+ * not registered
+ */
+bool
+ntru_set_compress_policy(const ntru_compress_policy *policy);
+
+
+#endif /* PUBLIC_NTRU_COMPRESS_H_ */
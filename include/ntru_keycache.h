@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keycache.h
+ * This file holds the public API of the cache of
+ * imported keys of the pqc NTRU implementation and is
+ * meant to be installed on the client system.
+ * @brief public API, cache of imported keys
+ */
+
+#ifndef PUBLIC_NTRU_KEYCACHE_H_
+#define PUBLIC_NTRU_KEYCACHE_H_
+
+
+#include <ntru.h>
+
+#include <fmpz_poly.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+typedef struct ntru_key_cache ntru_key_cache;
+
+
+/**
+ * Creates a thread-safe cache of imported keys, keyed by
+ * the path of the key file and the parameter set.
+ *
+ * @param max_bytes the approximate maximum memory footprint
+ * of all cached keys, the least recently used ones are evicted
+ * @return the newly allocated cache
+ */
+ntru_key_cache *
+ntru_key_cache_new(size_t max_bytes);
+
+/**
+ * Get a public key, from the cache if the file did not change
+ * since it was cached (same inode, size and mtime), otherwise it is
+ * imported and added to the cache. Both the binary key format and
+ * the base64 one are understood.
+ *
+ * @param cache the cache
+ * @param pub where to save the public key, must be initialized [out]
+ * @param filename the file to get the public key from
+ * @param params the NTRU context
+ * @return true for success, false if the key could not be imported
+ */
+bool
+ntru_key_cache_get_public_key(ntru_key_cache *cache,
+		fmpz_poly_t pub,
+		char const * const filename,
+		const ntru_params *params);
+
+/**
+ * Get a private key together with its inverse, from the cache
+ * if the file did not change since it was cached (same inode,
+ * size and mtime), otherwise it is imported and added to the
+ * cache. Both the binary key format and the base64 one are
+ * understood, so a cache hit saves the inversion for the latter.
+ *
+ * @param cache the cache
+ * @param priv where to save the private key, must be initialized [out]
+ * @param priv_inv where to save the inverse of the private key,
+ * must be initialized [out]
+ * @param filename the file to get the private key from
+ * @param params the NTRU context
+ * @return true for success, false if the key could not be imported
+ */
+bool
+ntru_key_cache_get_priv_key(ntru_key_cache *cache,
+		fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		char const * const filename,
+		const ntru_params *params);
+
+/**
+ * Get a snapshot of the counters of the cache. Lookups of
+ * entries whose file changed count as misses.
+ *
+ * @param cache the cache
+ * @param stats where to store the counters, cost is in bytes [out]
+ */
+void
+ntru_key_cache_get_stats(ntru_key_cache *cache,
+		ntru_cache_stats *stats);
+
+/**
+ * Frees the cache and all keys in it.
+ *
+ * @param cache the cache to free
+ */
+void
+ntru_key_cache_delete(ntru_key_cache *cache);
+
+
+#endif /* PUBLIC_NTRU_KEYCACHE_H_ */
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyfile.h
+ * This file holds the public API of the binary,
+ * memory-mappable key file format of the pqc NTRU
+ * implementation and is meant to be installed on the
+ * client system.
+ * @brief public API, binary key files
+ */
+
+#ifndef PUBLIC_NTRU_KEYFILE_H_
+#define PUBLIC_NTRU_KEYFILE_H_
+
+
+#include <ntru.h>
+#include <ntru_keypair.h>
+
+#include <fmpz_poly.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Current version of the binary key file format.
+ */
+#define NTRU_KEYFILE_VERSION 1
+
+/**
+ * Alignment of the header and of every coefficient
+ * array inside a binary key file, one cache line.
+ */
+#define NTRU_KEYFILE_ALIGN 64
+
+
+typedef struct ntru_key_view ntru_key_view;
+
+
+/**
+ * The kind of key stored in a binary key file.
+ */
+typedef enum ntru_key_type {
+	/**
+	 * Only the public key h.
+	 */
+	NTRU_KEY_PUBLIC = 1,
+	/**
+	 * The private key f together with the
+	 * precomputed inverse Fp and the public key h.
+	 */
+	NTRU_KEY_PRIVATE = 2,
+} ntru_key_type;
+
+/**
+ * A read-only view of a memory-mapped binary key file.
+ * The coefficient arrays point directly into the mapping,
+ * they hold N little endian int16_t values each and
+ * are NTRU_KEYFILE_ALIGN aligned.
+ */
+struct ntru_key_view {
+	/**
+	 * The parameter set the key was created for.
+	 */
+	ntru_params params;
+	/**
+	 * Whether this is a public or private key file.
+	 */
+	ntru_key_type type;
+	/**
+	 * Coefficients of the public key h.
+	 */
+	const int16_t *pub;
+	/**
+	 * Coefficients of the private key f,
+	 * NULL for public key files.
+	 */
+	const int16_t *priv;
+	/**
+	 * Coefficients of the inverse Fp of f,
+	 * NULL for public key files.
+	 */
+	const int16_t *priv_inv;
+	/**
+	 * Start of the mapping.
+	 */
+	void *map;
+	/**
+	 * Length of the mapping.
+	 */
+	size_t map_len;
+};
+
+
+/**
+ * Export the public key to a binary key file.
+ *
+ * @param filename the file to save the public key into
+ * @param pub the public key
+ * @param params the NTRU context
+ * @return true for success, false if any of the file operations
+ * failed or a coefficient does not fit into 16 bits
+ */
+bool
+export_public_key_bin(char const * const filename,
+		const fmpz_poly_t pub,
+		const ntru_params *params);
+
+/**
+ * Export the private key to a binary key file. Besides f
+ * this stores the inverse Fp and the public key, so importing
+ * does neither need to decode nor to invert anything.
+ *
+ * @param filename the file to save the private key into
+ * @param pair the keypair
+ * @param params the NTRU context
+ * @return true for success, false if any of the file operations
+ * failed or a coefficient does not fit into 16 bits
+ */
+bool
+export_priv_key_bin(char const * const filename,
+		const keypair *pair,
+		const ntru_params *params);
+
+/**
+ * Import a public key from a binary key file. Both public
+ * and private key files are accepted.
+ *
+ * @param pub where to save the public key, must be initialized [out]
+ * @param filename the file to get the public key from
+ * @param params the NTRU context, must match the one of the file
+ * @return true for success, false if the file could not be
+ * mapped, is malformed or was created for other parameters
+ */
+bool
+import_public_key_bin(fmpz_poly_t pub,
+		char const * const filename,
+		const ntru_params *params);
+
+/**
+ * Import a private key from a binary key file.
+ *
+ * @param priv where to save the private key, must be initialized [out]
+ * @param priv_inv where to save the inverse of the private key,
+ * must be initialized [out]
+ * @param filename the file to get the private key from
+ * @param params the NTRU context, must match the one of the file
+ * @return true for success, false if the file could not be
+ * mapped, is malformed, is no private key file or was created
+ * for other parameters
+ */
+bool
+import_priv_key_bin(fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		char const * const filename,
+		const ntru_params *params);
+
+/**
+ * Checks whether a file is a valid binary key file, as
+ * opposed to e.g. a base64 one.
+ *
+ * @param filename the file to check
+ * @return true if it is a binary key file, false otherwise
+ */
+bool
+ntru_key_file_is_bin(char const * const filename);
+
+/**
+ * Maps a binary key file read-only into memory and validates
+ * it. Nothing is decoded, the coefficients are only paged in
+ * when they are accessed.
+ *
+ * @param view the view to set up [out]
+ * @param filename the binary key file
+ * @return true for success, false if the file could not be
+ * mapped or is malformed
+ */
+bool
+ntru_key_view_open(ntru_key_view *view,
+		char const * const filename);
+
+/**
+ * Copies one coefficient array of a view into a polynomial.
+ *
+ * @param poly the polynomial, must be initialized [out]
+ * @param coeffs one of the coefficient arrays of the view
+ * @param view the view the array belongs to
+ */
+void
+ntru_key_view_get_poly(fmpz_poly_t poly,
+		const int16_t *coeffs,
+		const ntru_key_view *view);
+
+/**
+ * Unmaps a binary key file. The coefficient arrays of the
+ * view must not be used afterwards.
+ *
+ * @param view the view to close
+ */
+void
+ntru_key_view_close(ntru_key_view *view);
+
+
+#endif /* PUBLIC_NTRU_KEYFILE_H_ */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyring.h
+ * This file holds the public API of keyrings, files
+ * holding many indexed public keys, of the pqc NTRU
+ * implementation and is meant to be installed on the
+ * client system.
+ * @brief public API, keyrings
+ */
+
+#ifndef PUBLIC_NTRU_KEYRING_H_
+#define PUBLIC_NTRU_KEYRING_H_
+
+
+#include <ntru.h>
+
+#include <fmpz_poly.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Current version of the keyring file format.
+ */
+#define NTRU_KEYRING_VERSION 1
+
+
+typedef struct ntru_keyring ntru_keyring;
+
+
+/**
+ * Computes the fingerprint of a public key, which is
+ * used to look it up in a keyring. This is a 64 bit
+ * FNV-1a hash over the parameters and the coefficients,
+ * it is fast but not collision resistant.
+ *
+ * @param pub the public key
+ * @param params the NTRU context
+ * @return the fingerprint
+ */
+uint64_t
+ntru_key_fingerprint(const fmpz_poly_t pub,
+		const ntru_params *params);
+
+/**
+ * Creates an empty keyring file for public keys of
+ * one parameter set. An existing file is overwritten.
+ *
+ * @param filename the keyring file
+ * @param params the NTRU context of all keys in the keyring
+ * @return true for success, false if any of the file operations failed
+ */
+bool
+ntru_keyring_create(char const * const filename,
+		const ntru_params *params);
+
+/**
+ * Opens a keyring file by mapping it read-only into memory.
+ * Nothing is parsed, lookups work directly on the mapping.
+ * A keyring is not thread-safe.
+ *
+ * @param filename the keyring file
+ * @return the newly allocated keyring, or NULL if the file
+ * could not be mapped or is malformed
+ */
+ntru_keyring *
+ntru_keyring_open(char const * const filename);
+
+/**
+ * Get the parameter set of the keys in a keyring.
+ *
+ * @param ring the keyring
+ * @param params where to store the parameters [out]
+ */
+void
+ntru_keyring_get_params(const ntru_keyring *ring,
+		ntru_params *params);
+
+/**
+ * Get the number of keys in a keyring.
+ *
+ * @param ring the keyring
+ * @return the number of keys
+ */
+size_t
+ntru_keyring_count(const ntru_keyring *ring);
+
+/**
+ * Appends a public key to the keyring file. The key goes
+ * into the unindexed tail, which is searched linearly until
+ * the next ntru_keyring_compact(). Keys that are already in
+ * the keyring are not added twice. A partial record left
+ * behind by an interrupted append is cut off first.
+ *
+ * @param ring the keyring
+ * @param pub the public key
+ * @param fingerprint where to store the fingerprint of the
+ * key, can be NULL [out]
+ * @return true for success, false if any of the file operations
+ * failed, a coefficient does not fit into 16 bits or a different
+ * key with the same fingerprint is in the keyring
+ */
+bool
+ntru_keyring_add(ntru_keyring *ring,
+		const fmpz_poly_t pub,
+		uint64_t *fingerprint);
+
+/**
+ * Looks up a public key by its fingerprint, without
+ * copying it. Indexed keys are found by probing the
+ * on-disk hash index.
+ *
+ * @param ring the keyring
+ * @param fingerprint the fingerprint, see ntru_key_fingerprint()
+ * @return N little endian int16_t coefficients inside the
+ * mapping, which stay valid until the keyring is modified
+ * or closed, or NULL if there is no such key
+ */
+const int16_t *
+ntru_keyring_lookup(const ntru_keyring *ring,
+		uint64_t fingerprint);
+
+/**
+ * Looks up a public key by its fingerprint.
+ *
+ * @param pub where to save the public key, must be initialized [out]
+ * @param ring the keyring
+ * @param fingerprint the fingerprint, see ntru_key_fingerprint()
+ * @return true for success, false if there is no such key
+ */
+bool
+ntru_keyring_get_public_key(fmpz_poly_t pub,
+		const ntru_keyring *ring,
+		uint64_t fingerprint);
+
+/**
+ * Rewrites the keyring file so that all keys, including the
+ * appended ones, are covered by a freshly sized hash index.
+ * The new file replaces the old one atomically via rename().
+ *
+ * @param ring the keyring
+ * @return true for success, false if any of the file operations failed,
+ * in which case the keyring is left unchanged
+ */
+bool
+ntru_keyring_compact(ntru_keyring *ring);
+
+/**
+ * Unmaps the keyring file and frees the keyring.
+ *
+ * @param ring the keyring to close
+ */
+void
+ntru_keyring_close(ntru_keyring *ring);
+
+
+#endif /* PUBLIC_NTRU_KEYRING_H_ */
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keystore.h
+ * This file holds the public API of shared read-only
+ * key stores of the pqc NTRU implementation and is
+ * meant to be installed on the client system.
+ * @brief public API, shared read-only key stores
+ */
+
+#ifndef PUBLIC_NTRU_KEYSTORE_H_
+#define PUBLIC_NTRU_KEYSTORE_H_
+
+
+#include <ntru.h>
+#include <ntru_keypair.h>
+
+#include <fmpz_poly.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Current version of the key store format.
+ */
+#define NTRU_KEYSTORE_VERSION 2
+
+
+typedef struct ntru_keystore ntru_keystore;
+typedef struct ntru_keystore_builder ntru_keystore_builder;
+typedef struct ntru_key_handle ntru_key_handle;
+
+
+/**
+ * A zero-copy handle of a key inside an attached key store.
+ * The coefficient arrays hold N little endian int16_t values
+ * each, are NTRU_KEYFILE_ALIGN aligned and stay valid until
+ * the store is detached. They can be passed to
+ * ntru_encrypt_string_into_mapped() and
+ * ntru_decrypt_string_into_mapped() as they are.
+ */
+struct ntru_key_handle {
+	/**
+	 * The parameter set of the key.
+	 */
+	ntru_params params;
+	/**
+	 * Coefficients of the public key h.
+	 */
+	const int16_t *pub;
+	/**
+	 * Coefficients of the private key f,
+	 * NULL if only the public key is stored.
+	 */
+	const int16_t *priv;
+	/**
+	 * Coefficients of the inverse Fp of f,
+	 * NULL if only the public key is stored.
+	 */
+	const int16_t *priv_inv;
+};
+
+
+/**
+ * Creates a builder, which collects keys of one parameter
+ * set in memory until they are written out as a key store.
+ *
+ * @param params the NTRU context of all keys
+ * @return the newly allocated builder
+ */
+ntru_keystore_builder *
+ntru_keystore_builder_new(const ntru_params *params);
+
+/**
+ * Adds a keypair, including the inverse of the private key.
+ *
+ * @param builder the builder
+ * @param name the name the keypair is looked up by
+ * @param pair the keypair
+ * @return true for success, false if the name is already
+ * taken or a coefficient does not fit into 16 bits
+ */
+bool
+ntru_keystore_builder_add_keypair(ntru_keystore_builder *builder,
+		char const * const name,
+		const keypair *pair);
+
+/**
+ * Adds a public key.
+ *
+ * @param builder the builder
+ * @param name the name the key is looked up by
+ * @param pub the public key
+ * @return true for success, false if the name is already
+ * taken or a coefficient does not fit into 16 bits
+ */
+bool
+ntru_keystore_builder_add_public_key(ntru_keystore_builder *builder,
+		char const * const name,
+		const fmpz_poly_t pub);
+
+/**
+ * Writes all collected keys as a key store into a POSIX
+ * shared memory object, which is created or replaced. The
+ * object is only accessible by its owner. Stores attached
+ * before keep the old keys until they are detached.
+ *
+ * @param builder the builder
+ * @param shm_name the name of the shared memory object,
+ * e.g. "/ntru-keys"
+ * @return true for success, false if any of the shared memory
+ * operations failed
+ */
+bool
+ntru_keystore_builder_write_shm(const ntru_keystore_builder *builder,
+		char const * const shm_name);
+
+/**
+ * Writes all collected keys as a key store into a file,
+ * which is created or atomically replaced. The file is only
+ * accessible by its owner. Stores attached before keep the
+ * old keys until they are detached.
+ *
+ * @param builder the builder
+ * @param filename the file
+ * @return true for success, false if any of the file operations failed
+ */
+bool
+ntru_keystore_builder_write_file(const ntru_keystore_builder *builder,
+		char const * const filename);
+
+/**
+ * Frees a builder and all keys collected in it.
+ *
+ * @param builder the builder to free
+ */
+void
+ntru_keystore_builder_delete(ntru_keystore_builder *builder);
+
+/**
+ * Attaches read-only to a key store in a POSIX shared memory
+ * object. Nothing is copied, so all processes attached to the
+ * same store share the memory of the keys.
+ *
+ * @param shm_name the name of the shared memory object
+ * @return the newly allocated store, or NULL if the object
+ * could not be mapped or is malformed
+ */
+ntru_keystore *
+ntru_keystore_attach_shm(char const * const shm_name);
+
+/**
+ * Attaches read-only to a key store in a file, see
+ * ntru_keystore_attach_shm().
+ *
+ * @param filename the file
+ * @return the newly allocated store, or NULL if the file
+ * could not be mapped or is malformed
+ */
+ntru_keystore *
+ntru_keystore_attach_file(char const * const filename);
+
+/**
+ * Get the number of keys in a store.
+ *
+ * @param store the store
+ * @return the number of keys
+ */
+size_t
+ntru_keystore_count(const ntru_keystore *store);
+
+/**
+ * Looks up a key by name, without copying it.
+ *
+ * @param store the store
+ * @param name the name of the key
+ * @param handle where to store the handle of the key [out]
+ * @return true for success, false if there is no such key
+ */
+bool
+ntru_keystore_get(const ntru_keystore *store,
+		char const * const name,
+		ntru_key_handle *handle);
+
+/**
+ * Copies one coefficient array of a handle into a polynomial,
+ * for the code paths that need a fmpz_poly_t.
+ *
+ * @param poly the polynomial, must be initialized [out]
+ * @param coeffs one of the coefficient arrays of the handle
+ * @param handle the handle the array belongs to
+ */
+void
+ntru_key_handle_get_poly(fmpz_poly_t poly,
+		const int16_t *coeffs,
+		const ntru_key_handle *handle);
+
+/**
+ * Detaches from a key store and frees it. All handles
+ * obtained from it become invalid.
+ *
+ * @param store the store to detach from
+ */
+void
+ntru_keystore_detach(ntru_keystore *store);
+
+/**
+ * Removes a POSIX shared memory object holding a key store.
+ * Processes that are still attached keep their mapping.
+ *
+ * @param shm_name the name of the shared memory object
+ * @return true for success, false otherwise
+ */
+bool
+ntru_keystore_unlink_shm(char const * const shm_name);
+
+
+#endif /* PUBLIC_NTRU_KEYSTORE_H_ */
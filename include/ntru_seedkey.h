@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_seedkey.h
+ * This file holds the public API of seed-compressed
+ * private keys of the pqc NTRU implementation and is
+ * meant to be installed on the client system.
+ * @brief public API, seed-compressed private keys
+ */
+
+#ifndef PUBLIC_NTRU_SEEDKEY_H_
+#define PUBLIC_NTRU_SEEDKEY_H_
+
+
+#include <ntru.h>
+#include <ntru_keypair.h>
+#include <ntru_rnd.h>
+
+#include <fmpz_poly.h>
+#include <fmpz.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/**
+ * Length of a seed-compressed private key in bytes.
+ */
+#define NTRU_SEED_LEN 32
+
+/**
+ * Current version of the seed key file format.
+ */
+#define NTRU_SEEDKEY_VERSION 1
+
+
+typedef struct ntru_seed_cache ntru_seed_cache;
+
+
+/**
+ * Generates a new seed-compressed private key. The seed is
+ * chosen so that the keypair derived from it is valid, the
+ * whole private key is then just these NTRU_SEED_LEN bytes.
+ *
+ * @param seed where to store the seed, NTRU_SEED_LEN bytes [out]
+ * @param pair where to store the expanded keypair, e.g. to export
+ * the public key (the polynomials inside the struct will be
+ * automatically initialized), can be NULL [out]
+ * @param params the NTRU context
+ * @param rng the rng to draw the seed from, NULL for the
+ * per-thread DRBG
+ * @return true for success, false if no valid seed was found
+ * within a sane number of tries
+ */
+bool
+ntru_generate_seed_key(uint8_t *seed,
+		keypair *pair,
+		const ntru_params *params,
+		ntru_rng *rng);
+
+/**
+ * Deterministically expands a seed into the full keypair,
+ * which requires both inversions.
+ *
+ * @param pair store private and public components here (the
+ * polynomials inside the struct will be automatically
+ * initialized) [out]
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param params the NTRU context
+ * @return true for success, false if the seed is not valid
+ * for these parameters
+ */
+bool
+ntru_expand_seed_keypair(keypair *pair,
+		const uint8_t *seed,
+		const ntru_params *params);
+
+/**
+ * Deterministically expands a seed into the private key f
+ * and its inverse Fp. This skips g, the inversion modulo q
+ * and the public key, which are not needed for decryption.
+ *
+ * @param priv where to save the private key, must be initialized [out]
+ * @param priv_inv where to save the inverse of the private key,
+ * must be initialized [out]
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param params the NTRU context
+ * @return true for success, false if the seed is not valid
+ * for these parameters
+ */
+bool
+ntru_expand_seed_priv(fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		const uint8_t *seed,
+		const ntru_params *params);
+
+/**
+ * Export a seed-compressed private key to a file. The seed
+ * is preceded by a small header with a magic, the format
+ * version and the parameters N, p and q it belongs to.
+ *
+ * @param filename the file to save the seed into
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param params the NTRU context the seed was generated for
+ * @return true for success, false if any of the file operations failed
+ */
+bool
+export_seed_key(char const * const filename,
+		const uint8_t *seed,
+		const ntru_params *params);
+
+/**
+ * Import a seed-compressed private key from a file written
+ * by export_seed_key().
+ *
+ * @param seed where to store the seed, NTRU_SEED_LEN bytes [out]
+ * @param filename the file to get the seed from
+ * @param params the NTRU context the seed has to belong to
+ * @return true for success, false if any of the file operations
+ * failed, the file has the wrong size, magic or version, or
+ * it was written for other parameters
+ */
+bool
+import_seed_key(uint8_t *seed,
+		char const * const filename,
+		const ntru_params *params);
+
+/**
+ * Creates a thread-safe cache of expanded seed-compressed
+ * private keys.
+ *
+ * @param capacity the maximum number of expanded keys
+ * to keep, the least recently used ones are evicted
+ * @return the newly allocated cache
+ */
+ntru_seed_cache *
+ntru_seed_cache_new(size_t capacity);
+
+/**
+ * Get the expanded private key of a seed, from the cache
+ * if possible, otherwise it is expanded via ntru_expand_seed_priv()
+ * and added to the cache.
+ *
+ * @param cache the cache
+ * @param priv where to save the private key, must be initialized [out]
+ * @param priv_inv where to save the inverse of the private key,
+ * must be initialized [out]
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param params the NTRU context
+ * @return true for success, false if the seed is not valid
+ * for these parameters
+ */
+bool
+ntru_seed_cache_get_priv(ntru_seed_cache *cache,
+		fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		const uint8_t *seed,
+		const ntru_params *params);
+
+/**
+ * Get a snapshot of the counters of the cache.
+ *
+ * @param cache the cache
+ * @param stats where to store the counters [out]
+ */
+void
+ntru_seed_cache_get_stats(ntru_seed_cache *cache,
+		ntru_cache_stats *stats);
+
+/**
+ * Frees the cache and all expanded keys in it.
+ *
+ * @param cache the cache to free
+ */
+void
+ntru_seed_cache_delete(ntru_seed_cache *cache);
+
+
+#endif /* PUBLIC_NTRU_SEEDKEY_H_ */
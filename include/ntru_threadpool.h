@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_threadpool.h
+ * This file holds the public API of the thread pool
+ * of the pqc NTRU implementation and is meant to be
+ * installed on the client system.
+ * @brief public API, thread pool
+ */
+
+#ifndef PUBLIC_NTRU_THREADPOOL_H_
+#define PUBLIC_NTRU_THREADPOOL_H_
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+typedef struct ntru_thread_pool ntru_thread_pool;
+
+
+/**
+ * Creates a pool of worker threads which run submitted
+ * tasks in FIFO order.
+ *
+ * @param num_threads number of worker threads, 0 means
+ * one per online CPU
+ * @return the newly allocated pool, or NULL if not a
+ * single thread could be started
+ */
+ntru_thread_pool *
+ntru_thread_pool_new(uint32_t num_threads);
+
+/**
+ * Get the number of worker threads of a pool.
+ *
+ * @param pool the pool
+ * @return the number of worker threads
+ */
+uint32_t
+ntru_thread_pool_size(const ntru_thread_pool *pool);
+
+/**
+ * Queues a task, which is run by one of the worker threads.
+ *
+ * @param pool the pool
+ * @param task the function to run
+ * @param arg the argument passed to task
+ */
+void
+ntru_thread_pool_submit(ntru_thread_pool *pool,
+		void (*task)(void *arg),
+		void *arg);
+
+/**
+ * Runs body(i, arg) for every i in [0, n) and waits until
+ * all of them returned. The calling thread takes part, so
+ * this also makes progress if all workers are busy, and
+ * it may be called from within a task.
+ *
+ * @param pool the pool, can be NULL to run everything
+ * in the calling thread
+ * @param n the number of iterations
+ * @param body the function to run for every iteration
+ * @param arg the argument passed to body
+ */
+void
+ntru_thread_pool_parallel_for(ntru_thread_pool *pool,
+		size_t n,
+		void (*body)(size_t i, void *arg),
+		void *arg);
+
+/**
+ * Runs all queued tasks, stops the worker threads and
+ * frees the pool.
+ *
+ * @param pool the pool to free
+ */
+void
+ntru_thread_pool_delete(ntru_thread_pool *pool);
+
+
+#endif /* PUBLIC_NTRU_THREADPOOL_H_ */
@@ -27,14 +27,14 @@
  */
 
 #include "ntru_ascii_poly.h"
+#include "ntru_base64.h"
 #include "ntru_common.h"
+#include "ntru_err.h"
 #include "ntru_mem.h"
 #include "ntru_params.h"
 #include "ntru_poly.h"
 #include "ntru_string.h"
 
-#include <glib.h>
-
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,53 +44,63 @@
 
 
 /**
- * Convert an integer to it's binary representation
- * as a char array and return it (not NULL terminated).
- *
- * As in: 90 => "10110101"
+ * Expands one byte to 8 binary coefficients, most significant
+ * bit first, packed into the bytes of a 64 bit word in memory
+ * order (coefficient i in byte i) with the mapping 1 => 1, 0 => -1.
  *
- * @param value the integer to convert
- * @return the binary representation as a newly allocated char array
- * (not NULL terminated)
+ * @param byte the byte to expand
+ * @return the 8 coefficients as int8_t's in little endian order
  */
-static char *
-get_int_to_bin_str(uint8_t value);
+static inline uint64_t
+byte_to_bin_coeffs(uint8_t byte);
 
 
 /*------------------------------------------------------------------------*/
 
-static char *
-get_int_to_bin_str(uint8_t value)
+static inline uint64_t
+byte_to_bin_coeffs(uint8_t byte)
 {
-    int i;
-	const size_t bin_string_size = ASCII_BITS;
-	char *bin_string = ntru_malloc(sizeof(*bin_string) *
-			(bin_string_size));
+	/* select bit 7 - i of the byte in byte i of the word */
+	uint64_t x = (byte * 0x0101010101010101ULL) & 0x0102040810204080ULL;
 
-    for (i = ASCII_BITS - 1; i >= 0; --i, value >>= 1)
-        bin_string[i] = (value & 1) + '0';
+	/* a selected bit is at most 0x80, so nothing carries over */
+	x = ((x + 0x7f7f7f7f7f7f7f7fULL) >> 7) & 0x0101010101010101ULL;
 
-	return bin_string;
+	/* 1 => 0x01, 0 => 0xff */
+	return (x * 0xfe) ^ 0xffffffffffffffffULL;
 }
 
 /*------------------------------------------------------------------------*/
 
-fmpz_poly_t *
-ascii_bin_to_bin_poly(const char *to_poly, const ntru_params *params)
+void
+bytes_to_bin_coeffs(int8_t *out,
+		const uint8_t *in,
+		size_t bit_off,
+		size_t nbits)
 {
-	uint32_t i = 0;
-	fmpz_poly_t *new_poly = ntru_malloc(sizeof(*new_poly));
+	size_t i = 0;
+
+	if (!out || !in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
 
-	fmpz_poly_init(*new_poly);
+	/* leading bits up to the next byte boundary */
+	for (; i < nbits && (bit_off + i) % ASCII_BITS; i++) {
+		size_t bit = bit_off + i;
 
-	while (to_poly[i] && i < params->N) {
-		fmpz_poly_set_coeff_si(*new_poly,
-				i,
-				(to_poly[i] == '0') ? -1 : 1);
-		i++;
+		out[i] = (in[bit / ASCII_BITS] >> (7 - bit % ASCII_BITS)) & 1 ?
+			1 : -1;
 	}
 
-	return new_poly;
+	for (; nbits - i >= ASCII_BITS; i += ASCII_BITS)
+		put_le64((uint8_t *)(out + i),
+				byte_to_bin_coeffs(in[(bit_off + i) / ASCII_BITS]));
+
+	for (; i < nbits; i++) {
+		size_t bit = bit_off + i;
+
+		out[i] = (in[bit / ASCII_BITS] >> (7 - bit % ASCII_BITS)) & 1 ?
+			1 : -1;
+	}
 }
 
 /*------------------------------------------------------------------------*/
@@ -98,43 +108,100 @@ ascii_bin_to_bin_poly(const char *to_poly, const ntru_params *params)
 fmpz_poly_t **
 ascii_to_bin_poly_arr(const string *to_poly, const ntru_params *params)
 {
-	char *cur = to_poly->ptr;
-	char *out = ntru_malloc(CHAR_SIZE * (to_poly->len * ASCII_BITS + 1));
-	uint32_t polyc = 0;
-	size_t out_len = 0;
+	const size_t bits = to_poly->len * ASCII_BITS;
+	const uint32_t polyc = (bits + params->N - 1) / params->N;
+	int8_t *coeffs = ntru_malloc(params->N);
 	fmpz_poly_t **poly_array;
 
-	for (uint32_t i = 0; i < to_poly->len; i++) {
-		char *tmp_string = get_int_to_bin_str((int)(*cur));
-		memcpy(out + out_len, tmp_string, ASCII_BITS);
-		out_len += ASCII_BITS;
-		cur++;
-		free(tmp_string);
+	poly_array = ntru_malloc(sizeof(*poly_array) * (polyc + 1));
+
+	for (uint32_t i = 0; i < polyc; i++) {
+		size_t bit = (size_t)i * params->N;
+		uint32_t len = (bits - bit > params->N) ? params->N : bits - bit;
+
+		bytes_to_bin_coeffs(coeffs, (const uint8_t *)to_poly->ptr,
+				bit, len);
+
+		poly_array[i] = ntru_malloc(sizeof(**poly_array));
+		fmpz_poly_init2(*poly_array[i], len);
+
+		for (uint32_t k = 0; k < len; k++)
+			fmpz_poly_set_coeff_si(*poly_array[i], k, coeffs[k]);
 	}
-	out[out_len] = '\0';
 
-	poly_array = ntru_malloc(sizeof(**poly_array) *
-			(strlen(out) / params->N + 1));
+	poly_array[polyc] = NULL;
+	free(coeffs);
+
+	return poly_array;
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+bytes_to_tern_coeffs(int8_t *out,
+		const uint8_t *in,
+		size_t len)
+{
+	const size_t bits = len * ASCII_BITS;
+	size_t n = 0;
 
-	for (uint32_t i = 0; i < out_len; i += params->N) {
-		char chunk[params->N + 1];
-		size_t real_chunk_size;
+	if (!out || !in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
 
-		real_chunk_size =
-			(out_len - i > params->N) ? params->N : out_len - i;
+	for (size_t bit = 0; bit < bits; bit += TERN_GROUP_BITS) {
+		const size_t first = bit / ASCII_BITS;
+		uint32_t window = 0,
+				 v;
 
-		memcpy(chunk, out + i, real_chunk_size);
-		chunk[real_chunk_size] = '\0';
+		/* a group spans at most 4 bytes, bits past the end are 0 */
+		for (size_t b = first; b < first + 4; b++)
+			window = (window << 8) | (b < len ? in[b] : 0);
 
-		poly_array[polyc] = ascii_bin_to_bin_poly(chunk, params);
+		v = (window >> (32 - TERN_GROUP_BITS - bit % ASCII_BITS)) &
+			((1UL << TERN_GROUP_BITS) - 1);
 
-		polyc++;
+		/* most significant digit first, digit d => d - 1 */
+		for (int j = TERN_GROUP_TRITS - 1; j >= 0; j--) {
+			out[n + j] = (int8_t)(v % 3) - 1;
+			v /= 3;
+		}
+		n += TERN_GROUP_TRITS;
 	}
 
-	free(out);
+	return n;
+}
+
+/*------------------------------------------------------------------------*/
+
+fmpz_poly_t **
+ascii_to_tern_poly_arr(const string *to_poly, const ntru_params *params)
+{
+	const size_t trits = (to_poly->len * ASCII_BITS + TERN_GROUP_BITS - 1) /
+		TERN_GROUP_BITS * TERN_GROUP_TRITS;
+	const uint32_t polyc = (trits + params->N - 1) / params->N;
+	int8_t *coeffs = ntru_calloc((size_t)polyc * params->N,
+			sizeof(*coeffs));
+	fmpz_poly_t **poly_array;
+
+	bytes_to_tern_coeffs(coeffs, (const uint8_t *)to_poly->ptr,
+			to_poly->len);
+
+	poly_array = ntru_malloc(sizeof(*poly_array) * (polyc + 1));
+
+	for (uint32_t i = 0; i < polyc; i++) {
+		const int8_t *cur = coeffs + (size_t)i * params->N;
+
+		poly_array[i] = ntru_malloc(sizeof(**poly_array));
+		fmpz_poly_init2(*poly_array[i], params->N);
+
+		for (uint32_t k = 0; k < params->N; k++)
+			fmpz_poly_set_coeff_si(*poly_array[i], k, cur[k]);
+	}
 
 	poly_array[polyc] = NULL;
 
+	free(coeffs);
+
 	return poly_array;
 }
 
@@ -143,56 +210,38 @@ ascii_to_bin_poly_arr(const string *to_poly, const ntru_params *params)
 fmpz_poly_t **
 base64_to_poly_arr(const string *to_poly, const ntru_params *params)
 {
-	uint32_t i = 0,
-			 polyc = 0;
-	gsize out_len;
-	guchar *base64_decoded = NULL;
-	string *new_string = ntru_malloc(sizeof(*new_string));
+	uint32_t polyc;
+	size_t len;
+	uint8_t *decoded = ntru_malloc(BASE64_DECODED_MAX(to_poly->len) + 1);
+	int32_t *coeffs;
 	fmpz_poly_t **poly_array;
-	char *tmp = ntru_malloc(sizeof(char) * (to_poly->len + 1));
-
-	/* g_base64_decode() needs it null-terminated */
-	memcpy(tmp, to_poly->ptr, to_poly->len);
-	tmp[to_poly->len] = '\0';
-
-	base64_decoded = g_base64_decode((const gchar *)tmp, &out_len);
 
-	new_string->ptr = (char *)base64_decoded;
-	new_string->len = (unsigned long)(out_len);
-
-	poly_array = ntru_malloc(sizeof(**poly_array) *
-			(new_string->len / params->N));
+	if (!base64_decode(decoded, &len, to_poly->ptr, to_poly->len)) {
+		free(decoded);
+		return NULL;
+	}
 
-	while (i < new_string->len) {
-		uint32_t j = 0;
-		fmpz_poly_t *new_poly = ntru_malloc(sizeof(*new_poly));
+	coeffs = ntru_malloc(sizeof(*coeffs) * params->N);
 
-		fmpz_poly_init(*new_poly);
+	polyc = (len + params->N - 1) / params->N;
+	poly_array = ntru_malloc(sizeof(*poly_array) * (polyc + 1));
 
-		while (j < params->N) {
-			fmpz_poly_set_coeff_si(*new_poly,
-					j,
-					(uint8_t)(base64_decoded[i]));
-			j++;
-			i++;
-		}
+	for (uint32_t i = 0; i < polyc; i++) {
+		const size_t off = (size_t)i * params->N;
 
-		/* fill the last poly with q (which is a non-standard
-		 * coefficient) */
-		for (uint32_t k = j; k < params->N; k++) {
-			fmpz_poly_set_coeff_si(*new_poly,
-					k,
-					params->q);
-		}
+		/* only a truncated string has a short last poly */
+		for (uint32_t k = 0; k < params->N; k++)
+			coeffs[k] = off + k < len ? decoded[off + k] : 0;
 
-		poly_array[polyc] = new_poly;
-		polyc++;
+		poly_array[i] = ntru_malloc(sizeof(**poly_array));
+		fmpz_poly_init(*poly_array[i]);
+		poly_set_int_arr(*poly_array[i], coeffs, params);
 	}
 
 	poly_array[polyc] = NULL;
 
-	string_delete(new_string);
-	free(tmp);
+	free(coeffs);
+	free(decoded);
 
 	return poly_array;
 }
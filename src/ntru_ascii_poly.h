@@ -35,23 +35,31 @@
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
+#include <stdint.h>
 
 
 /**
- * Convert a "binary" ascii string to a binary polyomial.
- * The ascii string will be converted to a binary representation
- * and the following mapping will apply between binary -> poly:
+ * Expands bits of a byte buffer to binary polynomial coefficients,
+ * without going through a string of '0's and '1's. The bits are read
+ * most significant bit first, starting at an arbitrary bit offset,
+ * and the following mapping will apply between binary -> coefficient:
  *
  * 1 => 1
  *
  * 0 => -1
  *
- * @param to_poly the string to get into binary polynomial format
- * @param params the NTRUEncrypt context
- * @return newly allocated array of binary polynomials
+ * Whole bytes are expanded 8 coefficients at a time.
+ *
+ * @param out where to store the coefficients, nbits of them [out]
+ * @param in the byte buffer
+ * @param bit_off the index of the first bit to read
+ * @param nbits the number of bits to read
  */
-fmpz_poly_t *
-ascii_bin_to_bin_poly(const char *to_poly, const ntru_params *params);
+void
+bytes_to_bin_coeffs(int8_t *out,
+		const uint8_t *in,
+		size_t bit_off,
+		size_t nbits);
 
 /**
  * Convert an ascii string to an array of binary polyomials.
@@ -69,20 +77,53 @@ ascii_bin_to_bin_poly(const char *to_poly, const ntru_params *params);
 fmpz_poly_t **
 ascii_to_bin_poly_arr(const string *to_poly, const ntru_params *params);
 
+/**
+ * Packs the bits of a byte buffer into ternary coefficients,
+ * TERN_GROUP_BITS bits (most significant bit first) at a time
+ * into a group of TERN_GROUP_TRITS coefficients. A group is the
+ * base 3 representation of its bits, most significant digit
+ * first, with the digit mapping 0 => -1, 1 => 0, 2 => 1.
+ * The bits of the last group are padded with zeros.
+ *
+ * @param out where to store the coefficients, a multiple of
+ * TERN_GROUP_TRITS [out]
+ * @param in the byte buffer
+ * @param len the length of in
+ * @return the number of coefficients written
+ */
+size_t
+bytes_to_tern_coeffs(int8_t *out,
+		const uint8_t *in,
+		size_t len);
+
+/**
+ * Convert an ascii string to an array of ternary polyomials
+ * via bytes_to_tern_coeffs(). All polynomials have N coefficients,
+ * the rest of the last one is padded with zeros, so the string
+ * must carry its own length.
+ *
+ * @param to_poly the string to get into ternary polynomial format
+ * @param params the NTRUEncrypt context
+ * @return newly allocated array of ternary polynomials
+ */
+fmpz_poly_t **
+ascii_to_tern_poly_arr(const string *to_poly, const ntru_params *params);
+
 /**
  * Convert an base64 encoded string to an array of polyomials with
  * coefficients which are expected to be in the range [0, q-1].
  * The chars will be converted (after decoding) to their integer
  * representation and directly put into the coefficients.
  *
- * If the last polynomial is of degree less than N -1, then it will
- * be filled with trailing q's for later user in poly_arr_to_base64().
+ * Ciphertexts and keys always consist of full polynomials, only
+ * a truncated string leaves the rest of the last one as zeros.
  *
  * @param to_poly the string to get into polynomial format,
  * which is of type string, so we can iterate safely over it
  * (the string might have null-bytes in the middle of it)
  * @param params the NTRUEncrypt context
- * @return newly allocated array of polynomials
+ * @return newly allocated array of polynomials, NULL if
+ * to_poly is no valid base64
  */
 fmpz_poly_t **
 base64_to_poly_arr(const string *to_poly, const ntru_params *params);
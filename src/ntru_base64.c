@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_base64.c
+ * This file implements the base64 encoding of the ciphertext
+ * strings, with SSSE3 and AVX2 code paths that are picked at
+ * compile time and a scalar fallback.
+ * @brief base64 encoding
+ */
+
+#include "ntru_base64.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+
+/**
+ * The standard base64 alphabet.
+ */
+static const char base64_alphabet[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * The value of every base64 character, -1 for everything
+ * that is not in the alphabet.
+ */
+static const int8_t base64_values[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+	-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+	-1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+
+#ifdef __SSSE3__
+/**
+ * Spreads 12 input bytes over 16 bytes, so that
+ * every 6 bit group ends up in its own byte.
+ *
+ * @param in the input bytes in the low 12 bytes
+ * @return the 16 groups, one per byte
+ */
+static inline __m128i
+enc_reshuffle(__m128i in);
+
+/**
+ * Maps 16 values in the range [0, 63] to their base64
+ * characters, without a 64 entry table lookup.
+ *
+ * @param in the values
+ * @return the characters
+ */
+static inline __m128i
+enc_translate(__m128i in);
+
+/**
+ * Maps 16 base64 characters to their values.
+ *
+ * @param out where to store the values [out]
+ * @param in the characters
+ * @return true for success, false if one of them is
+ * not in the alphabet
+ */
+static inline bool
+dec_translate(__m128i *out, __m128i in);
+
+/**
+ * Packs 16 values in the range [0, 63] into 12 bytes.
+ *
+ * @param in the values
+ * @return the bytes in the low 12 bytes
+ */
+static inline __m128i
+dec_pack(__m128i in);
+#endif
+
+#ifdef __AVX2__
+/**
+ * Like enc_reshuffle(), for 24 input bytes, the first
+ * 12 in the low lane and the next 12 in the high lane.
+ *
+ * @param in the input bytes
+ * @return the 32 groups, one per byte
+ */
+static inline __m256i
+enc_reshuffle256(__m256i in);
+
+/**
+ * Like enc_translate(), for 32 values.
+ *
+ * @param in the values
+ * @return the characters
+ */
+static inline __m256i
+enc_translate256(__m256i in);
+
+/**
+ * Like dec_translate(), for 32 characters.
+ *
+ * @param out where to store the values [out]
+ * @param in the characters
+ * @return true for success, false if one of them is
+ * not in the alphabet
+ */
+static inline bool
+dec_translate256(__m256i *out, __m256i in);
+
+/**
+ * Like dec_pack(), for 32 values.
+ *
+ * @param in the values
+ * @return the bytes in the low 24 bytes
+ */
+static inline __m256i
+dec_pack256(__m256i in);
+#endif
+
+
+/*------------------------------------------------------------------------*/
+
+#ifdef __SSSE3__
+static inline __m128i
+enc_reshuffle(__m128i in)
+{
+	__m128i lo,
+			hi;
+
+	/* every 3 bytes a, b, c become b, a, c, b */
+	in = _mm_shuffle_epi8(in, _mm_setr_epi8(
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+	/* move the 6 bit groups to the low end of their bytes */
+	lo = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+			_mm_set1_epi32(0x04000040));
+	hi = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+			_mm_set1_epi32(0x01000010));
+
+	return _mm_or_si128(lo, hi);
+}
+
+/*------------------------------------------------------------------------*/
+
+static inline __m128i
+enc_translate(__m128i in)
+{
+	/* offset to the character, by range of the value */
+	const __m128i lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	__m128i idx = _mm_subs_epu8(in, _mm_set1_epi8(51));
+	__m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), in);
+
+	idx = _mm_or_si128(idx, _mm_and_si128(upper, _mm_set1_epi8(13)));
+
+	return _mm_add_epi8(in, _mm_shuffle_epi8(lut, idx));
+}
+
+/*------------------------------------------------------------------------*/
+
+static inline bool
+dec_translate(__m128i *out, __m128i in)
+{
+	/* a character is valid if its nibble classes do not overlap */
+	const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04,
+			0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71,
+			-71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	__m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+	__m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(in, nibble));
+	__m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+	__m128i roll;
+
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi),
+					_mm_setzero_si128())) != 0xffff)
+		return false;
+
+	/* '/' shares its high nibble with '+' */
+	roll = _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')),
+			hi_nibbles);
+	*out = _mm_add_epi8(in, _mm_shuffle_epi8(lut_roll, roll));
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static inline __m128i
+dec_pack(__m128i in)
+{
+	/* merge 4 values to 24 bits per 32 bit lane, then drop the gaps */
+	__m128i merged = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+
+	merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+	return _mm_shuffle_epi8(merged, _mm_setr_epi8(
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+#endif
+
+/*------------------------------------------------------------------------*/
+
+#ifdef __AVX2__
+static inline __m256i
+enc_reshuffle256(__m256i in)
+{
+	__m256i lo,
+			hi;
+
+	in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+				1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+	lo = _mm256_mulhi_epu16(
+			_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+			_mm256_set1_epi32(0x04000040));
+	hi = _mm256_mullo_epi16(
+			_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+			_mm256_set1_epi32(0x01000010));
+
+	return _mm256_or_si256(lo, hi);
+}
+
+/*------------------------------------------------------------------------*/
+
+static inline __m256i
+enc_translate256(__m256i in)
+{
+	const __m256i lut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+			'a' - 26, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+	__m256i idx = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+	__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), in);
+
+	idx = _mm256_or_si256(idx,
+			_mm256_and_si256(upper, _mm256_set1_epi8(13)));
+
+	return _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, idx));
+}
+
+/*------------------------------------------------------------------------*/
+
+static inline bool
+dec_translate256(__m256i *out, __m256i in)
+{
+	const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+			0x15, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04,
+			0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04,
+			0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71,
+			-71, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71,
+			-71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	__m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+	__m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(in, nibble));
+	__m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+	__m256i roll;
+
+	if (!_mm256_testz_si256(lo, hi))
+		return false;
+
+	roll = _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')),
+			hi_nibbles);
+	*out = _mm256_add_epi8(in, _mm256_shuffle_epi8(lut_roll, roll));
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static inline __m256i
+dec_pack256(__m256i in)
+{
+	__m256i merged = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+
+	merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+	merged = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+	/* close the gap between the 12 bytes of both lanes */
+	return _mm256_permutevar8x32_epi32(merged,
+			_mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+}
+#endif
+
+/*------------------------------------------------------------------------*/
+
+size_t
+base64_encode(char *out, const uint8_t *in, size_t len)
+{
+	size_t i = 0;
+	char *o = out;
+
+#ifdef __AVX2__
+	/* the load of the high lane reads 4 bytes beyond the 24 */
+	for (; len - i >= 28; i += 24, o += 32) {
+		__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+					_mm_loadu_si128((const __m128i *)(in + i))),
+				_mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+
+		_mm256_storeu_si256((__m256i *)o,
+				enc_translate256(enc_reshuffle256(v)));
+	}
+#endif
+
+#ifdef __SSSE3__
+	for (; len - i >= 16; i += 12, o += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+		_mm_storeu_si128((__m128i *)o, enc_translate(enc_reshuffle(v)));
+	}
+#endif
+
+	for (; len - i >= 3; i += 3) {
+		uint32_t v = (uint32_t)in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+
+		*o++ = base64_alphabet[v >> 18];
+		*o++ = base64_alphabet[(v >> 12) & 0x3f];
+		*o++ = base64_alphabet[(v >> 6) & 0x3f];
+		*o++ = base64_alphabet[v & 0x3f];
+	}
+
+	if (len - i == 2) {
+		uint32_t v = (uint32_t)in[i] << 16 | in[i + 1] << 8;
+
+		*o++ = base64_alphabet[v >> 18];
+		*o++ = base64_alphabet[(v >> 12) & 0x3f];
+		*o++ = base64_alphabet[(v >> 6) & 0x3f];
+		*o++ = '=';
+	} else if (len - i == 1) {
+		uint32_t v = (uint32_t)in[i] << 16;
+
+		*o++ = base64_alphabet[v >> 18];
+		*o++ = base64_alphabet[(v >> 12) & 0x3f];
+		*o++ = '=';
+		*o++ = '=';
+	}
+
+	return o - out;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+base64_decode(uint8_t *out, size_t *out_len, const char *in, size_t len)
+{
+	const uint8_t *s = (const uint8_t *)in;
+	size_t i = 0,
+		   o = 0;
+
+	while (len && (s[len - 1] == '\n' || s[len - 1] == '\r'))
+		len--;
+
+	if (len % 4)
+		return false;
+
+	/*
+	 * the stores write up to 8 bytes (4 for SSSE3) beyond the
+	 * decoded ones, which the remaining input leaves room for,
+	 * and the padding is always left to the scalar code
+	 */
+#ifdef __AVX2__
+	for (; len - i >= 48; i += 32, o += 24) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+
+		if (!dec_translate256(&v, v))
+			return false;
+		_mm256_storeu_si256((__m256i *)(out + o), dec_pack256(v));
+	}
+#endif
+
+#ifdef __SSSE3__
+	for (; len - i >= 24; i += 16, o += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+		if (!dec_translate(&v, v))
+			return false;
+		_mm_storeu_si128((__m128i *)(out + o), dec_pack(v));
+	}
+#endif
+
+	for (; i < len; i += 4) {
+		int32_t a = base64_values[s[i]],
+				b = base64_values[s[i + 1]],
+				c = base64_values[s[i + 2]],
+				d = base64_values[s[i + 3]];
+
+		/* padding, only at the very end */
+		if (i + 4 == len && s[i + 3] == '=') {
+			d = 0;
+			if (s[i + 2] == '=')
+				c = 0;
+		}
+
+		if ((a | b | c | d) < 0)
+			return false;
+
+		out[o++] = (uint8_t)(a << 2 | b >> 4);
+		if (i + 4 < len || s[i + 2] != '=')
+			out[o++] = (uint8_t)(b << 4 | c >> 2);
+		if (i + 4 < len || s[i + 3] != '=')
+			out[o++] = (uint8_t)(c << 6 | d);
+	}
+
+	*out_len = o;
+
+	return true;
+}
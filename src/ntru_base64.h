@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_base64.h
+ * Header for the internal API of ntru_base64.c.
+ * @brief header for ntru_base64.c
+ */
+
+#ifndef NTRU_BASE64_H
+#define NTRU_BASE64_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Length of the base64 encoding of len bytes, including padding.
+ */
+#define BASE64_ENCODED_LEN(len) (((len) + 2) / 3 * 4)
+
+/**
+ * Maximum number of bytes the base64 string of length
+ * len decodes to.
+ */
+#define BASE64_DECODED_MAX(len) ((len) / 4 * 3)
+
+
+/**
+ * Encodes bytes as base64 with the standard alphabet and
+ * padding. Uses AVX2 or SSSE3 if the library is built for a
+ * CPU that has them.
+ *
+ * @param out where to store the encoding, BASE64_ENCODED_LEN(len)
+ * bytes, it is not null-terminated [out]
+ * @param in the bytes to encode
+ * @param len the number of bytes to encode
+ * @return the length of the encoding
+ */
+size_t
+base64_encode(char *out, const uint8_t *in, size_t len);
+
+/**
+ * Decodes a base64 string, which does not need to be
+ * null-terminated. Trailing newlines, as in a text file, are
+ * ignored, anything else outside of the alphabet is an error.
+ * Uses AVX2 or SSSE3 if the library is built for a CPU that
+ * has them.
+ *
+ * @param out where to store the decoded bytes,
+ * BASE64_DECODED_MAX(len) bytes [out]
+ * @param out_len where to store the number of decoded bytes [out]
+ * @param in the base64 string
+ * @param len the length of in
+ * @return true for success, false if in is no valid base64
+ */
+bool
+base64_decode(uint8_t *out, size_t *out_len, const char *in, size_t len);
+
+
+#endif /* NTRU_BASE64_H */
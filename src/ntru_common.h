@@ -31,11 +31,193 @@
 #define NTRU_COMMON_H
 
 
+#include <stdint.h>
 #include <stdlib.h>
 
 
 #define CHAR_SIZE sizeof(char)
 #define ASCII_BITS 8
 
+/**
+ * Number of message bits that are packed into one group of
+ * TERN_GROUP_TRITS ternary coefficients, since 2^19 <= 3^12.
+ */
+#define TERN_GROUP_BITS 19
+
+/**
+ * Number of ternary coefficients of one group, see TERN_GROUP_BITS.
+ */
+#define TERN_GROUP_TRITS 12
+
+/**
+ * Maximum length of a varint, see put_varint().
+ */
+#define VARINT_MAX_LEN 10
+
+/**
+ * Start value of a 64 bit FNV-1a hash.
+ */
+#define FNV1A_64_INIT 0xcbf29ce484222325ULL
+
+
+/**
+ * Feeds bytes into a 64 bit FNV-1a hash, which is fast
+ * but not collision resistant.
+ *
+ * @param hash the hash so far, FNV1A_64_INIT to start
+ * @param buf the bytes
+ * @param len the number of bytes
+ * @return the updated hash
+ */
+static inline uint64_t
+fnv1a_64(uint64_t hash, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+
+/**
+ * Stores a little endian 16 bit value.
+ *
+ * @param buf where to store the value [out]
+ * @param val the value
+ */
+static inline void
+put_le16(uint8_t *buf, uint16_t val)
+{
+	buf[0] = val & 0xff;
+	buf[1] = val >> 8;
+}
+
+/**
+ * Stores a little endian 32 bit value.
+ *
+ * @param buf where to store the value [out]
+ * @param val the value
+ */
+static inline void
+put_le32(uint8_t *buf, uint32_t val)
+{
+	put_le16(buf, val & 0xffff);
+	put_le16(buf + 2, val >> 16);
+}
+
+/**
+ * Stores a little endian 64 bit value.
+ *
+ * @param buf where to store the value [out]
+ * @param val the value
+ */
+static inline void
+put_le64(uint8_t *buf, uint64_t val)
+{
+	put_le32(buf, val & 0xffffffff);
+	put_le32(buf + 4, val >> 32);
+}
+
+/**
+ * Loads a little endian 16 bit value.
+ *
+ * @param buf where to load the value from
+ * @return the value
+ */
+static inline uint16_t
+get_le16(const uint8_t *buf)
+{
+	return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+/**
+ * Loads a little endian 32 bit value.
+ *
+ * @param buf where to load the value from
+ * @return the value
+ */
+static inline uint32_t
+get_le32(const uint8_t *buf)
+{
+	return get_le16(buf) | ((uint32_t)get_le16(buf + 2) << 16);
+}
+
+/**
+ * Loads a little endian 64 bit value.
+ *
+ * @param buf where to load the value from
+ * @return the value
+ */
+static inline uint64_t
+get_le64(const uint8_t *buf)
+{
+	return get_le32(buf) | ((uint64_t)get_le32(buf + 4) << 32);
+}
+
+
+/**
+ * Length of the varint encoding of a value.
+ *
+ * @param val the value
+ * @return the length in bytes, at most VARINT_MAX_LEN
+ */
+static inline size_t
+varint_len(uint64_t val)
+{
+	size_t len = 1;
+
+	while (val >>= 7)
+		len++;
+
+	return len;
+}
+
+/**
+ * Stores a value as varint, 7 bits per byte starting with the
+ * lowest ones, the high bit of a byte is set if more follow.
+ *
+ * @param buf where to store the value, varint_len() bytes [out]
+ * @param val the value
+ * @return the number of bytes written
+ */
+static inline size_t
+put_varint(uint8_t *buf, uint64_t val)
+{
+	size_t i = 0;
+
+	for (; val >= 0x80; val >>= 7)
+		buf[i++] = (uint8_t)(val | 0x80);
+	buf[i++] = (uint8_t)val;
+
+	return i;
+}
+
+/**
+ * Loads a varint, see put_varint().
+ *
+ * @param buf where to load the value from
+ * @param len the number of bytes available in buf
+ * @param val where to store the value [out]
+ * @return the number of bytes read, 0 if buf does not
+ * hold a complete varint
+ */
+static inline size_t
+get_varint(const uint8_t *buf, size_t len, uint64_t *val)
+{
+	*val = 0;
+
+	for (size_t i = 0; i < len && i < VARINT_MAX_LEN; i++) {
+		*val |= (uint64_t)(buf[i] & 0x7f) << (7 * i);
+		if (!(buf[i] & 0x80))
+			return i + 1;
+	}
+
+	return 0;
+}
+
 
 #endif /* NTRU_COMMON_H */
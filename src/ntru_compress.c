@@ -0,0 +1,984 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_compress.c
+ * This file handles the LZ4 compression of messages
+ * into frames that know their own size.
+ * @brief message compression
+ */
+
+#include "ntru_common.h"
+#include "ntru_compress.h"
+#include "ntru_err.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_string.h"
+#include "ntru_threadpool.h"
+
+#include <limits.h>
+#include <lz4.h>
+#include <lz4hc.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef struct compress_state compress_state;
+typedef struct compress_dict compress_dict;
+typedef struct compress_job compress_job;
+typedef struct decompress_job decompress_job;
+
+
+/**
+ * The LZ4 states of one thread, which are reused
+ * by every call from that thread.
+ */
+struct compress_state {
+	/**
+	 * State of LZ4, created on first use.
+	 */
+	LZ4_stream_t *fast;
+	/**
+	 * State of LZ4HC, allocated on first use.
+	 */
+	void *hc;
+};
+
+
+/**
+ * A preshared dictionary, which is never changed or
+ * freed once it is registered.
+ */
+struct compress_dict {
+	/**
+	 * The id, which goes into the frames.
+	 */
+	uint32_t id;
+	/**
+	 * The dictionary bytes.
+	 */
+	uint8_t *ptr;
+	/**
+	 * The number of dictionary bytes.
+	 */
+	size_t len;
+	/**
+	 * LZ4 state with the dictionary loaded, which is
+	 * copied instead of loading it again for every message.
+	 */
+	LZ4_stream_t *stream;
+	/**
+	 * The dictionary registered before this one.
+	 */
+	const compress_dict *next;
+};
+
+
+/**
+ * The chunks of a message compressed in parallel, each
+ * into its own slot of a buffer.
+ */
+struct compress_job {
+	/**
+	 * The whole message.
+	 */
+	const uint8_t *in;
+	/**
+	 * The size of the whole message.
+	 */
+	size_t len;
+	/**
+	 * The resolved policy.
+	 */
+	const ntru_compress_policy *policy;
+	/**
+	 * The dictionary of the policy, can be NULL.
+	 */
+	const compress_dict *dict;
+	/**
+	 * Where the slots start.
+	 */
+	uint8_t *slots;
+	/**
+	 * The size of a slot, enough for the frame of a full chunk.
+	 */
+	size_t slot_len;
+	/**
+	 * The size of the frame in each slot, 0 on failure.
+	 */
+	size_t *frame_lens;
+};
+
+/**
+ * The chunks of a frame decompressed in parallel.
+ */
+struct decompress_job {
+	/**
+	 * The whole frame.
+	 */
+	const uint8_t *in;
+	/**
+	 * Where the whole original bytes go.
+	 */
+	char *out;
+	/**
+	 * Offset of each chunk in in.
+	 */
+	size_t *in_offs;
+	/**
+	 * Size of each chunk in in.
+	 */
+	size_t *in_lens;
+	/**
+	 * Offset of each chunk in out.
+	 */
+	size_t *out_offs;
+	/**
+	 * Size of each chunk in out, set to the decompressed size,
+	 * which is 0 on failure.
+	 */
+	size_t *out_lens;
+};
+
+
+/**
+ * Protects dicts and default_policy.
+ */
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The most recently registered dictionary.
+ */
+static const compress_dict *dicts = NULL;
+
+/**
+ * The policy for callers that do not pass their own.
+ */
+static ntru_compress_policy default_policy = { NTRU_COMPRESS_FAST, 1, 0 };
+
+/**
+ * Makes sure state_key is created exactly once.
+ */
+static pthread_once_t state_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Thread-specific key of the compress_state of each thread.
+ */
+static pthread_key_t state_key;
+
+
+/**
+ * Creates state_key.
+ */
+static void
+state_init(void);
+
+/**
+ * Frees the compress_state of an exiting thread.
+ *
+ * @param arg the compress_state
+ */
+static void
+state_free(void *arg);
+
+/**
+ * Get the compress_state of the calling thread.
+ *
+ * @return the state, do not free it
+ */
+static compress_state *
+get_state(void);
+
+/**
+ * Look up a registered dictionary.
+ *
+ * @param id the id of the dictionary
+ * @return the dictionary, NULL if there is none with this id
+ */
+static const compress_dict *
+get_dict(uint32_t id);
+
+/**
+ * Estimate the entropy of a prefix of some bytes from
+ * their histogram.
+ *
+ * @param in the bytes
+ * @param len the number of bytes
+ * @return the entropy in bits per byte
+ */
+static double
+prefix_entropy(const uint8_t *in, size_t len);
+
+/**
+ * Compresses bytes into a bare LZ4 block.
+ *
+ * @param out where to store the block, LZ4_compressBound(len)
+ * bytes [out]
+ * @param in the bytes to compress
+ * @param len the number of bytes to compress
+ * @param policy how to compress, NTRU_COMPRESS_FAST or
+ * NTRU_COMPRESS_HC
+ * @param dict the dictionary to compress against, can be NULL
+ * @return the size of the block, 0 on failure
+ */
+static size_t
+compress_block(uint8_t *out,
+		const uint8_t *in,
+		size_t len,
+		const ntru_compress_policy *policy,
+		const compress_dict *dict);
+
+/**
+ * Compresses bytes into a frame without chunks.
+ *
+ * @param out where to store the frame, COMPRESS_HEADER_MAX +
+ * LZ4_compressBound(len) bytes [out]
+ * @param in the bytes to compress
+ * @param len the number of bytes to compress, at least 1
+ * @param policy how to compress, not NULL
+ * @param dict the dictionary of the policy, can be NULL
+ * @return the size of the frame, 0 on failure
+ */
+static size_t
+compress_single(uint8_t *out,
+		const uint8_t *in,
+		size_t len,
+		const ntru_compress_policy *policy,
+		const compress_dict *dict);
+
+/**
+ * Compresses the i-th chunk of a compress_job,
+ * as ntru_thread_pool_parallel_for() body.
+ *
+ * @param i the chunk index
+ * @param arg the compress_job
+ */
+static void
+compress_chunk(size_t i, void *arg);
+
+/**
+ * Parses the header of a frame without chunks, like
+ * frame_header().
+ *
+ * @param in the frame
+ * @param len the number of bytes available in in
+ * @param header_len where to store the size of the header [out]
+ * @param payload_len where to store the size of the payload [out]
+ * @param content_len where to store the size of the
+ * original bytes [out]
+ * @param stored where to store whether the payload are the
+ * original bytes [out]
+ * @param dict_id where to store the id of the dictionary [out]
+ * @return true for success, false if the header is malformed
+ * or the payload does not fit into len
+ */
+static bool
+single_header(const uint8_t *in,
+		size_t len,
+		size_t *header_len,
+		size_t *payload_len,
+		size_t *content_len,
+		bool *stored,
+		uint32_t *dict_id);
+
+/**
+ * Parses the start of a frame with chunks, three zero bytes
+ * and the number of chunks.
+ *
+ * @param in the frame
+ * @param len the number of bytes available in in
+ * @param header_len where to store the size of the start [out]
+ * @param chunk_c where to store the number of chunks [out]
+ * @return true if in is a frame with chunks, false otherwise
+ */
+static bool
+chunk_header(const uint8_t *in,
+		size_t len,
+		size_t *header_len,
+		size_t *chunk_c);
+
+/**
+ * Decompresses a frame without chunks.
+ *
+ * @param out where to store the original bytes [out]
+ * @param out_size the size of out
+ * @param in the frame
+ * @param len the number of bytes available in in
+ * @return the number of original bytes, 0 on failure
+ */
+static size_t
+decompress_single(char *out,
+		size_t out_size,
+		const uint8_t *in,
+		size_t len);
+
+/**
+ * Decompresses the i-th chunk of a decompress_job,
+ * as ntru_thread_pool_parallel_for() body.
+ *
+ * @param i the chunk index
+ * @param arg the decompress_job
+ */
+static void
+decompress_chunk(size_t i, void *arg);
+
+
+/*------------------------------------------------------------------------*/
+
+static void
+state_init(void)
+{
+	if (pthread_key_create(&state_key, state_free)) {
+		fprintf(stderr, "failed to create the compress key, aborting!");
+		abort();
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+state_free(void *arg)
+{
+	compress_state *state = arg;
+
+	if (state->fast)
+		LZ4_freeStream(state->fast);
+	free(state->hc);
+	free(state);
+}
+
+/*------------------------------------------------------------------------*/
+
+static compress_state *
+get_state(void)
+{
+	compress_state *state;
+
+	pthread_once(&state_once, state_init);
+
+	if (!(state = pthread_getspecific(state_key))) {
+		state = ntru_calloc(1, sizeof(*state));
+		pthread_setspecific(state_key, state);
+	}
+
+	return state;
+}
+
+/*------------------------------------------------------------------------*/
+
+static const compress_dict *
+get_dict(uint32_t id)
+{
+	const compress_dict *dict = NULL;
+
+	pthread_mutex_lock(&registry_lock);
+	for (dict = dicts; dict && dict->id != id; dict = dict->next)
+		;
+	pthread_mutex_unlock(&registry_lock);
+
+	return dict;
+}
+
+/*------------------------------------------------------------------------*/
+
+static double
+prefix_entropy(const uint8_t *in, size_t len)
+{
+	uint32_t hist[256] = { 0 };
+	double entropy = 0;
+
+	if (len > COMPRESS_SAMPLE_LEN)
+		len = COMPRESS_SAMPLE_LEN;
+
+	for (size_t i = 0; i < len; i++)
+		hist[in[i]]++;
+
+	for (uint32_t i = 0; i < 256; i++) {
+		if (hist[i]) {
+			double prob = (double)hist[i] / len;
+
+			entropy -= prob * log2(prob);
+		}
+	}
+
+	return entropy;
+}
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+compress_block(uint8_t *out,
+		const uint8_t *in,
+		size_t len,
+		const ntru_compress_policy *policy,
+		const compress_dict *dict)
+{
+	compress_state *state = get_state();
+	int out_len;
+
+	/* LZ4HC is only used without dictionary */
+	if (policy->mode == NTRU_COMPRESS_HC && !dict) {
+		if (!state->hc)
+			state->hc = ntru_malloc(LZ4_sizeofStateHC());
+
+		out_len = LZ4_compress_HC_extStateHC(state->hc,
+				(const char *)in, (char *)out, len,
+				LZ4_compressBound(len),
+				policy->level ? policy->level : LZ4HC_CLEVEL_DEFAULT);
+	} else {
+		if (!state->fast) {
+			if (!(state->fast = LZ4_createStream())) {
+				fprintf(stderr, "failed to allocate memory, aborting!");
+				abort();
+			}
+		} else if (!dict) {
+			/* much cheaper than the full reset of a new state */
+			LZ4_resetStream_fast(state->fast);
+		}
+
+		if (dict)
+			memcpy(state->fast, dict->stream, sizeof(*state->fast));
+
+		/* the level of NTRU_COMPRESS_HC is no acceleration,
+		 * a high one would give the worst ratio instead of the
+		 * best, so HC with a dictionary uses the best LZ4 can */
+		out_len = LZ4_compress_fast_continue(state->fast,
+				(const char *)in, (char *)out, len,
+				LZ4_compressBound(len),
+				policy->mode != NTRU_COMPRESS_HC && policy->level > 0 ?
+				policy->level : 1);
+	}
+
+	return out_len > 0 ? (size_t)out_len : 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_compress_dict_add(uint32_t id, const void *dict, size_t len)
+{
+	compress_dict *entry;
+	const compress_dict *known;
+	const uint8_t *bytes = dict;
+
+	if (!dict && len)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!id)
+		return false;
+
+	/* LZ4 only refers back 64 KiB */
+	if (len > COMPRESS_DICT_MAX) {
+		bytes += len - COMPRESS_DICT_MAX;
+		len = COMPRESS_DICT_MAX;
+	}
+
+	if ((known = get_dict(id)))
+		return known->len == len && !memcmp(known->ptr, bytes, len);
+
+	entry = ntru_malloc(sizeof(*entry));
+	entry->id = id;
+	entry->len = len;
+	entry->ptr = ntru_malloc(len ? len : 1);
+	memcpy(entry->ptr, bytes, len);
+	if (!(entry->stream = LZ4_createStream())) {
+		fprintf(stderr, "failed to allocate memory, aborting!");
+		abort();
+	}
+	LZ4_loadDict(entry->stream, (const char *)entry->ptr, len);
+
+	pthread_mutex_lock(&registry_lock);
+	/* another thread may have been faster */
+	for (known = dicts; known && known->id != id; known = known->next)
+		;
+	if (!known) {
+		entry->next = dicts;
+		dicts = entry;
+	}
+	pthread_mutex_unlock(&registry_lock);
+
+	if (known) {
+		LZ4_freeStream(entry->stream);
+		free(entry->ptr);
+		free(entry);
+		return known->len == len && !memcmp(known->ptr, bytes, len);
+	}
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_set_compress_policy(const ntru_compress_policy *policy)
+{
+	const ntru_compress_policy fast = { NTRU_COMPRESS_FAST, 1, 0 };
+
+	if (!policy)
+		policy = &fast;
+
+	if (policy->dict_id && !get_dict(policy->dict_id))
+		return false;
+
+	pthread_mutex_lock(&registry_lock);
+	default_policy = *policy;
+	pthread_mutex_unlock(&registry_lock);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+compress_bound(size_t len)
+{
+	size_t chunk_c;
+
+	if (len > LZ4_MAX_INPUT_SIZE)
+		return 0;
+
+	if (len <= COMPRESS_CHUNK_LEN)
+		return COMPRESS_HEADER_MAX + LZ4_compressBound(len);
+
+	/* the chunks are compressed into slots behind the largest header */
+	chunk_c = (len + COMPRESS_CHUNK_LEN - 1) / COMPRESS_CHUNK_LEN;
+	return 3 + VARINT_MAX_LEN + chunk_c *
+		(COMPRESS_HEADER_MAX + LZ4_compressBound(COMPRESS_CHUNK_LEN));
+}
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+compress_single(uint8_t *out,
+		const uint8_t *in,
+		size_t len,
+		const ntru_compress_policy *policy,
+		const compress_dict *dict)
+{
+	uint8_t *payload = out + COMPRESS_HEADER_MAX;
+	size_t payload_len = 0,
+		   header_len;
+	bool stored;
+
+	stored = policy->mode == NTRU_COMPRESS_NONE ||
+		(policy->mode == NTRU_COMPRESS_AUTO &&
+		 prefix_entropy(in, len) > COMPRESS_MAX_ENTROPY);
+
+	if (!stored) {
+		payload_len = compress_block(payload, in, len, policy, dict);
+		if (!payload_len)
+			return 0;
+
+		/* compression did not pay off */
+		stored = policy->mode == NTRU_COMPRESS_AUTO && payload_len >= len;
+	}
+
+	if (stored) {
+		payload_len = len;
+		memcpy(payload, in, len);
+	}
+
+	/* the header goes right in front of the payload, a payload
+	 * length of 0, which LZ4 never produces, means stored */
+	if (stored || !dict) {
+		header_len = varint_len(stored ? 0 : payload_len) + varint_len(len);
+		memmove(out + header_len, payload, payload_len);
+		put_varint(out + put_varint(out, stored ? 0 : payload_len), len);
+
+		return header_len + payload_len;
+	}
+
+	/* two zero lengths introduce the dictionary id */
+	header_len = 2 + varint_len(dict->id) + varint_len(payload_len) +
+		varint_len(len);
+	memmove(out + header_len, payload, payload_len);
+	out[0] = 0;
+	out[1] = 0;
+	out += 2;
+	out += put_varint(out, dict->id);
+	out += put_varint(out, payload_len);
+	put_varint(out, len);
+
+	return header_len + payload_len;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+compress_chunk(size_t i, void *arg)
+{
+	compress_job *job = arg;
+	size_t off = i * COMPRESS_CHUNK_LEN,
+		   len = job->len - off;
+
+	if (len > COMPRESS_CHUNK_LEN)
+		len = COMPRESS_CHUNK_LEN;
+
+	job->frame_lens[i] = compress_single(job->slots + i * job->slot_len,
+			job->in + off, len, job->policy, job->dict);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+compress_frame(uint8_t *out,
+		const uint8_t *in,
+		size_t len,
+		const ntru_compress_policy *policy,
+		ntru_thread_pool *pool)
+{
+	ntru_compress_policy dflt;
+	const compress_dict *dict = NULL;
+	compress_job job;
+	size_t chunk_c,
+		   header_len,
+		   frame_len;
+
+	if (!out || !in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!len || len > LZ4_MAX_INPUT_SIZE)
+		return 0;
+
+	if (!policy) {
+		pthread_mutex_lock(&registry_lock);
+		dflt = default_policy;
+		pthread_mutex_unlock(&registry_lock);
+		policy = &dflt;
+	}
+
+	if (policy->dict_id && !(dict = get_dict(policy->dict_id)))
+		return 0;
+
+	if (len <= COMPRESS_CHUNK_LEN)
+		return compress_single(out, in, len, policy, dict);
+
+	chunk_c = (len + COMPRESS_CHUNK_LEN - 1) / COMPRESS_CHUNK_LEN;
+	job.in = in;
+	job.len = len;
+	job.policy = policy;
+	job.dict = dict;
+	job.slots = out + 3 + VARINT_MAX_LEN;
+	job.slot_len = COMPRESS_HEADER_MAX +
+		LZ4_compressBound(COMPRESS_CHUNK_LEN);
+	job.frame_lens = ntru_malloc(sizeof(*job.frame_lens) * chunk_c);
+
+	/* the chunks are independent, so each can go to another thread */
+	ntru_thread_pool_parallel_for(pool, chunk_c, compress_chunk, &job);
+
+	/* three zero bytes introduce the number of chunks */
+	out[0] = 0;
+	out[1] = 0;
+	out[2] = 0;
+	frame_len = header_len = 3 + put_varint(out + 3, chunk_c);
+
+	/* the slots only move towards the front */
+	for (size_t i = 0; i < chunk_c && frame_len; i++) {
+		if (job.frame_lens[i]) {
+			memmove(out + frame_len, job.slots + i * job.slot_len,
+					job.frame_lens[i]);
+			frame_len += job.frame_lens[i];
+		} else {
+			frame_len = 0;
+		}
+	}
+
+	free(job.frame_lens);
+
+	return frame_len;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+single_header(const uint8_t *in,
+		size_t len,
+		size_t *header_len,
+		size_t *payload_len,
+		size_t *content_len,
+		bool *stored,
+		uint32_t *dict_id)
+{
+	uint64_t payload,
+			 content,
+			 id = 0;
+	size_t k,
+		   l,
+		   h = 0;
+
+	/* two zero lengths, then the dictionary id and the real header */
+	if (len > 2 && !in[0] && !in[1]) {
+		if (!(k = get_varint(in + 2, len - 2, &id)) || !id ||
+				id > UINT32_MAX)
+			return false;
+		h = 2 + k;
+	}
+
+	if (!(k = get_varint(in + h, len - h, &payload)) ||
+			!(l = get_varint(in + h + k, len - h - k, &content)))
+		return false;
+
+	*stored = !payload;
+	if (*stored) {
+		if (id)
+			return false;
+		payload = content;
+	}
+
+	/* LZ4 cannot handle more in one piece, nor expand a byte
+	 * into more than 255 */
+	if (payload > len - h - k - l || payload > INT_MAX ||
+			!content || content > LZ4_MAX_INPUT_SIZE ||
+			(!*stored && content > 255 * payload + 16))
+		return false;
+
+	*header_len = h + k + l;
+	*payload_len = payload;
+	*content_len = content;
+	*dict_id = id;
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+chunk_header(const uint8_t *in,
+		size_t len,
+		size_t *header_len,
+		size_t *chunk_c)
+{
+	uint64_t count;
+	size_t k;
+
+	if (len < 4 || in[0] || in[1] || in[2] ||
+			!(k = get_varint(in + 3, len - 3, &count)))
+		return false;
+
+	/* a single chunk is never split, every chunk needs at
+	 * least three bytes */
+	if (count < 2 || count > (len - 3 - k) / 3)
+		return false;
+
+	*header_len = 3 + k;
+	*chunk_c = count;
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+frame_header(const uint8_t *in,
+		size_t len,
+		size_t *header_len,
+		size_t *payload_len,
+		size_t *content_len,
+		bool *stored,
+		uint32_t *dict_id)
+{
+	size_t chunk_c,
+		   off,
+		   h,
+		   payload,
+		   content,
+		   total = 0;
+	uint32_t id;
+	bool chunk_stored;
+
+	if (!in || !header_len || !payload_len || !content_len || !stored ||
+			!dict_id)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!chunk_header(in, len, header_len, &chunk_c))
+		return single_header(in, len, header_len, payload_len, content_len,
+				stored, dict_id);
+
+	/* the chunks follow each other, each with its own header, all
+	 * but the last one hold exactly COMPRESS_CHUNK_LEN bytes, so
+	 * the frame cannot claim more than its chunks can hold */
+	off = *header_len;
+	for (size_t i = 0; i < chunk_c; i++) {
+		if (!single_header(in + off, len - off, &h, &payload, &content,
+					&chunk_stored, &id) || content > COMPRESS_CHUNK_LEN ||
+				(i + 1 < chunk_c && content != COMPRESS_CHUNK_LEN))
+			return false;
+		off += h + payload;
+		total += content;
+	}
+
+	*payload_len = off - *header_len;
+	*content_len = total;
+	*stored = false;
+	*dict_id = 0;
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+decompress_single(char *out,
+		size_t out_size,
+		const uint8_t *in,
+		size_t len)
+{
+	const compress_dict *dict = NULL;
+	size_t header_len,
+		   payload_len,
+		   content_len;
+	uint32_t dict_id;
+	bool stored;
+	int out_len;
+
+	if (!single_header(in, len, &header_len, &payload_len, &content_len,
+				&stored, &dict_id) || content_len > out_size)
+		return 0;
+
+	if (stored) {
+		memcpy(out, in + header_len, content_len);
+		return content_len;
+	}
+
+	if (dict_id && !(dict = get_dict(dict_id)))
+		return 0;
+
+	if (dict)
+		out_len = LZ4_decompress_safe_usingDict((const char *)in + header_len,
+				out, payload_len, content_len,
+				(const char *)dict->ptr, dict->len);
+	else
+		out_len = LZ4_decompress_safe((const char *)in + header_len, out,
+				payload_len, content_len);
+
+	if (out_len != (int)content_len)
+		return 0;
+
+	return content_len;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+decompress_chunk(size_t i, void *arg)
+{
+	decompress_job *job = arg;
+
+	job->out_lens[i] = decompress_single(job->out + job->out_offs[i],
+			job->out_lens[i], job->in + job->in_offs[i], job->in_lens[i]);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+decompress_frame_into(char *out,
+		size_t out_size,
+		const uint8_t *in,
+		size_t len,
+		ntru_thread_pool *pool)
+{
+	decompress_job job;
+	size_t header_len,
+		   payload_len,
+		   content_len,
+		   chunk_c,
+		   h,
+		   in_off,
+		   out_off = 0;
+	uint32_t dict_id;
+	bool stored;
+
+	if (!out || !in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!frame_header(in, len, &header_len, &payload_len, &content_len,
+				&stored, &dict_id) || content_len > out_size)
+		return 0;
+
+	if (!chunk_header(in, len, &header_len, &chunk_c))
+		return decompress_single(out, out_size, in, len);
+
+	job.in = in;
+	job.out = out;
+	job.in_offs = ntru_malloc(sizeof(*job.in_offs) * 4 * chunk_c);
+	job.in_lens = job.in_offs + chunk_c;
+	job.out_offs = job.in_offs + 2 * chunk_c;
+	job.out_lens = job.in_offs + 3 * chunk_c;
+
+	/* frame_header() already checked all chunk headers */
+	in_off = header_len;
+	for (size_t i = 0; i < chunk_c; i++) {
+		single_header(in + in_off, len - in_off, &h, &payload_len,
+				&job.out_lens[i], &stored, &dict_id);
+		job.in_offs[i] = in_off;
+		job.in_lens[i] = h + payload_len;
+		job.out_offs[i] = out_off;
+		in_off += h + payload_len;
+		out_off += job.out_lens[i];
+	}
+
+	/* every chunk is written to its own part of out */
+	ntru_thread_pool_parallel_for(pool, chunk_c, decompress_chunk, &job);
+
+	for (size_t i = 0; i < chunk_c; i++)
+		if (!job.out_lens[i])
+			content_len = 0;
+
+	free(job.in_offs);
+
+	return content_len;
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+decompress_frame(const uint8_t *in, size_t len, ntru_thread_pool *pool)
+{
+	size_t header_len,
+		   payload_len,
+		   content_len;
+	uint32_t dict_id;
+	bool stored;
+	string *result;
+
+	if (!in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!frame_header(in, len, &header_len, &payload_len, &content_len,
+				&stored, &dict_id))
+		return NULL;
+
+	result = ntru_malloc(sizeof(*result));
+	result->ptr = ntru_malloc(content_len);
+	result->len = decompress_frame_into(result->ptr, content_len, in, len,
+			pool);
+
+	if (!result->len) {
+		string_delete(result);
+		return NULL;
+	}
+
+	return result;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_compress.h
+ * Header for the internal API of ntru_compress.c.
+ * @brief header for ntru_compress.c
+ */
+
+#ifndef NTRU_COMPRESS_H
+#define NTRU_COMPRESS_H
+
+
+#include "ntru_common.h"
+#include "ntru_params.h"
+#include "ntru_string.h"
+#include "ntru_threadpool.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Maximum size of the header of a compressed frame,
+ * see compress_frame().
+ */
+#define COMPRESS_HEADER_MAX (2 + 3 * VARINT_MAX_LEN)
+
+/**
+ * Maximum size of a dictionary, LZ4 does not look
+ * further back.
+ */
+#define COMPRESS_DICT_MAX (64 * 1024)
+
+/**
+ * Messages larger than this are split into independent
+ * chunks of this size, which are compressed and decompressed
+ * in parallel.
+ */
+#define COMPRESS_CHUNK_LEN (1024 * 1024)
+
+/**
+ * Number of leading bytes NTRU_COMPRESS_AUTO estimates
+ * the entropy of.
+ */
+#define COMPRESS_SAMPLE_LEN 4096
+
+/**
+ * Entropy in bits per byte above which NTRU_COMPRESS_AUTO
+ * stores a message instead of compressing it. Already
+ * compressed data is close to 8.
+ */
+#define COMPRESS_MAX_ENTROPY 7.5
+
+
+/**
+ * Registers a preshared dictionary for compression, see
+ * ntru_compress_dict_add() in the public API.
+ *
+ * @param id the id of the dictionary, not 0
+ * @param dict the dictionary, only the last COMPRESS_DICT_MAX
+ * bytes are used
+ * @param len the size of dict
+ * @return true for success, false if the id is 0 or already
+ * registered with different content
+ */
+bool
+ntru_compress_dict_add(uint32_t id, const void *dict, size_t len);
+
+/**
+ * Sets the policy compress_frame() uses if it gets none, see
+ * ntru_set_compress_policy() in the public API.
+ *
+ * @param policy the new default, NULL to reset it to
+ * NTRU_COMPRESS_FAST with acceleration 1
+ * @return true for success, false if its dictionary is
+ * not registered
+ */
+bool
+ntru_set_compress_policy(const ntru_compress_policy *policy);
+
+/**
+ * Maximum size of the compressed frame of len bytes.
+ *
+ * @param len the number of bytes to compress
+ * @return the size in bytes, 0 if len is too large for LZ4
+ */
+size_t
+compress_bound(size_t len);
+
+/**
+ * Compresses bytes with LZ4 into a frame, which starts with
+ * the length of the LZ4 payload and the length of the original
+ * bytes, both as varint. A payload length of 0 means that the
+ * original bytes follow as they are. If a dictionary was used,
+ * both lengths are 0 and followed by the dictionary id and
+ * then the real lengths. Messages larger than COMPRESS_CHUNK_LEN
+ * are split into chunks, each compressed into such a frame, which
+ * follow three zero bytes and the number of chunks as varint. The
+ * chunks are spread over pool. The LZ4 states are kept per
+ * thread and reused by the next call, so repeated calls do not
+ * set them up from scratch.
+ *
+ * @param out where to store the frame, compress_bound(len)
+ * bytes [out]
+ * @param in the bytes to compress
+ * @param len the number of bytes to compress, at least 1
+ * @param policy how to compress, NULL for the policy set
+ * with ntru_set_compress_policy()
+ * @param pool the thread pool for the chunks, can be NULL
+ * @return the size of the frame, 0 on failure or if the
+ * dictionary of the policy is not registered
+ */
+size_t
+compress_frame(uint8_t *out,
+		const uint8_t *in,
+		size_t len,
+		const ntru_compress_policy *policy,
+		ntru_thread_pool *pool);
+
+/**
+ * Parses the header of a frame created by compress_frame().
+ * Anything behind the payload is ignored, so the frame can
+ * be followed by padding. For a frame with chunks, the header
+ * is the number of chunks and the payload are the chunks.
+ *
+ * @param in the frame
+ * @param len the number of bytes available in in
+ * @param header_len where to store the size of the header [out]
+ * @param payload_len where to store the size of the LZ4 payload
+ * that follows the header [out]
+ * @param content_len where to store the size of the
+ * original bytes [out]
+ * @param stored where to store whether the payload are the
+ * original bytes, not compressed, always false with chunks [out]
+ * @param dict_id where to store the id of the dictionary,
+ * 0 for none or with chunks [out]
+ * @return true for success, false if the header is malformed
+ * or the payload does not fit into len
+ */
+bool
+frame_header(const uint8_t *in,
+		size_t len,
+		size_t *header_len,
+		size_t *payload_len,
+		size_t *content_len,
+		bool *stored,
+		uint32_t *dict_id);
+
+/**
+ * Decompresses a frame created by compress_frame() into a
+ * buffer. The chunks of a frame are spread over pool.
+ *
+ * @param out where to store the original bytes [out]
+ * @param out_size the size of out
+ * @param in the frame
+ * @param len the number of bytes available in in
+ * @param pool the thread pool for the chunks, can be NULL
+ * @return the number of original bytes, 0 on failure, if
+ * they do not fit into out or if the dictionary is not
+ * registered
+ */
+size_t
+decompress_frame_into(char *out,
+		size_t out_size,
+		const uint8_t *in,
+		size_t len,
+		ntru_thread_pool *pool);
+
+/**
+ * Decompresses a frame created by compress_frame(), the
+ * result is allocated exactly once in its final size.
+ *
+ * @param in the frame
+ * @param len the number of bytes available in in
+ * @param pool the thread pool for the chunks, can be NULL
+ * @return the original bytes, newly allocated, NULL on failure
+ */
+string *
+decompress_frame(const uint8_t *in, size_t len, ntru_thread_pool *pool);
+
+
+#endif /* NTRU_COMPRESS_H */
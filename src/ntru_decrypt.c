@@ -27,13 +27,19 @@
  */
 
 #include "ntru_ascii_poly.h"
+#include "ntru_base64.h"
+#include "ntru_common.h"
+#include "ntru_compress.h"
 #include "ntru_decrypt.h"
 #include "ntru_mem.h"
+#include "ntru_packed.h"
 #include "ntru_params.h"
 #include "ntru_poly.h"
 #include "ntru_poly_ascii.h"
 #include "ntru_string.h"
+#include "ntru_threadpool.h"
 
+#include <limits.h>
 #include <lz4.h>
 #include <stdbool.h>
 #include <string.h>
@@ -42,51 +48,261 @@
 #include <fmpz.h>
 
 
+typedef struct decrypt_job decrypt_job;
+
+
 /**
- * Decompress a string and return it, newly allocated.
+ * The blocks of one message, decrypted by
+ * decrypt_block() in parallel.
+ */
+struct decrypt_job {
+	/**
+	 * The encrypted blocks, decrypted in place.
+	 */
+	fmpz_poly_t **blocks;
+	/**
+	 * The private key.
+	 */
+	const fmpz_poly_struct *priv_key;
+	/**
+	 * The inverse of the private key.
+	 */
+	const fmpz_poly_struct *priv_key_inv;
+	/**
+	 * The NTRU context.
+	 */
+	const ntru_params *params;
+};
+
+
+/**
+ * Decompress a bare LZ4 block of the unframed format, whose
+ * original size is not known, and return it, newly allocated.
  *
  * @param compr_str the compressed string to decompress
- * @return the decompressed string, newly allocated
+ * @return the decompressed string, newly allocated, NULL if
+ * it is not valid LZ4
  */
 static string *
 get_decompressed_str(const string *compr_str);
 
+/**
+ * Decrypts the i-th block of a decrypt_job,
+ * as ntru_thread_pool_parallel_for() body.
+ *
+ * @param i the block index
+ * @param arg the decrypt_job
+ */
+static void
+decrypt_block(size_t i, void *arg);
+
+/**
+ * Splits the encrypted string into blocks, decrypts them
+ * spread over pool and decompresses the result.
+ *
+ * @param encr_msg the encrypted message in the form of a string
+ * @param priv_key the private key
+ * @param priv_key_inv the inverse of the private key
+ * @param params the NTRU context
+ * @param pool the thread pool, can be NULL
+ * @param encoding how the message is mapped to the blocks
+ * @return the decrypted string or NULL on failure
+ */
+static string *
+decrypt_string(const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		ntru_thread_pool *pool,
+		ntru_msg_encoding encoding);
+
+/**
+ * Decrypts into a caller-provided buffer, see
+ * ntru_decrypt_string_into(). The private key comes either
+ * from polynomials or from mapped coefficient arrays.
+ *
+ * @param encr_msg the encrypted message
+ * @param priv_key the private key, or NULL to use priv_coeffs
+ * @param priv_key_inv the inverse of the private key
+ * @param priv_coeffs the little endian coefficients of the
+ * private key, used if priv_key is NULL
+ * @param priv_inv_coeffs the little endian coefficients of its
+ * inverse, used if priv_key is NULL
+ * @param params the NTRU context
+ * @param out where to store the decrypted message [out]
+ * @param out_size the size of out
+ * @return the length of the decrypted message, 0 on failure
+ */
+static size_t
+decrypt_string_into(const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const int16_t *priv_coeffs,
+		const int16_t *priv_inv_coeffs,
+		const ntru_params *params,
+		char *out,
+		size_t out_size);
+
 
 /*------------------------------------------------------------------------*/
 
 static string *
 get_decompressed_str(const string *compr_str)
 {
-	int out_len = 0;
-	const uint32_t max_lz4_ratio = 3;
-	uint32_t max_out_len = 0;
+	int out_len = -1;
+	size_t max_out_len;
 	string *decompressed_msg = NULL;
 
 	if (!compr_str)
 		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
 
-	max_out_len = compr_str->len * max_lz4_ratio;
+	if (!compr_str->len || compr_str->len > INT_MAX)
+		return NULL;
+
 	decompressed_msg = ntru_malloc(sizeof(string));
-	decompressed_msg->ptr = ntru_malloc(
-			/* this is more than needed, but safe */
-			sizeof(char) * max_out_len);
-
-	out_len = LZ4_decompress_safe(
-			(const char *)compr_str->ptr,
-			decompressed_msg->ptr,
-			compr_str->len,
-			max_out_len);
-
-	if (out_len > 0)
-		decompressed_msg->len = out_len;
-	else
-		NTRU_ABORT_DEBUG("Failed decompressing the message");
+	decompressed_msg->ptr = NULL;
+
+	/* the size is not stored, so grow up to the LZ4 maximum ratio */
+	for (max_out_len = compr_str->len * 4; out_len < 0;
+			max_out_len *= 4) {
+		if (max_out_len > INT_MAX)
+			max_out_len = INT_MAX;
+
+		free(decompressed_msg->ptr);
+		decompressed_msg->ptr = ntru_malloc(max_out_len);
+		out_len = LZ4_decompress_safe(
+				(const char *)compr_str->ptr,
+				decompressed_msg->ptr,
+				compr_str->len,
+				max_out_len);
+
+		if (max_out_len >= compr_str->len * 255 ||
+				max_out_len == INT_MAX)
+			break;
+	}
+
+	if (out_len <= 0) {
+		string_delete(decompressed_msg);
+		return NULL;
+	}
+	decompressed_msg->len = out_len;
 
 	return decompressed_msg;
 }
 
 /*------------------------------------------------------------------------*/
 
+static void
+decrypt_block(size_t i, void *arg)
+{
+	decrypt_job *job = arg;
+
+	ntru_decrypt_poly(*job->blocks[i],
+			*job->blocks[i],
+			job->priv_key,
+			job->priv_key_inv,
+			job->params);
+}
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+decrypt_string_into(const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const int16_t *priv_coeffs,
+		const int16_t *priv_inv_coeffs,
+		const ntru_params *params,
+		char *out,
+		size_t out_size)
+{
+	const uint32_t N = params->N;
+	int32_t *f,
+			*fp,
+			*e,
+			*d,
+			*tmp;
+	int8_t *coeffs;
+	uint8_t *raw,
+			*compressed;
+	size_t raw_max,
+		   compressed_max,
+		   raw_len,
+		   bytes,
+		   header_len,
+		   payload_len,
+		   content_len,
+		   scratch_len,
+		   result = 0;
+	uint32_t dict_id;
+	bool stored;
+
+	/* the string format has one byte per coefficient */
+	if (params->q > 256)
+		return 0;
+
+	raw_max = (encr_msg->len + 3) / 4 * 3;
+	compressed_max = ntru_decrypt_bound(encr_msg->len, params) / 255;
+	scratch_len = sizeof(*f) * 6 * N + N + raw_max + compressed_max;
+	f = ntru_scratch(scratch_len);
+	fp = f + N;
+	e = f + 2 * N;
+	d = f + 3 * N;
+	tmp = f + 4 * N;
+	coeffs = (int8_t *)(f + 6 * N);
+	raw = (uint8_t *)(coeffs + N);
+	compressed = raw + raw_max;
+
+	if (!base64_decode(raw, &raw_len, encr_msg->ptr, encr_msg->len))
+		goto cleanup;
+
+	if (priv_key) {
+		poly_get_residues(f, priv_key, params, params->q);
+		poly_get_residues(fp, priv_key_inv, params, params->q);
+	} else {
+		poly_get_residues_le16(f, priv_coeffs, params, params->q);
+		poly_get_residues_le16(fp, priv_inv_coeffs, params, params->q);
+	}
+
+	/* valid ciphertexts consist of full blocks only */
+	if (!raw_len || raw_len % N)
+		goto cleanup;
+
+	memset(compressed, 0, compressed_max);
+
+	for (size_t i = 0; i < raw_len; i += N) {
+		for (uint32_t k = 0; k < N; k++)
+			e[k] = raw[i + k] % params->q;
+
+		poly_decrypt_kernel(d, tmp, f, e, fp, params);
+
+		/* the padding decrypts to zeros, which become 0 bits */
+		for (uint32_t k = 0; k < N; k++)
+			coeffs[k] = (int8_t)d[k];
+
+		bin_coeffs_to_bytes(compressed, coeffs, i, N);
+	}
+
+	bytes = raw_len / 8;
+	if (!frame_header(compressed, bytes, &header_len, &payload_len,
+				&content_len, &stored, &dict_id))
+		goto cleanup;
+
+	/* the last block has to carry payload */
+	if ((header_len + payload_len) * ASCII_BITS <= raw_len - N)
+		goto cleanup;
+
+	result = decompress_frame_into(out, out_size, compressed, bytes, NULL);
+
+cleanup:
+	/* the private key and the compressed plaintext */
+	ntru_scratch_release(scratch_len);
+
+	return result;
+}
+
+/*------------------------------------------------------------------------*/
+
 void
 ntru_decrypt_poly(
 		fmpz_poly_t out_bin,
@@ -95,40 +311,30 @@ ntru_decrypt_poly(
 		const fmpz_poly_t priv_key_inv,
 		const ntru_params *params)
 {
-	fmpz_poly_t a,
-				priv_key_tmp,
-				priv_key_inv_tmp,
-				encr_msg_tmp;
+	int32_t *buf,
+			*f,
+			*e,
+			*fp,
+			*tmp;
 
 	if (!encr_msg || !priv_key || !priv_key_inv || !out_bin || !params)
 		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
 
-	fmpz_poly_init(a);
-	fmpz_poly_zero(a);
+	buf = ntru_malloc(sizeof(*buf) * params->N * 6);
+	f = buf + params->N;
+	e = buf + 2 * params->N;
+	fp = buf + 3 * params->N;
+	tmp = buf + 4 * params->N;
 
-	/*
-	 * make sure all are shifted to
-	 * [-q/2, q/2]
-	 */
-	fmpz_poly_init(priv_key_tmp);
-	fmpz_poly_init(priv_key_inv_tmp);
-	fmpz_poly_init(encr_msg_tmp);
-	fmpz_poly_set(priv_key_tmp, priv_key);
-	fmpz_poly_set(priv_key_inv_tmp, priv_key_inv);
-	fmpz_poly_set(encr_msg_tmp, encr_msg);
-	fmpz_poly_mod(priv_key_tmp, params->q);
-	fmpz_poly_mod(priv_key_inv_tmp, params->q);
-	fmpz_poly_mod(encr_msg_tmp, params->q);
-
-	poly_starmultiply(a, priv_key_tmp, encr_msg_tmp, params, params->q);
-	fmpz_poly_mod(a, params->q);
-	poly_starmultiply(out_bin, a, priv_key_inv_tmp, params, params->p);
-	fmpz_poly_mod(out_bin, params->p);
-
-	fmpz_poly_clear(a);
-	fmpz_poly_clear(priv_key_tmp);
-	fmpz_poly_clear(priv_key_inv_tmp);
-	fmpz_poly_clear(encr_msg_tmp);
+	/* all inputs are loaded first, which allows aliasing */
+	poly_get_residues(f, priv_key, params, params->q);
+	poly_get_residues(e, encr_msg, params, params->q);
+	poly_get_residues(fp, priv_key_inv, params, params->q);
+
+	poly_decrypt_kernel(buf, tmp, f, e, fp, params);
+	poly_set_int_arr(out_bin, buf, params);
+
+	free(buf);
 }
 
 /*------------------------------------------------------------------------*/
@@ -140,34 +346,166 @@ ntru_decrypt_string(
 		const fmpz_poly_t priv_key_inv,
 		const ntru_params *params)
 {
-	uint32_t i = 0;
+	return ntru_decrypt_string_parallel(encr_msg, priv_key, priv_key_inv,
+			params, NULL);
+}
+
+/*------------------------------------------------------------------------*/
+
+static string *
+decrypt_string(const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		ntru_thread_pool *pool,
+		ntru_msg_encoding encoding)
+{
+	uint32_t n = 0;
 	string *decr_msg;
-	fmpz_poly_t **poly_array;
 	string *decompressed_msg = NULL;
+	size_t orig_len = 0;
+	decrypt_job job;
 
-	if (!encr_msg || !encr_msg->len)
-		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+	if (is_packed(encr_msg)) {
+		ntru_packed_header header;
 
-	poly_array = base64_to_poly_arr(encr_msg, params);
+		job.blocks = packed_to_poly_arr(encr_msg, params, &header);
+		if (!job.blocks)
+			return NULL;
 
-	while (*poly_array[i]) {
-		ntru_decrypt_poly(*poly_array[i],
-					*poly_array[i],
-					priv_key,
-					priv_key_inv,
-					params);
-		i++;
+		/* the header knows better than the caller */
+		encoding = header.encoding;
+		orig_len = header.msg_len;
+	} else {
+		job.blocks = base64_to_poly_arr(encr_msg, params);
+		if (!job.blocks)
+			return NULL;
 	}
+	job.priv_key = priv_key;
+	job.priv_key_inv = priv_key_inv;
+	job.params = params;
+
+	while (*job.blocks[n])
+		n++;
+
+	/* every block is written to its own slot, so order is kept */
+	ntru_thread_pool_parallel_for(pool, n, decrypt_block, &job);
 
-	decr_msg = bin_poly_arr_to_ascii((const fmpz_poly_t **)poly_array,
-			i, params);
+	if (encoding == NTRU_MSG_TERNARY)
+		decr_msg = tern_poly_arr_to_ascii(
+				(const fmpz_poly_t **)job.blocks, n, params);
+	else
+		decr_msg = bin_poly_arr_to_ascii((const fmpz_poly_t **)job.blocks,
+				n, params);
+
+	/* everything behind the frame is padding */
+	if (decr_msg && encoding != NTRU_MSG_BINARY_UNFRAMED)
+		decompressed_msg = decompress_frame(
+				(const uint8_t *)decr_msg->ptr, decr_msg->len, pool);
+	else if (decr_msg)
+		decompressed_msg = get_decompressed_str(decr_msg);
 
-	decompressed_msg = get_decompressed_str(decr_msg);
+	if (decompressed_msg && orig_len && decompressed_msg->len != orig_len) {
+		string_delete(decompressed_msg);
+		decompressed_msg = NULL;
+	}
 
-	poly_delete_array(poly_array);
-	string_delete(decr_msg);
+	poly_delete_array(job.blocks);
+	if (decr_msg)
+		string_delete(decr_msg);
 
 	return decompressed_msg;
 }
 
 /*------------------------------------------------------------------------*/
+
+string *
+ntru_decrypt_string_parallel(
+		const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		ntru_thread_pool *pool)
+{
+	if (!encr_msg || !encr_msg->len)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return decrypt_string(encr_msg, priv_key, priv_key_inv, params, pool,
+			NTRU_MSG_BINARY);
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_decrypt_string_encoded(
+		const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		ntru_msg_encoding encoding)
+{
+	if (!encr_msg || !encr_msg->len)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return decrypt_string(encr_msg, priv_key, priv_key_inv, params, NULL,
+			encoding);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_decrypt_bound(size_t enc_len, const ntru_params *params)
+{
+	size_t raw_len,
+		   compressed_len;
+
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	raw_len = (enc_len + 3) / 4 * 3;
+	compressed_len = ((raw_len + params->N - 1) / params->N * params->N +
+			ASCII_BITS - 1) / ASCII_BITS;
+
+	/* a LZ4 sequence expands to at most 255 times its size */
+	return compressed_len * 255;
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_decrypt_string_into(
+		const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		char *out,
+		size_t out_size)
+{
+	if (!encr_msg || !encr_msg->len || !priv_key || !priv_key_inv ||
+			!params || !out)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return decrypt_string_into(encr_msg, priv_key, priv_key_inv, NULL, NULL,
+			params, out, out_size);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_decrypt_string_into_mapped(
+		const string *encr_msg,
+		const int16_t *priv_coeffs,
+		const int16_t *priv_inv_coeffs,
+		const ntru_params *params,
+		char *out,
+		size_t out_size)
+{
+	if (!encr_msg || !encr_msg->len || !priv_coeffs || !priv_inv_coeffs ||
+			!params || !out)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return decrypt_string_into(encr_msg, NULL, NULL, priv_coeffs,
+			priv_inv_coeffs, params, out, out_size);
+}
+
+/*------------------------------------------------------------------------*/
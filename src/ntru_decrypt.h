@@ -31,6 +31,7 @@
 #include "ntru_params.h"
 #include "ntru_poly.h"
 #include "ntru_string.h"
+#include "ntru_threadpool.h"
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
@@ -57,7 +58,30 @@ ntru_decrypt_poly(
 		const ntru_params *params);
 
 /**
- * Decryption of a given encrypted string.
+ * Decryption of a given encrypted string like
+ * ntru_decrypt_string(), but the blocks are decrypted
+ * in parallel on pool.
+ *
+ * @param encr_msg the encrypted message in the form of a string
+ * @param priv_key the polynomial containing the private key to decrypt
+ * 		the message
+ * @param priv_key_inv the inverse polynome to the private key
+ * @param params the ntru_params
+ * @param pool the thread pool, can be NULL to decrypt
+ * in the calling thread
+ * @return the decrypted string
+ */
+string *
+ntru_decrypt_string_parallel(
+		const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		ntru_thread_pool *pool);
+
+/**
+ * Decryption of a given encrypted string, either in base64
+ * or in the packed format of ntru_encrypt_string_packed().
  *
  * @param encr_msg the encrypted message in the form of a string
  * @param priv_key the polynomial containing the private key to decrypt
@@ -74,4 +98,96 @@ ntru_decrypt_string(
 		const ntru_params *params);
 
 
+/**
+ * Decryption of a given encrypted string like
+ * ntru_decrypt_string(), for a message that was encrypted
+ * by ntru_encrypt_string_encoded() with the given encoding.
+ * A packed string carries its encoding, which takes precedence.
+ *
+ * @param encr_msg the encrypted message in the form of a string
+ * @param priv_key the polynomial containing the private key to decrypt
+ * 		the message
+ * @param priv_key_inv the inverse polynome to the private key
+ * @param params the ntru_params
+ * @param encoding how the message was mapped to the polynomials
+ * @return the decrypted string or NULL on failure
+ */
+string *
+ntru_decrypt_string_encoded(
+		const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		ntru_msg_encoding encoding);
+
+/**
+ * Get the maximum size of the output of ntru_decrypt_string_into()
+ * for an encrypted string of enc_len bytes. This is the worst
+ * case of the decompression, the real message is usually a lot
+ * shorter.
+ *
+ * @param enc_len the length of the encrypted string
+ * @param params the ntru_params
+ * @return the maximum length of the decrypted message
+ */
+size_t
+ntru_decrypt_bound(size_t enc_len, const ntru_params *params);
+
+/**
+ * Decryption like ntru_decrypt_string_into(), with the private
+ * key and its inverse taken from the coefficient arrays of a
+ * mapped key, e.g. ntru_key_handle.priv and .priv_inv of a key
+ * store or ntru_key_view.priv and .priv_inv of a binary key
+ * file. The keys are read in place, no polynomials are built
+ * from them.
+ *
+ * @param encr_msg the encrypted message in the form of a string
+ * @param priv_coeffs the params->N little endian coefficients
+ * of the private key
+ * @param priv_inv_coeffs the params->N little endian coefficients
+ * of the inverse of the private key
+ * @param params the ntru_params
+ * @param out where to store the decrypted message [out]
+ * @param out_size the size of out, ntru_decrypt_bound()
+ * is always enough
+ * @return the length of the decrypted message, 0 if it
+ * did not fit into out or decryption failed
+ */
+size_t
+ntru_decrypt_string_into_mapped(
+		const string *encr_msg,
+		const int16_t *priv_coeffs,
+		const int16_t *priv_inv_coeffs,
+		const ntru_params *params,
+		char *out,
+		size_t out_size);
+
+/**
+ * Decryption of a given encrypted string like ntru_decrypt_string(),
+ * but into a caller-provided buffer. All temporary memory comes
+ * from a per-thread scratch buffer and the blocks go through the
+ * int array kernels directly, so in steady state this does not
+ * allocate. Requires q <= 256.
+ *
+ * @param encr_msg the encrypted message in the form of a string
+ * @param priv_key the polynomial containing the private key to decrypt
+ * 		the message
+ * @param priv_key_inv the inverse polynome to the private key
+ * @param params the ntru_params
+ * @param out where to store the decrypted message [out]
+ * @param out_size the size of out, ntru_decrypt_bound()
+ * is always enough
+ * @return the length of the decrypted message, 0 if it
+ * did not fit into out or decryption failed
+ */
+size_t
+ntru_decrypt_string_into(
+		const string *encr_msg,
+		const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params,
+		char *out,
+		size_t out_size);
+
+
 #endif /* NTRU_DECRYPT */
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_drbg.c
+ * This file implements a fast deterministic random bit
+ * generator based on the ChaCha20 stream cipher.
+ * @brief ChaCha20 based DRBG
+ */
+
+#include "ntru_drbg.h"
+#include "ntru_err.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * Rotate a 32bit integer to the left.
+ */
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+/**
+ * The ChaCha quarter round.
+ */
+#define QUARTER_ROUND(x, a, b, c, d) \
+{ \
+	x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 16); \
+	x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 12); \
+	x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 8); \
+	x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 7); \
+}
+
+
+/**
+ * Read a little endian 32bit integer.
+ *
+ * @param p pointer to 4 bytes
+ * @return the integer
+ */
+static uint32_t
+load32_le(const uint8_t *p);
+
+/**
+ * Computes the next keystream block into drbg->buf
+ * and increments the block counter.
+ *
+ * @param drbg the DRBG
+ */
+static void
+chacha20_block(ntru_drbg *drbg);
+
+
+/*------------------------------------------------------------------------*/
+
+static uint32_t
+load32_le(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+chacha20_block(ntru_drbg *drbg)
+{
+	uint32_t x[16];
+
+	memcpy(x, drbg->state, sizeof(x));
+
+	for (uint32_t i = 0; i < 10; i++) {
+		QUARTER_ROUND(x, 0, 4, 8, 12);
+		QUARTER_ROUND(x, 1, 5, 9, 13);
+		QUARTER_ROUND(x, 2, 6, 10, 14);
+		QUARTER_ROUND(x, 3, 7, 11, 15);
+		QUARTER_ROUND(x, 0, 5, 10, 15);
+		QUARTER_ROUND(x, 1, 6, 11, 12);
+		QUARTER_ROUND(x, 2, 7, 8, 13);
+		QUARTER_ROUND(x, 3, 4, 9, 14);
+	}
+
+	for (uint32_t i = 0; i < 16; i++) {
+		uint32_t v = x[i] + drbg->state[i];
+
+		drbg->buf[4 * i] = (uint8_t)v;
+		drbg->buf[4 * i + 1] = (uint8_t)(v >> 8);
+		drbg->buf[4 * i + 2] = (uint8_t)(v >> 16);
+		drbg->buf[4 * i + 3] = (uint8_t)(v >> 24);
+	}
+
+	/* 64bit block counter */
+	if (++drbg->state[12] == 0)
+		drbg->state[13]++;
+
+	drbg->buf_pos = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_drbg_init(ntru_drbg *drbg,
+		const uint8_t *seed,
+		uint64_t nonce)
+{
+	if (!drbg || !seed)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	/* "expand 32-byte k" */
+	drbg->state[0] = 0x61707865;
+	drbg->state[1] = 0x3320646e;
+	drbg->state[2] = 0x79622d32;
+	drbg->state[3] = 0x6b206574;
+
+	for (uint32_t i = 0; i < 8; i++)
+		drbg->state[4 + i] = load32_le(seed + 4 * i);
+
+	drbg->state[12] = 0;
+	drbg->state[13] = 0;
+	drbg->state[14] = (uint32_t)nonce;
+	drbg->state[15] = (uint32_t)(nonce >> 32);
+
+	/* nothing buffered yet */
+	drbg->buf_pos = sizeof(drbg->buf);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_drbg_fill(ntru_drbg *drbg,
+		void *buf,
+		size_t len)
+{
+	uint8_t *out = buf;
+
+	while (len) {
+		size_t chunk;
+
+		if (drbg->buf_pos == sizeof(drbg->buf))
+			chacha20_block(drbg);
+
+		chunk = sizeof(drbg->buf) - drbg->buf_pos;
+		if (chunk > len)
+			chunk = len;
+
+		memcpy(out, drbg->buf + drbg->buf_pos, chunk);
+		/* don't keep handed out bytes around */
+		memset(drbg->buf + drbg->buf_pos, 0, chunk);
+
+		drbg->buf_pos += chunk;
+		out += chunk;
+		len -= chunk;
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+ntru_drbg_uint32(ntru_drbg *drbg)
+{
+	uint8_t bytes[4];
+
+	ntru_drbg_fill(drbg, bytes, sizeof(bytes));
+
+	return load32_le(bytes);
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+ntru_drbg_uniform(ntru_drbg *drbg, uint32_t bound)
+{
+	/* largest multiple of bound that fits into 32bit */
+	const uint32_t limit = UINT32_MAX - (UINT32_MAX % bound);
+	uint32_t rnd;
+
+	do {
+		rnd = ntru_drbg_uint32(drbg);
+	} while (rnd >= limit);
+
+	return rnd % bound;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_drbg_wipe(ntru_drbg *drbg)
+{
+	volatile uint8_t *p = (volatile uint8_t *)drbg;
+
+	for (size_t i = 0; i < sizeof(*drbg); i++)
+		p[i] = 0;
+}
+
+/*------------------------------------------------------------------------*/
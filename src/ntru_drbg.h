@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_drbg.h
+ * Header for the internal API of ntru_drbg.c.
+ * @brief header for ntru_drbg.c
+ */
+
+#ifndef NTRU_DRBG_H
+#define NTRU_DRBG_H
+
+
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Length of a DRBG seed in bytes.
+ */
+#define NTRU_SEED_LEN 32
+
+
+typedef struct ntru_drbg ntru_drbg;
+
+
+/**
+ * A deterministic random bit generator, which is
+ * the ChaCha20 keystream of the seed.
+ */
+struct ntru_drbg {
+	/**
+	 * The ChaCha20 input block: constants,
+	 * key (seed), 64bit block counter and 64bit nonce.
+	 */
+	uint32_t state[16];
+	/**
+	 * The current keystream block.
+	 */
+	uint8_t buf[64];
+	/**
+	 * Number of bytes of buf that have already
+	 * been handed out.
+	 */
+	uint32_t buf_pos;
+};
+
+
+/**
+ * Initializes the DRBG with the given seed. The same seed
+ * and nonce always yield the same stream of bytes.
+ *
+ * @param drbg the DRBG to initialize [out]
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param nonce separates different streams derived
+ * from the same seed
+ */
+void
+ntru_drbg_init(ntru_drbg *drbg,
+		const uint8_t *seed,
+		uint64_t nonce);
+
+/**
+ * Fills a buffer with the next bytes of the stream.
+ *
+ * @param drbg the DRBG
+ * @param buf the buffer to fill [out]
+ * @param len the number of bytes to write
+ */
+void
+ntru_drbg_fill(ntru_drbg *drbg,
+		void *buf,
+		size_t len);
+
+/**
+ * Get the next 32bit integer from the stream.
+ *
+ * @param drbg the DRBG
+ * @return the random integer
+ */
+uint32_t
+ntru_drbg_uint32(ntru_drbg *drbg);
+
+/**
+ * Get an unbiased integer in the range [0, bound - 1]
+ * from the stream, using rejection sampling.
+ *
+ * @param drbg the DRBG
+ * @param bound the exclusive upper bound, must not be 0
+ * @return the random integer
+ */
+uint32_t
+ntru_drbg_uniform(ntru_drbg *drbg, uint32_t bound);
+
+/**
+ * Overwrites the internal state, so that the stream
+ * cannot be recovered from memory anymore.
+ *
+ * @param drbg the DRBG to wipe
+ */
+void
+ntru_drbg_wipe(ntru_drbg *drbg);
+
+
+#endif /* NTRU_DRBG_H */
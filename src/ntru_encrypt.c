@@ -27,50 +27,181 @@
  */
 
 #include "ntru_ascii_poly.h"
+#include "ntru_base64.h"
+#include "ntru_common.h"
+#include "ntru_compress.h"
 #include "ntru_encrypt.h"
 #include "ntru_mem.h"
+#include "ntru_packed.h"
 #include "ntru_params.h"
 #include "ntru_poly.h"
 #include "ntru_poly_ascii.h"
+#include "ntru_rnd.h"
 #include "ntru_string.h"
+#include "ntru_threadpool.h"
 
 #include <lz4.h>
+#include <math.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
 
 
+typedef struct encrypt_job encrypt_job;
+
+
+/**
+ * The blocks of one message, encrypted by
+ * encrypt_block() in parallel.
+ */
+struct encrypt_job {
+	/**
+	 * The message blocks, encrypted in place.
+	 */
+	fmpz_poly_t **blocks;
+	/**
+	 * One random poly per block, or NULL if
+	 * all blocks use rnd.
+	 */
+	fmpz_poly_t *rnds;
+	/**
+	 * The random poly of all blocks if rnds is NULL.
+	 */
+	const fmpz_poly_struct *rnd;
+	/**
+	 * The public key.
+	 */
+	const fmpz_poly_struct *pub_key;
+	/**
+	 * The NTRU context.
+	 */
+	const ntru_params *params;
+};
+
+
 /**
  * Compress a string and return it, newly allocated.
  *
  * @param str the string to compress
- * @return the compressed string, newly allocated
+ * @param framed whether to create a frame with compress_frame()
+ * instead of a bare LZ4 block
+ * @param policy how to compress a frame, can be NULL
+ * @param pool the thread pool for the chunks of a frame,
+ * can be NULL
+ * @return the compressed string, newly allocated, NULL if
+ * the frame could not be created
  */
 static string *
-get_compressed_str(const string *str);
+get_compressed_str(const string *str,
+		bool framed,
+		const ntru_compress_policy *policy,
+		ntru_thread_pool *pool);
+
+/**
+ * Encrypts the i-th block of an encrypt_job,
+ * as ntru_thread_pool_parallel_for() body.
+ *
+ * @param i the block index
+ * @param arg the encrypt_job
+ */
+static void
+encrypt_block(size_t i, void *arg);
+
+/**
+ * Compresses msg, splits it into blocks and encrypts them,
+ * spread over pool.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param rnd the random poly of all blocks, or NULL to sample
+ * a fresh one per block from rng
+ * @param params the NTRU context
+ * @param rng the rng if rnd is NULL
+ * @param pool the thread pool, can be NULL
+ * @param encoding how the message is mapped to the blocks
+ * @param packed whether to output the packed binary format
+ * instead of base64
+ * @param dropped_bits the number of low bits to drop from the
+ * quotient c / p of every coefficient c in the packed format
+ * @param policy how to compress msg, can be NULL
+ * @return the newly allocated encrypted string
+ */
+static string *
+encrypt_string(const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_rng *rng,
+		ntru_thread_pool *pool,
+		ntru_msg_encoding encoding,
+		bool packed,
+		uint32_t dropped_bits,
+		const ntru_compress_policy *policy);
+
+/**
+ * Encrypts into a caller-provided buffer, see
+ * ntru_encrypt_string_into(). The public key comes either
+ * from a polynomial or from a mapped coefficient array.
+ *
+ * @param msg the message
+ * @param pub_key the public key, or NULL to use pub_coeffs
+ * @param pub_coeffs the little endian coefficients of the
+ * public key, used if pub_key is NULL
+ * @param rnd the random poly
+ * @param params the NTRU context
+ * @param out where to store the encrypted string [out]
+ * @param out_size the size of out
+ * @return the length of the encrypted string, 0 on failure
+ */
+static size_t
+encrypt_string_into(const string *msg,
+		const fmpz_poly_t pub_key,
+		const int16_t *pub_coeffs,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		char *out,
+		size_t out_size);
 
 
 /*------------------------------------------------------------------------*/
 
 static string *
-get_compressed_str(const string *str)
+get_compressed_str(const string *str,
+		bool framed,
+		const ntru_compress_policy *policy,
+		ntru_thread_pool *pool)
 {
 	int out_len = 0;
 	string *compressed_str;
-	uint32_t max_output_size;
 
 	if (!str)
 		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
 
-	max_output_size = str->len + 1;
 	compressed_str = ntru_malloc(sizeof(string));
-	compressed_str->ptr = ntru_malloc(
-			sizeof(char) * max_output_size);
-	out_len = LZ4_compress(
+
+	if (framed) {
+		compressed_str->ptr = ntru_malloc(compress_bound(str->len));
+		compressed_str->len = compress_frame(
+				(uint8_t *)compressed_str->ptr,
+				(const uint8_t *)str->ptr, str->len, policy, pool);
+		/* e.g. the dictionary of the policy is not registered */
+		if (!compressed_str->len) {
+			string_delete(compressed_str);
+			return NULL;
+		}
+
+		return compressed_str;
+	}
+
+	/* incompressible input grows */
+	compressed_str->ptr = ntru_malloc(LZ4_compressBound(str->len));
+	out_len = LZ4_compress_default(
 			(const char*) str->ptr,
 			compressed_str->ptr,
-			str->len);
+			str->len,
+			LZ4_compressBound(str->len));
 
 	if (out_len > 0)
 		compressed_str->len = out_len;
@@ -82,6 +213,168 @@ get_compressed_str(const string *str)
 
 /*------------------------------------------------------------------------*/
 
+static void
+encrypt_block(size_t i, void *arg)
+{
+	encrypt_job *job = arg;
+
+	ntru_encrypt_poly(*job->blocks[i],
+			*job->blocks[i],
+			job->pub_key,
+			job->rnds ? job->rnds[i] : job->rnd,
+			job->params);
+}
+
+/*------------------------------------------------------------------------*/
+
+static string *
+encrypt_string(const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_rng *rng,
+		ntru_thread_pool *pool,
+		ntru_msg_encoding encoding,
+		bool packed,
+		uint32_t dropped_bits,
+		const ntru_compress_policy *policy)
+{
+	uint32_t n = 0;
+	string *enc_msg;
+	string *compressed_msg;
+	encrypt_job job;
+
+	compressed_msg = get_compressed_str(msg,
+			encoding != NTRU_MSG_BINARY_UNFRAMED, policy, pool);
+	if (!compressed_msg)
+		return NULL;
+
+	if (encoding == NTRU_MSG_TERNARY)
+		job.blocks = ascii_to_tern_poly_arr(compressed_msg, params);
+	else
+		job.blocks = ascii_to_bin_poly_arr(compressed_msg, params);
+	job.rnds = NULL;
+	job.rnd = rnd;
+	job.pub_key = pub_key;
+	job.params = params;
+
+	while (*job.blocks[n])
+		n++;
+
+	if (!rnd) {
+		job.rnds = ntru_malloc(sizeof(*job.rnds) * n);
+		for (uint32_t i = 0; i < n; i++)
+			fmpz_poly_init(job.rnds[i]);
+
+		ntru_get_rnd_tern_poly_batch(job.rnds, n, params,
+				NTRU_DR(params), NTRU_DR(params), rng);
+	}
+
+	/* every block is written to its own slot, so order is kept */
+	ntru_thread_pool_parallel_for(pool, n, encrypt_block, &job);
+
+	if (packed)
+		enc_msg = poly_arr_to_packed((const fmpz_poly_t **)job.blocks,
+				n, params, encoding, msg->len, dropped_bits);
+	else
+		enc_msg = poly_arr_to_base64((const fmpz_poly_t **)job.blocks,
+				n, params);
+
+	if (job.rnds) {
+		for (uint32_t i = 0; i < n; i++)
+			fmpz_poly_clear(job.rnds[i]);
+		free(job.rnds);
+	}
+	poly_delete_array(job.blocks);
+	string_delete(compressed_msg);
+
+	return enc_msg;
+}
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+encrypt_string_into(const string *msg,
+		const fmpz_poly_t pub_key,
+		const int16_t *pub_coeffs,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		char *out,
+		size_t out_size)
+{
+	const uint32_t N = params->N;
+	int32_t *h,
+			*r,
+			*m,
+			*c;
+	int8_t *coeffs;
+	uint8_t *frame,
+			*raw;
+	size_t frame_bound,
+		   frame_len,
+		   bits,
+		   raw_len,
+		   enc_len,
+		   scratch_len,
+		   result = 0;
+
+	/* the string format has one byte per coefficient */
+	if (params->q > 256 || msg->len > LZ4_MAX_INPUT_SIZE)
+		return 0;
+
+	frame_bound = compress_bound(msg->len);
+	scratch_len = sizeof(*h) * 4 * N + N + frame_bound +
+		(ntru_encrypt_bound(msg->len, params) / 4 * 3);
+	h = ntru_scratch(scratch_len);
+	r = h + N;
+	m = h + 2 * N;
+	c = h + 3 * N;
+	coeffs = (int8_t *)(h + 4 * N);
+	frame = (uint8_t *)(coeffs + N);
+	raw = frame + frame_bound;
+
+	frame_len = compress_frame(frame, (const uint8_t *)msg->ptr, msg->len,
+			NULL, NULL);
+	if (!frame_len)
+		goto cleanup;
+
+	bits = frame_len * ASCII_BITS;
+	raw_len = (bits + N - 1) / N * N;
+	enc_len = (raw_len + 2) / 3 * 4;
+	if (enc_len > out_size)
+		goto cleanup;
+
+	if (pub_key)
+		poly_get_residues(h, pub_key, params, params->q);
+	else
+		poly_get_residues_le16(h, pub_coeffs, params, params->q);
+	poly_get_residues(r, rnd, params, params->q);
+
+	for (size_t i = 0; i < raw_len; i += N) {
+		uint32_t len = (bits - i > N) ? N : bits - i;
+
+		/* bit 1 is coefficient 1, bit 0 is -1, padding is 0 */
+		bytes_to_bin_coeffs(coeffs, frame, i, len);
+		for (uint32_t k = 0; k < N; k++)
+			m[k] = k < len ? coeffs[k] : 0;
+
+		poly_encrypt_kernel(c, h, r, m, params);
+
+		for (uint32_t k = 0; k < N; k++)
+			raw[i + k] = (uint8_t)c[k];
+	}
+
+	result = base64_encode(out, raw, raw_len);
+
+cleanup:
+	/* the frame is the compressed plaintext */
+	ntru_scratch_release(scratch_len);
+
+	return result;
+}
+
+/*------------------------------------------------------------------------*/
+
 void
 ntru_encrypt_poly(
 		fmpz_poly_t out,
@@ -90,22 +383,28 @@ ntru_encrypt_poly(
 		const fmpz_poly_t rnd,
 		const ntru_params *params)
 {
-	fmpz_poly_t tmp_poly_msg;
+	int32_t *buf,
+			*h,
+			*r,
+			*m;
 
 	if (!msg_bin || !pub_key || !rnd || !out || !params)
 		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
 
-	/* allow aliasing */
-	fmpz_poly_init(tmp_poly_msg);
-	fmpz_poly_set(tmp_poly_msg, msg_bin);
+	buf = ntru_malloc(sizeof(*buf) * params->N * 4);
+	h = buf + params->N;
+	r = buf + 2 * params->N;
+	m = buf + 3 * params->N;
 
-	fmpz_poly_zero(out);
-	poly_starmultiply(out, pub_key, rnd, params, params->q);
+	/* all inputs are loaded first, which allows aliasing */
+	poly_get_residues(h, pub_key, params, params->q);
+	poly_get_residues(r, rnd, params, params->q);
+	poly_get_residues(m, msg_bin, params, params->q);
 
-	fmpz_poly_add(out, out, tmp_poly_msg);
-	fmpz_poly_mod_unsigned(out, params->q);
+	poly_encrypt_kernel(buf, h, r, m, params);
+	poly_set_int_arr(out, buf, params);
 
-	fmpz_poly_clear(tmp_poly_msg);
+	free(buf);
 }
 
 /*------------------------------------------------------------------------*/
@@ -117,34 +416,221 @@ ntru_encrypt_string(
 		const fmpz_poly_t rnd,
 		const ntru_params *params)
 {
-	uint32_t i = 0;
-	string *enc_msg;
-	fmpz_poly_t **poly_array;
-	string *compressed_msg;
+	if (!msg || !msg->len || !pub_key || !rnd || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return encrypt_string(msg, pub_key, rnd, params, NULL, NULL,
+			NTRU_MSG_BINARY, false, 0, NULL);
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_encrypt_string_encoded(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding)
+{
+	if (!msg || !msg->len || !pub_key || !rnd || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	/* only p = 3 recovers all three digits of a trit */
+	if (encoding == NTRU_MSG_TERNARY && params->p != 3)
+		return NULL;
+
+	return encrypt_string(msg, pub_key, rnd, params, NULL, NULL,
+			encoding, false, 0, NULL);
+}
+
+/*------------------------------------------------------------------------*/
 
-	if (!msg || !msg->len)
+string *
+ntru_encrypt_string_compressed(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding,
+		const ntru_compress_policy *policy)
+{
+	if (!msg || !msg->len || !pub_key || !rnd || !params)
 		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
 
-	compressed_msg = get_compressed_str(msg);
+	if ((encoding == NTRU_MSG_TERNARY && params->p != 3) ||
+			encoding == NTRU_MSG_BINARY_UNFRAMED)
+		return NULL;
 
-	poly_array = ascii_to_bin_poly_arr(compressed_msg, params);
+	return encrypt_string(msg, pub_key, rnd, params, NULL, NULL,
+			encoding, false, 0, policy);
+}
 
-	while (*poly_array[i]) {
-		ntru_encrypt_poly(*poly_array[i],
-				*poly_array[i],
-				pub_key,
-				rnd,
-				params);
-		i++;
-	}
+/*------------------------------------------------------------------------*/
 
-	enc_msg = poly_arr_to_base64((const fmpz_poly_t **)poly_array,
-			i, params);
+string *
+ntru_encrypt_string_packed(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding)
+{
+	if (!msg || !msg->len || !pub_key || !rnd || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
 
-	poly_delete_array(poly_array);
-	string_delete(compressed_msg);
+	return ntru_encrypt_string_rounded(msg, pub_key, rnd, params,
+			encoding, packed_quotient_bits(params));
+}
 
-	return enc_msg;
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_encrypt_string_rounded(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding,
+		uint32_t keep_bits)
+{
+	if (!msg || !msg->len || !pub_key || !rnd || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	if ((encoding == NTRU_MSG_TERNARY && params->p != 3) ||
+			encoding == NTRU_MSG_BINARY_UNFRAMED ||
+			!keep_bits || keep_bits > packed_quotient_bits(params))
+		return NULL;
+
+	return encrypt_string(msg, pub_key, rnd, params, NULL, NULL,
+			encoding, true, packed_quotient_bits(params) - keep_bits,
+			NULL);
+}
+
+/*------------------------------------------------------------------------*/
+
+double
+ntru_rounding_failure_rate(const ntru_params *params,
+		uint32_t keep_bits)
+{
+	uint32_t bits;
+	double f_weight,
+		   var,
+		   coeff_rate;
+
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	bits = packed_quotient_bits(params);
+	f_weight = 2.0 * NTRU_DF(params) - 1;
+
+	if (!keep_bits || keep_bits > bits)
+		return 1.0;
+
+	/* p * r * g, every r_i g_j product is +-1 with 4 dr dg / N^2 */
+	var = (double)params->p * params->p *
+		(2.0 * NTRU_DR(params)) * (2.0 * NTRU_DG(params)) / params->N;
+	/* f * m, with message coefficients of at most 1 */
+	var += f_weight;
+	/* f * p * rounding error, uniform over 2^dropped values */
+	var += f_weight * params->p * params->p *
+		(ldexp(1.0, 2 * (bits - keep_bits)) - 1) / 12;
+
+	coeff_rate = erfc(params->q / 2.0 / sqrt(2.0 * var));
+
+	/* every one of the N coefficients has to be right */
+	return -expm1(params->N * log1p(-coeff_rate));
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+ntru_rounding_keep_bits(const ntru_params *params,
+		double max_rate)
+{
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	for (uint32_t k = 1; k <= packed_quotient_bits(params); k++)
+		if (ntru_rounding_failure_rate(params, k) <= max_rate)
+			return k;
+
+	return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_encrypt_string_parallel(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const ntru_params *params,
+		ntru_rng *rng,
+		ntru_thread_pool *pool)
+{
+	if (!msg || !msg->len || !pub_key || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return encrypt_string(msg, pub_key, NULL, params, rng, pool,
+			NTRU_MSG_BINARY, false, 0, NULL);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_encrypt_bound(size_t msg_len, const ntru_params *params)
+{
+	size_t compressed_len,
+		   raw_len;
+
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	if (!msg_len || msg_len > LZ4_MAX_INPUT_SIZE)
+		return 0;
+
+	/* one message bit per coefficient, one byte per coefficient */
+	compressed_len = compress_bound(msg_len);
+	raw_len = (compressed_len * ASCII_BITS + params->N - 1) /
+		params->N * params->N;
+
+	return (raw_len + 2) / 3 * 4;
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_encrypt_string_into(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		char *out,
+		size_t out_size)
+{
+	if (!msg || !msg->len || !pub_key || !rnd || !params || !out)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return encrypt_string_into(msg, pub_key, NULL, rnd, params, out,
+			out_size);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_encrypt_string_into_mapped(
+		const string *msg,
+		const int16_t *pub_coeffs,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		char *out,
+		size_t out_size)
+{
+	if (!msg || !msg->len || !pub_coeffs || !rnd || !params || !out)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	return encrypt_string_into(msg, NULL, pub_coeffs, rnd, params, out,
+			out_size);
 }
 
 /*------------------------------------------------------------------------*/
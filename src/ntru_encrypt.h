@@ -31,7 +31,9 @@
 
 #include "ntru_params.h"
 #include "ntru_poly.h"
+#include "ntru_rnd.h"
 #include "ntru_string.h"
+#include "ntru_threadpool.h"
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
@@ -67,6 +69,181 @@ ntru_encrypt_poly(
 		const fmpz_poly_t rnd,
 		const ntru_params *params);
 
+/**
+ * Encrypt a message like ntru_encrypt_string(), but with a choice
+ * of how the message is mapped to the polynomials. NTRU_MSG_BINARY
+ * gives the same output as ntru_encrypt_string(), NTRU_MSG_TERNARY
+ * needs about 37% fewer blocks. The encoding is not stored in the
+ * output, so it must be passed to ntru_decrypt_string_encoded() as well.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param rnd the random poly (should have relatively small
+ * coefficients, but not restricted to {-1, 0, 1})
+ * @param params ntru_params the ntru context
+ * @param encoding how the message is mapped to the polynomials
+ * @return the newly allocated encrypted string, NULL on failure
+ * or if the encoding does not fit the parameters
+ */
+string *
+ntru_encrypt_string_encoded(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding);
+
+/**
+ * Encrypt a message like ntru_encrypt_string_encoded(), but
+ * compress it according to a policy instead of always with fast
+ * LZ4. Already compressed data can skip compression, redundant
+ * data can use LZ4HC to need fewer blocks. The frame of the
+ * message tells decryption whether it is stored or compressed,
+ * so the decryption functions need no policy.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param rnd the random poly (should have relatively small
+ * coefficients, but not restricted to {-1, 0, 1})
+ * @param params ntru_params the ntru context
+ * @param encoding how the message is mapped to the polynomials,
+ * NTRU_MSG_BINARY_UNFRAMED is not supported
+ * @param policy how to compress the message
+ * @return the newly allocated encrypted string, NULL on failure
+ * or if the encoding does not fit the parameters
+ */
+string *
+ntru_encrypt_string_compressed(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding,
+		const ntru_compress_policy *policy);
+
+/**
+ * Encrypt a message like ntru_encrypt_string_encoded(), but into
+ * the packed binary format instead of base64. It starts with a
+ * header that holds the parameter set, the encoding, the number of
+ * blocks and the length of the message, followed by every
+ * coefficient in exactly ceil(log2(q)) bits. So unlike base64 it
+ * works for any q, and it is 25% smaller for q = 256 and more than
+ * half for q = 32. The decryption functions tell both formats apart
+ * on their own.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param rnd the random poly (should have relatively small
+ * coefficients, but not restricted to {-1, 0, 1})
+ * @param params ntru_params the ntru context
+ * @param encoding how the message is mapped to the polynomials,
+ * the packed format is always framed, so NTRU_MSG_BINARY_UNFRAMED
+ * is not supported
+ * @return the newly allocated encrypted string, which is binary
+ * data, NULL on failure or if the encoding does not fit the
+ * parameters
+ */
+string *
+ntru_encrypt_string_packed(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding);
+
+/**
+ * Encrypt a message like ntru_encrypt_string_packed(), but keep
+ * only c mod p and the top keep_bits bits of c / p of every
+ * coefficient c of the ciphertext. Decryption restores each
+ * quotient to the midpoint of the range it was rounded from.
+ * The error is a multiple of p, so it does not touch the message
+ * directly, but it adds noise and decryption failures become more
+ * likely, see ntru_rounding_failure_rate() and
+ * ntru_rounding_keep_bits() to pick keep_bits for a parameter set.
+ * The decryption functions handle these ciphertexts like any
+ * other packed one.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param rnd the random poly (should have relatively small
+ * coefficients, but not restricted to {-1, 0, 1})
+ * @param params ntru_params the ntru context
+ * @param encoding how the message is mapped to the polynomials,
+ * NTRU_MSG_BINARY_UNFRAMED is not supported
+ * @param keep_bits the number of top bits of c / p to keep, from
+ * 1 to ceil(log2(ceil(q / p))), the latter is lossless
+ * @return the newly allocated encrypted string, which is binary
+ * data, NULL on failure, if keep_bits is out of range or if the
+ * encoding does not fit the parameters
+ */
+string *
+ntru_encrypt_string_rounded(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		ntru_msg_encoding encoding,
+		uint32_t keep_bits);
+
+/**
+ * Estimate the probability that a block encrypted by
+ * ntru_encrypt_string_rounded() fails to decrypt. Every
+ * coefficient of f * e is modeled as normal distribution, with
+ * the variances of p * r * g, f * m and f times p times the
+ * rounding error added up, where f, g and r have the weights of NTRU_DF(),
+ * NTRU_DG() and NTRU_DR(). Decryption fails once a coefficient
+ * leaves [-q/2, q/2). This is an estimate for random keys and
+ * random polys r, not a bound.
+ *
+ * @param params the NTRU context
+ * @param keep_bits the number of top bits of c / p kept per
+ * coefficient c
+ * @return the estimated failure probability per block
+ */
+double
+ntru_rounding_failure_rate(const ntru_params *params,
+		uint32_t keep_bits);
+
+/**
+ * Get the smallest number of bits to keep per coefficient
+ * for which ntru_rounding_failure_rate() does not exceed
+ * max_rate.
+ *
+ * @param params the NTRU context
+ * @param max_rate the acceptable failure probability per block
+ * @return the number of bits for ntru_encrypt_string_rounded(),
+ * 0 if not even the lossless format reaches max_rate
+ */
+uint32_t
+ntru_rounding_keep_bits(const ntru_params *params,
+		double max_rate);
+
+/**
+ * Encrypt a message like ntru_encrypt_string(), but with an
+ * independent random poly r per block instead of one shared by
+ * all blocks. The r are sampled from rng with NTRU_DR() 1 and -1
+ * coefficients (each) and the blocks are encrypted in parallel
+ * on pool. The output is the same format and block order as
+ * ntru_encrypt_string(), so it decrypts with either decryption
+ * function.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param params ntru_params the ntru context
+ * @param rng the rng for the random polys, NULL for
+ * the per-thread DRBG
+ * @param pool the thread pool, can be NULL to encrypt
+ * in the calling thread
+ * @return the newly allocated encrypted string
+ */
+string *
+ntru_encrypt_string_parallel(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const ntru_params *params,
+		ntru_rng *rng,
+		ntru_thread_pool *pool);
+
 /**
  * Encrypt a message in the form of a null-terminated char array and
  * return a string.
@@ -86,4 +263,75 @@ ntru_encrypt_string(
 		const ntru_params *params);
 
 
+/**
+ * Get the maximum size of the output of ntru_encrypt_string_into()
+ * (and of ntru_encrypt_string()) for a message of msg_len bytes.
+ *
+ * @param msg_len the length of the message
+ * @param params ntru_params the ntru context
+ * @return the maximum length of the encrypted string,
+ * 0 if the message is too long
+ */
+size_t
+ntru_encrypt_bound(size_t msg_len, const ntru_params *params);
+
+/**
+ * Encrypt a message like ntru_encrypt_string(), but into a
+ * caller-provided buffer. All temporary memory comes from a
+ * per-thread scratch buffer and the blocks go through the
+ * int array kernels directly, so in steady state this does
+ * not allocate. The output is the same as the one of
+ * ntru_encrypt_string(). Requires q <= 256.
+ *
+ * @param msg the message
+ * @param pub_key the public key
+ * @param rnd the random poly (should have relatively small
+ * coefficients, but not restricted to {-1, 0, 1})
+ * @param params ntru_params the ntru context
+ * @param out where to store the encrypted string, not
+ * null-terminated [out]
+ * @param out_size the size of out, ntru_encrypt_bound()
+ * is always enough
+ * @return the length of the encrypted string, 0 if out
+ * is too small or q is too large
+ */
+size_t
+ntru_encrypt_string_into(
+		const string *msg,
+		const fmpz_poly_t pub_key,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		char *out,
+		size_t out_size);
+
+/**
+ * Encrypt a message like ntru_encrypt_string_into(), with the
+ * public key taken from the coefficient array of a mapped key,
+ * e.g. ntru_key_handle.pub of a key store or ntru_key_view.pub
+ * of a binary key file. The key is read in place, no polynomial
+ * is built from it.
+ *
+ * @param msg the message
+ * @param pub_coeffs the params->N little endian coefficients
+ * of the public key
+ * @param rnd the random poly (should have relatively small
+ * coefficients, but not restricted to {-1, 0, 1})
+ * @param params ntru_params the ntru context
+ * @param out where to store the encrypted string, not
+ * null-terminated [out]
+ * @param out_size the size of out, ntru_encrypt_bound()
+ * is always enough
+ * @return the length of the encrypted string, 0 if out
+ * is too small or q is too large
+ */
+size_t
+ntru_encrypt_string_into_mapped(
+		const string *msg,
+		const int16_t *pub_coeffs,
+		const fmpz_poly_t rnd,
+		const ntru_params *params,
+		char *out,
+		size_t out_size);
+
+
 #endif /* PQC_ENCRYPT_H */
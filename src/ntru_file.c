@@ -136,8 +136,11 @@ write_file(string const *wstring, char const * const filename)
 		return false;
 	}
 
-	for (uint32_t i = 0; i < wstring->len; i++)
-		fprintf(fp, "%c", wstring->ptr[i]);
+	if (fwrite(wstring->ptr, CHAR_SIZE, wstring->len, fp) != wstring->len) {
+		NTRU_WARN_DEBUG("Failed while writing file\n");
+		fclose(fp);
+		return false;
+	}
 
 	if (fclose(fp)) {
 		NTRU_WARN_DEBUG("Failed to close file descripter\n");
@@ -148,3 +151,59 @@ write_file(string const *wstring, char const * const filename)
 }
 
 /*------------------------------------------------------------------------*/
+
+bool
+replace_file(string const *wstring, char const * const filename)
+{
+	size_t name_len,
+		   written = 0;
+	char *tmp_name;
+	int fd;
+	bool retval = false;
+
+	if (!wstring || !filename)
+		return false;
+
+	name_len = strlen(filename);
+	tmp_name = ntru_malloc(name_len + sizeof(".XXXXXX"));
+	memcpy(tmp_name, filename, name_len);
+	memcpy(tmp_name + name_len, ".XXXXXX", sizeof(".XXXXXX"));
+
+	/* created with mode 0600 */
+	if ((fd = mkstemp(tmp_name)) == -1) {
+		NTRU_WARN_DEBUG("Failed while creating file\n");
+		free(tmp_name);
+		return false;
+	}
+
+	while (written < wstring->len) {
+		ssize_t n = write(fd, wstring->ptr + written,
+				wstring->len - written);
+
+		if (n == -1) {
+			NTRU_WARN_DEBUG("Failed while writing file\n");
+			close(fd);
+			goto cleanup;
+		}
+		written += n;
+	}
+
+	if (fsync(fd)) {
+		close(fd);
+		goto cleanup;
+	}
+
+	if (close(fd))
+		goto cleanup;
+
+	retval = !rename(tmp_name, filename);
+
+cleanup:
+	if (!retval)
+		remove(tmp_name);
+	free(tmp_name);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
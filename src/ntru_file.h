@@ -56,5 +56,19 @@ read_file(char const * const filename);
 bool
 write_file(string const *wstring, char const * const filename);
 
+/**
+ * Atomically replace a file with a string. The string is
+ * written to a temporary file next to filename, which is only
+ * accessible by its owner, synced and renamed over filename,
+ * so readers that still have the old file open or mapped keep
+ * seeing the old contents.
+ *
+ * @param wstring the string to write to the file
+ * @param filename the name of the file to replace or create
+ * @return true for success or false if any of the file operations failed
+ */
+bool
+replace_file(string const *wstring, char const * const filename);
+
 
 #endif /* NTRU_FILE_H */
@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keycache.c
+ * This file implements a cache of imported keys, so that
+ * repeatedly importing the same key file neither reads and
+ * decodes the file nor inverts the private key again.
+ * @brief cache of imported keys
+ */
+
+#include "ntru_err.h"
+#include "ntru_keycache.h"
+#include "ntru_keyfile.h"
+#include "ntru_keypair.h"
+#include "ntru_lru.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <fmpz_poly.h>
+
+
+typedef struct key_cache_entry key_cache_entry;
+
+
+/**
+ * Whether a cache entry holds a public or a private key,
+ * this is the first byte of the cache key.
+ */
+enum key_cache_kind {
+	KEY_CACHE_PUBLIC = 'P',
+	KEY_CACHE_PRIVATE = 'S',
+};
+
+/**
+ * An imported key, as stored in the cache.
+ */
+struct key_cache_entry {
+	/**
+	 * Device of the key file when it was imported.
+	 */
+	dev_t dev;
+	/**
+	 * Inode of the key file when it was imported.
+	 */
+	ino_t ino;
+	/**
+	 * Size of the key file when it was imported.
+	 */
+	off_t size;
+	/**
+	 * Modification time of the key file when it was imported.
+	 */
+	struct timespec mtime;
+	/**
+	 * The public key or the private key f.
+	 */
+	fmpz_poly_t key;
+	/**
+	 * The inverse Fp of f, unused for public keys.
+	 */
+	fmpz_poly_t key_inv;
+};
+
+/**
+ * A thread-safe LRU cache of imported keys.
+ */
+struct ntru_key_cache {
+	/**
+	 * Maps kind, parameters and path to key_cache_entry.
+	 */
+	ntru_lru *lru;
+	/**
+	 * Number of lookups that found an entry whose file
+	 * changed, the LRU counted them as hits.
+	 */
+	uint64_t stale;
+	/**
+	 * Protects lru and stale.
+	 */
+	pthread_mutex_t lock;
+};
+
+
+/**
+ * Builds the cache key for a key file.
+ *
+ * @param kind public or private key
+ * @param filename the key file
+ * @param params the NTRU context
+ * @param key_len where to store the length of the key [out]
+ * @return the newly allocated key
+ */
+static uint8_t *
+key_cache_key(enum key_cache_kind kind,
+		char const * const filename,
+		const ntru_params *params,
+		size_t *key_len);
+
+/**
+ * Checks whether a cache entry still matches the key file.
+ *
+ * @param entry the cache entry
+ * @param s the current status of the key file
+ * @return true if the file did not change, false otherwise
+ */
+static bool
+key_cache_entry_valid(const key_cache_entry *entry,
+		const struct stat *s);
+
+/**
+ * Looks up both polynomials of a cache entry and copies
+ * them out. Stale entries are dropped.
+ *
+ * @param cache the cache
+ * @param key the cache key
+ * @param key_len the length of the cache key
+ * @param s the current status of the key file
+ * @param poly where to copy the key to [out]
+ * @param poly_inv where to copy the inverse to, can be NULL [out]
+ * @return true if a valid entry was found, false otherwise
+ */
+static bool
+key_cache_lookup(ntru_key_cache *cache,
+		const uint8_t *key,
+		size_t key_len,
+		const struct stat *s,
+		fmpz_poly_t poly,
+		fmpz_poly_t poly_inv);
+
+/**
+ * Adds an imported key to the cache.
+ *
+ * @param cache the cache
+ * @param key the cache key
+ * @param key_len the length of the cache key
+ * @param s the status of the key file before it was imported
+ * @param poly the key
+ * @param poly_inv the inverse, can be NULL
+ */
+static void
+key_cache_insert(ntru_key_cache *cache,
+		const uint8_t *key,
+		size_t key_len,
+		const struct stat *s,
+		const fmpz_poly_t poly,
+		const fmpz_poly_t poly_inv);
+
+/**
+ * Frees a key_cache_entry, used as callback for the LRU.
+ *
+ * @param value the key_cache_entry
+ */
+static void
+key_cache_entry_free(void *value);
+
+
+/*------------------------------------------------------------------------*/
+
+static uint8_t *
+key_cache_key(enum key_cache_kind kind,
+		char const * const filename,
+		const ntru_params *params,
+		size_t *key_len)
+{
+	size_t name_len = strlen(filename);
+	uint8_t *key;
+
+	*key_len = 1 + 3 * sizeof(uint32_t) + name_len;
+	key = ntru_malloc(*key_len);
+
+	key[0] = kind;
+	memcpy(key + 1, &params->N, sizeof(uint32_t));
+	memcpy(key + 5, &params->q, sizeof(uint32_t));
+	memcpy(key + 9, &params->p, sizeof(uint32_t));
+	memcpy(key + 13, filename, name_len);
+
+	return key;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+key_cache_entry_valid(const key_cache_entry *entry,
+		const struct stat *s)
+{
+	return entry->dev == s->st_dev &&
+		entry->ino == s->st_ino &&
+		entry->size == s->st_size &&
+		entry->mtime.tv_sec == s->st_mtim.tv_sec &&
+		entry->mtime.tv_nsec == s->st_mtim.tv_nsec;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+key_cache_lookup(ntru_key_cache *cache,
+		const uint8_t *key,
+		size_t key_len,
+		const struct stat *s,
+		fmpz_poly_t poly,
+		fmpz_poly_t poly_inv)
+{
+	key_cache_entry *entry;
+	bool found = false;
+
+	pthread_mutex_lock(&cache->lock);
+	if ((entry = ntru_lru_get(cache->lru, key, key_len))) {
+		if (key_cache_entry_valid(entry, s)) {
+			fmpz_poly_set(poly, entry->key);
+			if (poly_inv)
+				fmpz_poly_set(poly_inv, entry->key_inv);
+			found = true;
+		} else {
+			cache->stale++;
+			ntru_lru_remove(cache->lru, key, key_len);
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+key_cache_insert(ntru_key_cache *cache,
+		const uint8_t *key,
+		size_t key_len,
+		const struct stat *s,
+		const fmpz_poly_t poly,
+		const fmpz_poly_t poly_inv)
+{
+	key_cache_entry *entry = ntru_malloc(sizeof(*entry));
+	size_t cost;
+
+	entry->dev = s->st_dev;
+	entry->ino = s->st_ino;
+	entry->size = s->st_size;
+	entry->mtime = s->st_mtim;
+
+	fmpz_poly_init(entry->key);
+	fmpz_poly_init(entry->key_inv);
+	fmpz_poly_set(entry->key, poly);
+	if (poly_inv)
+		fmpz_poly_set(entry->key_inv, poly_inv);
+
+	cost = sizeof(*entry) + key_len +
+		(fmpz_poly_length(entry->key) + fmpz_poly_length(entry->key_inv)) *
+		sizeof(fmpz);
+
+	pthread_mutex_lock(&cache->lock);
+	ntru_lru_put(cache->lru, key, key_len, entry, cost);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+key_cache_entry_free(void *value)
+{
+	key_cache_entry *entry = value;
+
+	fmpz_poly_clear(entry->key);
+	fmpz_poly_clear(entry->key_inv);
+	free(entry);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_key_cache *
+ntru_key_cache_new(size_t max_bytes)
+{
+	ntru_key_cache *cache = ntru_malloc(sizeof(*cache));
+
+	cache->lru = ntru_lru_new(max_bytes, key_cache_entry_free);
+	cache->stale = 0;
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_cache_get_public_key(ntru_key_cache *cache,
+		fmpz_poly_t pub,
+		char const * const filename,
+		const ntru_params *params)
+{
+	struct stat s;
+	uint8_t *key;
+	size_t key_len;
+	bool retval = true;
+
+	if (!cache || !pub || !filename || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (stat(filename, &s) == -1 || !S_ISREG(s.st_mode))
+		return false;
+
+	key = key_cache_key(KEY_CACHE_PUBLIC, filename, params, &key_len);
+
+	if (key_cache_lookup(cache, key, key_len, &s, pub, NULL))
+		goto cleanup;
+
+	/* import without holding the lock */
+	if (ntru_key_file_is_bin(filename))
+		retval = import_public_key_bin(pub, filename, params);
+	else
+		retval = import_public_key(pub, filename, params);
+
+	if (retval)
+		key_cache_insert(cache, key, key_len, &s, pub, NULL);
+
+cleanup:
+	free(key);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_cache_get_priv_key(ntru_key_cache *cache,
+		fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		char const * const filename,
+		const ntru_params *params)
+{
+	struct stat s;
+	uint8_t *key;
+	size_t key_len;
+	bool retval = true;
+
+	if (!cache || !priv || !priv_inv || !filename || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (stat(filename, &s) == -1 || !S_ISREG(s.st_mode))
+		return false;
+
+	key = key_cache_key(KEY_CACHE_PRIVATE, filename, params, &key_len);
+
+	if (key_cache_lookup(cache, key, key_len, &s, priv, priv_inv))
+		goto cleanup;
+
+	/* import without holding the lock */
+	if (ntru_key_file_is_bin(filename))
+		retval = import_priv_key_bin(priv, priv_inv, filename, params);
+	else
+		retval = import_priv_key(priv, priv_inv, filename, params);
+
+	if (retval)
+		key_cache_insert(cache, key, key_len, &s, priv, priv_inv);
+
+cleanup:
+	free(key);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_cache_get_stats(ntru_key_cache *cache,
+		ntru_cache_stats *stats)
+{
+	if (!cache || !stats)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&cache->lock);
+	ntru_lru_get_stats(cache->lru, stats);
+	stats->hits -= cache->stale;
+	stats->misses += cache->stale;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_cache_delete(ntru_key_cache *cache)
+{
+	if (!cache)
+		return;
+
+	ntru_lru_delete(cache->lru);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+/*------------------------------------------------------------------------*/
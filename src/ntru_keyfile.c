@@ -0,0 +1,479 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyfile.c
+ * This file handles the binary key file format, which
+ * can be memory-mapped and used without a decode step.
+ * All values are little endian. The layout is:
+ *
+ *   offset  size  field
+ *        0     8  magic "NTRUKEY\0"
+ *        8     2  format version
+ *       10     2  key type, see ntru_key_type
+ *       12     4  N
+ *       16     4  q
+ *       20     4  p
+ *       24     8  reserved, zero
+ *       32     8  offset of h
+ *       40     8  offset of f, zero for public keys
+ *       48     8  offset of Fp, zero for public keys
+ *       56     8  total file length
+ *
+ * followed by the coefficient arrays, each N int16_t values
+ * starting at a multiple of NTRU_KEYFILE_ALIGN.
+ * @brief binary key files
+ */
+
+#include "ntru_common.h"
+#include "ntru_err.h"
+#include "ntru_file.h"
+#include "ntru_keyfile.h"
+#include "ntru_keypair.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_poly.h"
+#include "ntru_string.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Size of the file header.
+ */
+#define KEYFILE_HEADER_LEN 64
+
+/**
+ * Magic bytes at the start of every binary key file.
+ */
+static const char keyfile_magic[8] = "NTRUKEY";
+
+
+/**
+ * Size of one coefficient array, padded to the alignment.
+ *
+ * @param params the NTRU context
+ * @return padded size in bytes
+ */
+static size_t
+keyfile_array_len(const ntru_params *params);
+
+/**
+ * Builds the file image and writes it out.
+ *
+ * @param filename the file to write
+ * @param type the kind of key
+ * @param pub the public key
+ * @param priv the private key, NULL for public keys
+ * @param priv_inv the inverse of the private key,
+ * NULL for public keys
+ * @param params the NTRU context
+ * @return true for success, false otherwise
+ */
+static bool
+keyfile_write(char const * const filename,
+		ntru_key_type type,
+		const fmpz_poly_t pub,
+		const fmpz_poly_t priv,
+		const fmpz_poly_t priv_inv,
+		const ntru_params *params);
+
+/**
+ * Checks that a coefficient array offset read from
+ * the header lies within the file.
+ *
+ * @param offset the offset from the header
+ * @param params the parameters from the header
+ * @param file_len the length of the file
+ * @return true if the array is valid, false otherwise
+ */
+static bool
+keyfile_check_offset(uint64_t offset,
+		const ntru_params *params,
+		size_t file_len);
+
+/**
+ * Checks whether the parameters of a view match.
+ *
+ * @param view the view
+ * @param params the NTRU context
+ * @return true if they match, false otherwise
+ */
+static bool
+keyfile_params_match(const ntru_key_view *view,
+		const ntru_params *params);
+
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+keyfile_array_len(const ntru_params *params)
+{
+	size_t len = params->N * sizeof(int16_t);
+
+	return (len + NTRU_KEYFILE_ALIGN - 1) &
+		~((size_t)NTRU_KEYFILE_ALIGN - 1);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_pack_poly(uint8_t *buf,
+		const fmpz_poly_t poly,
+		const ntru_params *params)
+{
+	for (uint32_t i = 0; i < params->N; i++) {
+		slong c = fmpz_poly_get_coeff_si(poly, i);
+
+		if (c < INT16_MIN || c > INT16_MAX)
+			return false;
+
+		put_le16(buf + i * sizeof(int16_t), (uint16_t)(int16_t)c);
+	}
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_unpack_poly(fmpz_poly_t poly,
+		const uint8_t *buf,
+		const ntru_params *params)
+{
+	fmpz_poly_zero(poly);
+
+	for (uint32_t i = 0; i < params->N; i++)
+		fmpz_poly_set_coeff_si(poly, i,
+				(int16_t)get_le16(buf + i * sizeof(int16_t)));
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+keyfile_write(char const * const filename,
+		ntru_key_type type,
+		const fmpz_poly_t pub,
+		const fmpz_poly_t priv,
+		const fmpz_poly_t priv_inv,
+		const ntru_params *params)
+{
+	size_t array_len = keyfile_array_len(params);
+	uint32_t num_arrays = (type == NTRU_KEY_PRIVATE) ? 3 : 1;
+	string image;
+	uint8_t *buf;
+	bool retval = false;
+
+	image.len = KEYFILE_HEADER_LEN + num_arrays * array_len;
+	image.ptr = ntru_calloc(1, image.len);
+	buf = (uint8_t *)image.ptr;
+
+	memcpy(buf, keyfile_magic, sizeof(keyfile_magic));
+	put_le16(buf + 8, NTRU_KEYFILE_VERSION);
+	put_le16(buf + 10, type);
+	put_le32(buf + 12, params->N);
+	put_le32(buf + 16, params->q);
+	put_le32(buf + 20, params->p);
+	put_le64(buf + 32, KEYFILE_HEADER_LEN);
+	put_le64(buf + 56, image.len);
+
+	if (!ntru_key_pack_poly(buf + KEYFILE_HEADER_LEN, pub, params))
+		goto cleanup;
+
+	if (type == NTRU_KEY_PRIVATE) {
+		put_le64(buf + 40, KEYFILE_HEADER_LEN + array_len);
+		put_le64(buf + 48, KEYFILE_HEADER_LEN + 2 * array_len);
+
+		if (!ntru_key_pack_poly(buf + KEYFILE_HEADER_LEN + array_len,
+					priv, params) ||
+				!ntru_key_pack_poly(buf + KEYFILE_HEADER_LEN + 2 * array_len,
+					priv_inv, params))
+			goto cleanup;
+	}
+
+	retval = write_file(&image, filename);
+
+cleanup:
+	free(image.ptr);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+keyfile_check_offset(uint64_t offset,
+		const ntru_params *params,
+		size_t file_len)
+{
+	if (offset < KEYFILE_HEADER_LEN ||
+			offset % NTRU_KEYFILE_ALIGN)
+		return false;
+
+	if (offset > file_len ||
+			file_len - offset < params->N * sizeof(int16_t))
+		return false;
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+keyfile_params_match(const ntru_key_view *view,
+		const ntru_params *params)
+{
+	return view->params.N == params->N &&
+		view->params.q == params->q &&
+		view->params.p == params->p;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+export_public_key_bin(char const * const filename,
+		const fmpz_poly_t pub,
+		const ntru_params *params)
+{
+	if (!filename || !pub || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return keyfile_write(filename, NTRU_KEY_PUBLIC, pub, NULL, NULL,
+			params);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+export_priv_key_bin(char const * const filename,
+		const keypair *pair,
+		const ntru_params *params)
+{
+	fmpz_poly_t priv,
+				priv_inv;
+	bool retval;
+
+	if (!filename || !pair || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	/* store the same representation import_priv_key() yields */
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+	fmpz_poly_set(priv, pair->priv);
+	fmpz_poly_set(priv_inv, pair->priv_inv);
+	fmpz_poly_mod(priv, params->p);
+	fmpz_poly_mod(priv_inv, params->p);
+
+	retval = keyfile_write(filename, NTRU_KEY_PRIVATE, pair->pub,
+			priv, priv_inv, params);
+
+	fmpz_poly_clear(priv);
+	fmpz_poly_clear(priv_inv);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+import_public_key_bin(fmpz_poly_t pub,
+		char const * const filename,
+		const ntru_params *params)
+{
+	ntru_key_view view;
+	bool retval = false;
+
+	if (!pub || !filename || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!ntru_key_view_open(&view, filename))
+		return false;
+
+	if (keyfile_params_match(&view, params)) {
+		ntru_key_view_get_poly(pub, view.pub, &view);
+		retval = true;
+	}
+
+	ntru_key_view_close(&view);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+import_priv_key_bin(fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		char const * const filename,
+		const ntru_params *params)
+{
+	ntru_key_view view;
+	bool retval = false;
+
+	if (!priv || !priv_inv || !filename || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!ntru_key_view_open(&view, filename))
+		return false;
+
+	if (view.type == NTRU_KEY_PRIVATE &&
+			keyfile_params_match(&view, params)) {
+		ntru_key_view_get_poly(priv, view.priv, &view);
+		ntru_key_view_get_poly(priv_inv, view.priv_inv, &view);
+		retval = true;
+	}
+
+	ntru_key_view_close(&view);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_file_is_bin(char const * const filename)
+{
+	ntru_key_view view;
+
+	if (!filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!ntru_key_view_open(&view, filename))
+		return false;
+
+	ntru_key_view_close(&view);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_view_open(ntru_key_view *view,
+		char const * const filename)
+{
+	struct stat s;
+	const uint8_t *buf;
+	uint64_t pub_off,
+			 priv_off,
+			 priv_inv_off;
+	int fd;
+
+	if (!view || !filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if ((fd = open(filename, O_RDONLY)) == -1)
+		return false;
+
+	if (fstat(fd, &s) == -1 ||
+			!S_ISREG(s.st_mode) ||
+			s.st_size < KEYFILE_HEADER_LEN) {
+		close(fd);
+		return false;
+	}
+
+	view->map_len = (size_t)s.st_size;
+	view->map = mmap(NULL, view->map_len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (view->map == MAP_FAILED)
+		return false;
+
+	buf = view->map;
+
+	if (memcmp(buf, keyfile_magic, sizeof(keyfile_magic)) ||
+			get_le16(buf + 8) != NTRU_KEYFILE_VERSION ||
+			get_le64(buf + 56) != view->map_len)
+		goto failure_cleanup;
+
+	view->type = get_le16(buf + 10);
+	view->params.N = get_le32(buf + 12);
+	view->params.q = get_le32(buf + 16);
+	view->params.p = get_le32(buf + 20);
+	pub_off = get_le64(buf + 32);
+	priv_off = get_le64(buf + 40);
+	priv_inv_off = get_le64(buf + 48);
+
+	if (view->params.N == 0 ||
+			!keyfile_check_offset(pub_off, &view->params, view->map_len))
+		goto failure_cleanup;
+
+	view->pub = (const int16_t *)(buf + pub_off);
+	view->priv = NULL;
+	view->priv_inv = NULL;
+
+	if (view->type == NTRU_KEY_PRIVATE) {
+		if (!keyfile_check_offset(priv_off, &view->params,
+					view->map_len) ||
+				!keyfile_check_offset(priv_inv_off, &view->params,
+					view->map_len))
+			goto failure_cleanup;
+
+		view->priv = (const int16_t *)(buf + priv_off);
+		view->priv_inv = (const int16_t *)(buf + priv_inv_off);
+	} else if (view->type != NTRU_KEY_PUBLIC) {
+		goto failure_cleanup;
+	}
+
+	return true;
+
+failure_cleanup:
+	munmap(view->map, view->map_len);
+	return false;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_view_get_poly(fmpz_poly_t poly,
+		const int16_t *coeffs,
+		const ntru_key_view *view)
+{
+	if (!poly || !coeffs || !view)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	ntru_key_unpack_poly(poly, (const uint8_t *)coeffs, &view->params);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_view_close(ntru_key_view *view)
+{
+	if (!view)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	munmap(view->map, view->map_len);
+	view->map = NULL;
+	view->map_len = 0;
+}
+
+/*------------------------------------------------------------------------*/
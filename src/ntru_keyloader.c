@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyloader.c
+ * This file implements bulk loading of private keys,
+ * which are decoded, inverted and validated in parallel
+ * on a thread pool.
+ * @brief bulk loading of private keys
+ */
+
+#include "ntru_err.h"
+#include "ntru_keyfile.h"
+#include "ntru_keyloader.h"
+#include "ntru_keypair.h"
+#include "ntru_lru.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_poly.h"
+#include "ntru_threadpool.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <fmpz_poly.h>
+
+
+typedef struct loader_entry loader_entry;
+
+
+/**
+ * State of a queued key.
+ */
+enum loader_state {
+	LOADER_PENDING,
+	LOADER_LOADED,
+	LOADER_FAILED,
+};
+
+/**
+ * A queued key.
+ */
+struct loader_entry {
+	/**
+	 * The loader this key belongs to.
+	 */
+	ntru_key_loader *loader;
+	/**
+	 * Whether the key is in flight, loaded or failed.
+	 */
+	enum loader_state state;
+	/**
+	 * The private key f, valid once loaded.
+	 */
+	fmpz_poly_t priv;
+	/**
+	 * The inverse Fp of f, valid once loaded.
+	 */
+	fmpz_poly_t priv_inv;
+	/**
+	 * The key file, NULL terminated.
+	 */
+	char filename[];
+};
+
+/**
+ * Loads private keys in parallel.
+ */
+struct ntru_key_loader {
+	/**
+	 * The NTRU context of all keys.
+	 */
+	ntru_params params;
+	/**
+	 * The pool the keys are loaded on.
+	 */
+	ntru_thread_pool *pool;
+	/**
+	 * Whether pool was created by the loader.
+	 */
+	bool own_pool;
+	/**
+	 * Maps file names to loader_entry.
+	 */
+	ntru_lru *keys;
+	/**
+	 * The progress counters.
+	 */
+	ntru_key_loader_stats stats;
+	/**
+	 * Protects keys, stats and the state of all entries.
+	 */
+	pthread_mutex_t lock;
+	/**
+	 * Signals that a key finished loading.
+	 */
+	pthread_cond_t progress;
+};
+
+
+/**
+ * Loads and validates one key, runs on the thread pool.
+ *
+ * @param arg the loader_entry
+ */
+static void
+loader_task(void *arg);
+
+/**
+ * Frees a loader_entry, used as callback for the LRU.
+ *
+ * @param value the loader_entry
+ */
+static void
+loader_entry_free(void *value);
+
+
+/*------------------------------------------------------------------------*/
+
+static void
+loader_task(void *arg)
+{
+	loader_entry *entry = arg;
+	ntru_key_loader *loader = entry->loader;
+	const ntru_params *params = &loader->params;
+	fmpz_poly_t check;
+	bool ok;
+
+	if (ntru_key_file_is_bin(entry->filename))
+		ok = import_priv_key_bin(entry->priv, entry->priv_inv,
+				entry->filename, params);
+	else
+		ok = import_priv_key(entry->priv, entry->priv_inv,
+				entry->filename, params);
+
+	/* f * Fp = 1 (mod p), so we never hand out a broken key */
+	if (ok) {
+		fmpz_poly_init(check);
+		poly_starmultiply(check, entry->priv, entry->priv_inv, params,
+				params->p);
+		ok = fmpz_poly_is_one(check);
+		fmpz_poly_clear(check);
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	entry->state = ok ? LOADER_LOADED : LOADER_FAILED;
+	loader->stats.pending--;
+	if (ok)
+		loader->stats.loaded++;
+	else
+		loader->stats.failed++;
+	pthread_cond_broadcast(&loader->progress);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+loader_entry_free(void *value)
+{
+	loader_entry *entry = value;
+
+	fmpz_poly_clear(entry->priv);
+	fmpz_poly_clear(entry->priv_inv);
+	free(entry);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_key_loader *
+ntru_key_loader_new(const ntru_params *params,
+		ntru_thread_pool *pool)
+{
+	ntru_key_loader *loader;
+
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	loader = ntru_calloc(1, sizeof(*loader));
+	loader->params = *params;
+
+	if (pool) {
+		loader->pool = pool;
+	} else if ((loader->pool = ntru_thread_pool_new(0))) {
+		loader->own_pool = true;
+	} else {
+		free(loader);
+		return NULL;
+	}
+
+	/* the cost limit is never reached, so nothing is evicted */
+	loader->keys = ntru_lru_new(SIZE_MAX, loader_entry_free);
+	pthread_mutex_init(&loader->lock, NULL);
+	pthread_cond_init(&loader->progress, NULL);
+
+	return loader;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_loader_add_file(ntru_key_loader *loader,
+		char const * const filename)
+{
+	loader_entry *entry;
+	size_t len;
+
+	if (!loader || !filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	len = strlen(filename);
+
+	pthread_mutex_lock(&loader->lock);
+	if (ntru_lru_get(loader->keys, filename, len)) {
+		pthread_mutex_unlock(&loader->lock);
+		return false;
+	}
+
+	entry = ntru_malloc(sizeof(*entry) + len + 1);
+	entry->loader = loader;
+	entry->state = LOADER_PENDING;
+	fmpz_poly_init(entry->priv);
+	fmpz_poly_init(entry->priv_inv);
+	memcpy(entry->filename, filename, len + 1);
+
+	ntru_lru_put(loader->keys, filename, len, entry, 1);
+	loader->stats.pending++;
+	pthread_mutex_unlock(&loader->lock);
+
+	ntru_thread_pool_submit(loader->pool, loader_task, entry);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_key_loader_add_dir(ntru_key_loader *loader,
+		char const * const dirname)
+{
+	DIR *dir;
+	struct dirent *ent;
+	size_t dir_len,
+		   queued = 0;
+
+	if (!loader || !dirname)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!(dir = opendir(dirname)))
+		return 0;
+
+	dir_len = strlen(dirname);
+
+	while ((ent = readdir(dir))) {
+		size_t name_len = strlen(ent->d_name);
+		char *path = ntru_malloc(dir_len + name_len + 2);
+		struct stat s;
+
+		memcpy(path, dirname, dir_len);
+		path[dir_len] = '/';
+		memcpy(path + dir_len + 1, ent->d_name, name_len + 1);
+
+		if (stat(path, &s) == 0 && S_ISREG(s.st_mode) &&
+				ntru_key_loader_add_file(loader, path))
+			queued++;
+
+		free(path);
+	}
+
+	closedir(dir);
+
+	return queued;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_key_loader_get_priv_key(ntru_key_loader *loader,
+		fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		char const * const filename,
+		bool wait)
+{
+	loader_entry *entry;
+	bool retval = false;
+
+	if (!loader || !priv || !priv_inv || !filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&loader->lock);
+	entry = ntru_lru_get(loader->keys, filename, strlen(filename));
+
+	while (entry && wait && entry->state == LOADER_PENDING)
+		pthread_cond_wait(&loader->progress, &loader->lock);
+
+	if (entry && entry->state == LOADER_LOADED) {
+		fmpz_poly_set(priv, entry->priv);
+		fmpz_poly_set(priv_inv, entry->priv_inv);
+		retval = true;
+	}
+	pthread_mutex_unlock(&loader->lock);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_loader_wait(ntru_key_loader *loader)
+{
+	if (!loader)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&loader->lock);
+	while (loader->stats.pending)
+		pthread_cond_wait(&loader->progress, &loader->lock);
+	pthread_mutex_unlock(&loader->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_loader_get_stats(ntru_key_loader *loader,
+		ntru_key_loader_stats *stats)
+{
+	if (!loader || !stats)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&loader->lock);
+	*stats = loader->stats;
+	pthread_mutex_unlock(&loader->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_loader_delete(ntru_key_loader *loader)
+{
+	if (!loader)
+		return;
+
+	ntru_key_loader_wait(loader);
+
+	if (loader->own_pool)
+		ntru_thread_pool_delete(loader->pool);
+
+	ntru_lru_delete(loader->keys);
+	pthread_mutex_destroy(&loader->lock);
+	pthread_cond_destroy(&loader->progress);
+	free(loader);
+}
+
+/*------------------------------------------------------------------------*/
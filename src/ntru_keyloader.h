@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyloader.h
+ * Header for the internal API of ntru_keyloader.c.
+ * @brief header for ntru_keyloader.c
+ */
+
+#ifndef NTRU_KEYLOADER_H
+#define NTRU_KEYLOADER_H
+
+
+#include "ntru_params.h"
+#include "ntru_threadpool.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <fmpz_poly.h>
+
+
+typedef struct ntru_key_loader ntru_key_loader;
+typedef struct ntru_key_loader_stats ntru_key_loader_stats;
+
+
+/**
+ * Progress of a key loader, see ntru_key_loader_get_stats().
+ */
+struct ntru_key_loader_stats {
+	/**
+	 * Number of keys that are loaded and validated.
+	 */
+	size_t loaded;
+	/**
+	 * Number of keys that could not be imported
+	 * or did not validate.
+	 */
+	size_t failed;
+	/**
+	 * Number of keys still in flight.
+	 */
+	size_t pending;
+};
+
+
+/**
+ * Creates a loader which imports private keys in parallel.
+ *
+ * @param params the NTRU context of all keys
+ * @param pool the thread pool to load keys on, can be NULL
+ * to use an own pool with one thread per online CPU
+ * @return the newly allocated loader, or NULL if no
+ * thread pool could be created
+ */
+ntru_key_loader *
+ntru_key_loader_new(const ntru_params *params,
+		ntru_thread_pool *pool);
+
+/**
+ * Queues a private key file for loading. Both the binary
+ * key format and the base64 one are understood.
+ *
+ * @param loader the loader
+ * @param filename the key file, also the name the key is
+ * looked up by later
+ * @return true if the file was queued, false if it
+ * was queued before
+ */
+bool
+ntru_key_loader_add_file(ntru_key_loader *loader,
+		char const * const filename);
+
+/**
+ * Queues all regular files in a directory for loading,
+ * see ntru_key_loader_add_file(), so the directory should
+ * not hold anything but private keys. The keys are looked up
+ * by "dirname/filename" later.
+ *
+ * @param loader the loader
+ * @param dirname the directory
+ * @return the number of newly queued files
+ */
+size_t
+ntru_key_loader_add_dir(ntru_key_loader *loader,
+		char const * const dirname);
+
+/**
+ * Get a loaded private key together with its inverse.
+ * Keys that are already loaded are served while others
+ * are still in flight.
+ *
+ * @param loader the loader
+ * @param priv where to save the private key, must be initialized [out]
+ * @param priv_inv where to save the inverse of the private key,
+ * must be initialized [out]
+ * @param filename the key file, as it was queued
+ * @param wait whether to wait for the key if it is still in flight
+ * @return true for success, false if the key is unknown, failed
+ * to load or is still in flight and wait is false
+ */
+bool
+ntru_key_loader_get_priv_key(ntru_key_loader *loader,
+		fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		char const * const filename,
+		bool wait);
+
+/**
+ * Waits until all queued keys are either loaded or failed.
+ *
+ * @param loader the loader
+ */
+void
+ntru_key_loader_wait(ntru_key_loader *loader);
+
+/**
+ * Get a snapshot of the progress of the loader.
+ *
+ * @param loader the loader
+ * @param stats where to store the progress [out]
+ */
+void
+ntru_key_loader_get_stats(ntru_key_loader *loader,
+		ntru_key_loader_stats *stats);
+
+/**
+ * Waits for all keys in flight and frees the loader
+ * together with all loaded keys.
+ *
+ * @param loader the loader to free
+ */
+void
+ntru_key_loader_delete(ntru_key_loader *loader);
+
+
+#endif /* NTRU_KEYLOADER_H */
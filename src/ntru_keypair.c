@@ -29,18 +29,165 @@
 #include "ntru_ascii_poly.h"
 #include "ntru_file.h"
 #include "ntru_keypair.h"
+#include "ntru_mem.h"
 #include "ntru_params.h"
 #include "ntru_poly.h"
 #include "ntru_poly_ascii.h"
+#include "ntru_rnd.h"
 #include "ntru_string.h"
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
 
 
+/**
+ * Maximum number of f/g candidates that are tried by
+ * ntru_generate_keypair() before giving up.
+ */
+#define NTRU_KEYGEN_MAX_TRIES 1000
+
+
+typedef struct keygen_job keygen_job;
+
+
+/**
+ * State shared between the worker threads of a
+ * parallel ntru_generate_keypair() run.
+ */
+struct keygen_job {
+	/**
+	 * Where the first successful candidate is stored.
+	 */
+	keypair *pair;
+	/**
+	 * The NTRU context.
+	 */
+	const ntru_params *params;
+	/**
+	 * The rng for the sampler.
+	 */
+	ntru_rng *rng;
+	/**
+	 * Number of candidates that have been started so far.
+	 */
+	uint32_t tries;
+	/**
+	 * Whether a worker already stored a keypair.
+	 */
+	bool done;
+	/**
+	 * Protects tries, done and pair.
+	 */
+	pthread_mutex_t lock;
+};
+
+
+/**
+ * Sample one f/g candidate with the weights given by
+ * NTRU_DF() and NTRU_DG() and try to build a keypair from it.
+ *
+ * @param pair where to store the keypair on success (the polynomials
+ * will be initialized only on success) [out]
+ * @param params the NTRU context
+ * @param rng the rng to sample from, NULL for the per-thread DRBG
+ * @return true for success, false if f was not invertible
+ */
+static bool
+keypair_try_candidate(keypair *pair,
+		const ntru_params *params,
+		ntru_rng *rng);
+
+/**
+ * Thread entry point for the parallel keypair generation.
+ * Keeps trying candidates until one of the workers succeeded
+ * or the maximum number of tries is exhausted.
+ *
+ * @param arg the shared keygen_job
+ * @return always NULL
+ */
+static void *
+keygen_worker(void *arg);
+
+/**
+ * Checks that an imported key file holds exactly one poly
+ * and frees the array otherwise, so that a stray file does
+ * not take the whole process down.
+ *
+ * @param imported the array from base64_to_poly_arr()
+ * @return true if there is exactly one poly, false if the
+ * array was freed
+ */
+static bool
+import_single_poly(fmpz_poly_t **imported);
+
+
+/*------------------------------------------------------------------------*/
+
+static bool
+keypair_try_candidate(keypair *pair,
+		const ntru_params *params,
+		ntru_rng *rng)
+{
+	bool retval;
+	fmpz_poly_t f,
+				g;
+
+	fmpz_poly_init(f);
+	fmpz_poly_init(g);
+
+	ntru_get_rnd_tern_poly_num(f, params,
+			NTRU_DF(params), NTRU_DF(params) - 1, rng);
+	ntru_get_rnd_tern_poly_num(g, params,
+			NTRU_DG(params), NTRU_DG(params), rng);
+
+	retval = ntru_create_keypair(pair, f, g, params);
+
+	fmpz_poly_clear(f);
+	fmpz_poly_clear(g);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void *
+keygen_worker(void *arg)
+{
+	keygen_job *job = arg;
+
+	while (1) {
+		keypair candidate;
+
+		pthread_mutex_lock(&job->lock);
+		if (job->done || job->tries >= NTRU_KEYGEN_MAX_TRIES) {
+			pthread_mutex_unlock(&job->lock);
+			break;
+		}
+		job->tries++;
+		pthread_mutex_unlock(&job->lock);
+
+		if (!keypair_try_candidate(&candidate, job->params, job->rng))
+			continue;
+
+		pthread_mutex_lock(&job->lock);
+		if (!job->done) {
+			/* hand over the polynomials, no copy needed */
+			*job->pair = candidate;
+			job->done = true;
+		} else {
+			ntru_delete_keypair(&candidate);
+		}
+		pthread_mutex_unlock(&job->lock);
+	}
+
+	return NULL;
+}
+
+
 /*------------------------------------------------------------------------*/
 
 bool
@@ -92,6 +239,55 @@ _cleanup:
 
 /*------------------------------------------------------------------------*/
 
+bool
+ntru_generate_keypair(keypair *pair,
+		const ntru_params *params,
+		uint32_t num_threads,
+		ntru_rng *rng)
+{
+	keygen_job job;
+	pthread_t *threads;
+	uint32_t started = 0;
+
+	if (!pair || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (num_threads <= 1) {
+		for (uint32_t i = 0; i < NTRU_KEYGEN_MAX_TRIES; i++)
+			if (keypair_try_candidate(pair, params, rng))
+				return true;
+
+		return false;
+	}
+
+	job.pair = pair;
+	job.params = params;
+	job.rng = rng;
+	job.tries = 0;
+	job.done = false;
+	pthread_mutex_init(&job.lock, NULL);
+
+	threads = ntru_malloc(sizeof(*threads) * num_threads);
+
+	for (uint32_t i = 0; i < num_threads; i++)
+		if (!pthread_create(&threads[started], NULL, keygen_worker, &job))
+			started++;
+
+	/* could not spawn any thread, do the work ourselves */
+	if (!started)
+		keygen_worker(&job);
+
+	for (uint32_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+	pthread_mutex_destroy(&job.lock);
+
+	return job.done;
+}
+
+/*------------------------------------------------------------------------*/
+
 bool
 export_public_key(char const * const filename,
 		const fmpz_poly_t pub,
@@ -140,6 +336,23 @@ export_priv_key(char const * const filename,
 
 /*------------------------------------------------------------------------*/
 
+static bool
+import_single_poly(fmpz_poly_t **imported)
+{
+	if (imported[0] && !imported[1])
+		return true;
+
+	/* poly_delete_array() only frees an array of more than one */
+	if (imported[0])
+		poly_delete_array(imported);
+	else
+		free(imported);
+
+	return false;
+}
+
+/*------------------------------------------------------------------------*/
+
 bool
 import_public_key(fmpz_poly_t pub,
 		char const * const filename,
@@ -155,15 +368,15 @@ import_public_key(fmpz_poly_t pub,
 		return false;
 
 	imported = base64_to_poly_arr(pub_string, params);
+	string_delete(pub_string);
+	if (!imported)
+		return false;
 
-	/* if the array exceeds one element, then something
-	 * went horribly wrong */
-	if (*imported[1])
-		NTRU_ABORT_DEBUG("Failed importing public key!");
+	if (!import_single_poly(imported))
+		return false;
 
 	fmpz_poly_set(pub, **imported);
 
-	string_delete(pub_string);
 	poly_delete_array(imported);
 	free(imported);
 
@@ -181,6 +394,7 @@ import_priv_key(fmpz_poly_t priv,
 	string *priv_string;
 	fmpz_poly_t **imported,
 				Fp;
+	bool retval = false;
 
 	if (!priv || !priv_inv || !filename || !params)
 		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
@@ -188,16 +402,16 @@ import_priv_key(fmpz_poly_t priv,
 	if (!(priv_string = read_file(filename)))
 		return false;
 
-	fmpz_poly_init(Fp);
-
 	imported = base64_to_poly_arr(priv_string, params);
-	fmpz_poly_mod(**imported, params->p);
+	string_delete(priv_string);
+	if (!imported)
+		return false;
 
-	/* if the array exceeds one element, then something
-	 * went horribly wrong */
-	if (*imported[1])
-		NTRU_ABORT_DEBUG("Failed importing private key!");
+	if (!import_single_poly(imported))
+		return false;
 
+	fmpz_poly_init(Fp);
+	fmpz_poly_mod(**imported, params->p);
 	fmpz_poly_set(priv, **imported);
 
 	if (!poly_inverse_poly_p(Fp, priv, params))
@@ -206,14 +420,14 @@ import_priv_key(fmpz_poly_t priv,
 	fmpz_poly_mod(Fp, params->p);
 
 	fmpz_poly_set(priv_inv, Fp);
-	fmpz_poly_clear(Fp);
+	retval = true;
 
 cleanup:
-	string_delete(priv_string);
+	fmpz_poly_clear(Fp);
 	poly_delete_array(imported);
 	free(imported);
 
-	return true;
+	return retval;
 }
 
 /*------------------------------------------------------------------------*/
@@ -30,6 +30,7 @@
 
 
 #include "ntru_params.h"
+#include "ntru_rnd.h"
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
@@ -83,6 +84,34 @@ ntru_create_keypair(
 		const fmpz_poly_t g,
 		const ntru_params *params);
 
+/**
+ * Generates a complete NTRU key pair. The polynomials f and g
+ * are sampled with the weights given by NTRU_DF() and NTRU_DG()
+ * and new candidates are drawn until f is invertible.
+ *
+ * If num_threads is larger than 1, then that many worker threads
+ * try candidates in parallel and the first success is taken,
+ * which cuts the tail latency of unlucky inversions. Which
+ * candidate wins is then up to the scheduler, so use a single
+ * thread and a seeded rng (see ntru_rng_new_seeded()) if the
+ * result must be reproducible.
+ *
+ * @param pair store private and public components here (the
+ * polynomials inside the struct will be automatically
+ * initialized) [out]
+ * @param params the NTRU context
+ * @param num_threads the number of worker threads, 0 or 1
+ * for sequential generation
+ * @param rng the rng to sample from, NULL for the per-thread DRBG
+ * @return true for success, false if no invertible f was found
+ * within a sane number of tries
+ */
+bool
+ntru_generate_keypair(keypair *pair,
+		const ntru_params *params,
+		uint32_t num_threads,
+		ntru_rng *rng);
+
 /**
  * Export the public key to a file.
  *
@@ -116,6 +145,7 @@ export_priv_key(char const * const filename,
  * @param filename the file to get the public key from
  * @param params the NTRU context
  * @return true for success, false if any of the file operations failed
+ * or the file does not hold exactly one key
  */
 bool
 import_public_key(fmpz_poly_t pub,
@@ -131,7 +161,8 @@ import_public_key(fmpz_poly_t pub,
  * must be initialized [out]
  * @param filename the file to get the private key from
  * @param params the NTRU context
- * @return true for success, false if any of the file operations failed
+ * @return true for success, false if any of the file operations failed,
+ * the file does not hold exactly one key or the key is not invertible
  */
 bool
 import_priv_key(fmpz_poly_t priv,
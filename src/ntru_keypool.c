@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keypool.c
+ * This file implements a pool of pre-generated
+ * keypairs, which is refilled by a background thread,
+ * so that callers needing fresh keys don't have to
+ * wait for key generation inline.
+ * @brief pool of pre-generated keypairs
+ */
+
+#include "ntru_err.h"
+#include "ntru_keypair.h"
+#include "ntru_keypool.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+/**
+ * Wait after the first failed key generation in a row,
+ * in nanoseconds.
+ */
+#define KEYPOOL_BACKOFF_MIN_NS 1000000
+
+/**
+ * Maximum wait after failed key generations in a row,
+ * in nanoseconds.
+ */
+#define KEYPOOL_BACKOFF_MAX_NS 1000000000
+
+/**
+ * A pool of ready keypairs and its refill thread.
+ */
+struct ntru_keypool {
+	/**
+	 * The NTRU context all keypairs are generated for.
+	 */
+	ntru_params params;
+	/**
+	 * The rng for key generation, may be NULL.
+	 */
+	ntru_rng *rng;
+	/**
+	 * The ready keypairs, used as a stack.
+	 */
+	keypair *pairs;
+	/**
+	 * Number of ready keypairs in pairs.
+	 */
+	uint32_t count;
+	/**
+	 * Refill when count drops below this.
+	 */
+	uint32_t low_watermark;
+	/**
+	 * Refill up to this, also the capacity of pairs.
+	 */
+	uint32_t high_watermark;
+	/**
+	 * The counters, available is kept in count.
+	 */
+	ntru_keypool_stats stats;
+	/**
+	 * Whether the refill thread should terminate.
+	 */
+	bool stop;
+	/**
+	 * Protects everything above.
+	 */
+	pthread_mutex_t lock;
+	/**
+	 * Signals the refill thread that the pool dropped
+	 * below the low watermark or should stop.
+	 */
+	pthread_cond_t wakeup;
+	/**
+	 * The refill thread.
+	 */
+	pthread_t thread;
+};
+
+
+/**
+ * Get the value of the monotonic clock in nanoseconds.
+ *
+ * @return current time in nanoseconds
+ */
+static uint64_t
+get_time_ns(void);
+
+/**
+ * Waits until the given time has passed or the pool
+ * is woken up, with the lock held.
+ *
+ * @param pool the ntru_keypool
+ * @param ns how long to wait at most, in nanoseconds
+ */
+static void
+keypool_backoff(ntru_keypool *pool, uint64_t ns);
+
+/**
+ * Thread entry point of the refill thread. Sleeps until
+ * the pool drops below the low watermark and then generates
+ * keypairs until the high watermark is reached. Failed
+ * generations are retried after a growing wait.
+ *
+ * @param arg the ntru_keypool
+ * @return always NULL
+ */
+static void *
+keypool_refill(void *arg);
+
+
+/*------------------------------------------------------------------------*/
+
+static uint64_t
+get_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+keypool_backoff(ntru_keypool *pool, uint64_t ns)
+{
+	struct timespec ts;
+
+	/* the condition variable waits on the realtime clock */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ns += ts.tv_nsec;
+	ts.tv_sec += ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+
+	pthread_cond_timedwait(&pool->wakeup, &pool->lock, &ts);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void *
+keypool_refill(void *arg)
+{
+	ntru_keypool *pool = arg;
+	uint64_t backoff = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (!pool->stop) {
+		if (pool->count >= pool->low_watermark) {
+			pthread_cond_wait(&pool->wakeup, &pool->lock);
+			continue;
+		}
+
+		pool->stats.refills++;
+
+		while (!pool->stop && pool->count < pool->high_watermark) {
+			keypair pair;
+			uint64_t start,
+					 elapsed;
+			bool generated;
+
+			/* don't block take() while generating */
+			pthread_mutex_unlock(&pool->lock);
+			start = get_time_ns();
+			generated = ntru_generate_keypair(&pair, &pool->params, 1,
+					pool->rng);
+			elapsed = get_time_ns() - start;
+			pthread_mutex_lock(&pool->lock);
+
+			/* retry later, a pool that silently stops
+			 * refilling would only show up as misses */
+			if (!generated) {
+				NTRU_WARN_DEBUG("Failed generating keypair, "
+						"retrying");
+				pool->stats.failures++;
+				backoff = backoff ? 2 * backoff : KEYPOOL_BACKOFF_MIN_NS;
+				if (backoff > KEYPOOL_BACKOFF_MAX_NS)
+					backoff = KEYPOOL_BACKOFF_MAX_NS;
+				keypool_backoff(pool, backoff);
+				continue;
+			}
+			backoff = 0;
+
+			pool->pairs[pool->count++] = pair;
+			pool->stats.generated++;
+			pool->stats.refill_ns_total += elapsed;
+			if (elapsed > pool->stats.refill_ns_max)
+				pool->stats.refill_ns_max = elapsed;
+		}
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_keypool *
+ntru_keypool_new(const ntru_params *params,
+		uint32_t low_watermark,
+		uint32_t high_watermark,
+		ntru_rng *rng)
+{
+	ntru_keypool *pool;
+
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	/* with a low watermark of 0 the pool would never refill */
+	if (!low_watermark || low_watermark > high_watermark)
+		return NULL;
+
+	pool = ntru_calloc(1, sizeof(*pool));
+	pool->params = *params;
+	pool->rng = rng;
+	pool->low_watermark = low_watermark;
+	pool->high_watermark = high_watermark;
+	pool->pairs = ntru_malloc(sizeof(*pool->pairs) * high_watermark);
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wakeup, NULL);
+
+	if (pthread_create(&pool->thread, NULL, keypool_refill, pool)) {
+		pthread_cond_destroy(&pool->wakeup);
+		pthread_mutex_destroy(&pool->lock);
+		free(pool->pairs);
+		free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keypool_take(ntru_keypool *pool, keypair *pair)
+{
+	bool hit = false;
+
+	if (!pool || !pair)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&pool->lock);
+
+	if (pool->count) {
+		*pair = pool->pairs[--pool->count];
+		pool->stats.hits++;
+		hit = true;
+	} else {
+		pool->stats.misses++;
+	}
+
+	if (pool->count < pool->low_watermark)
+		pthread_cond_signal(&pool->wakeup);
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return hit;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_keypool_get_stats(ntru_keypool *pool, ntru_keypool_stats *stats)
+{
+	if (!pool || !stats)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&pool->lock);
+	*stats = pool->stats;
+	stats->available = pool->count;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_keypool_delete(ntru_keypool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_signal(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_join(pool->thread, NULL);
+
+	for (uint32_t i = 0; i < pool->count; i++)
+		ntru_delete_keypair(&pool->pairs[i]);
+
+	pthread_cond_destroy(&pool->wakeup);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->pairs);
+	free(pool);
+}
+
+/*------------------------------------------------------------------------*/
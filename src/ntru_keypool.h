@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keypool.h
+ * Header for the internal API of ntru_keypool.c.
+ * @brief header for ntru_keypool.c
+ */
+
+#ifndef NTRU_KEYPOOL_H
+#define NTRU_KEYPOOL_H
+
+
+#include "ntru_keypair.h"
+#include "ntru_params.h"
+#include "ntru_rnd.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+typedef struct ntru_keypool ntru_keypool;
+typedef struct ntru_keypool_stats ntru_keypool_stats;
+
+
+/**
+ * Counters of a key pool, see ntru_keypool_get_stats().
+ */
+struct ntru_keypool_stats {
+	/**
+	 * Number of ntru_keypool_take() calls that
+	 * got a ready keypair.
+	 */
+	uint64_t hits;
+	/**
+	 * Number of ntru_keypool_take() calls that
+	 * found the pool empty.
+	 */
+	uint64_t misses;
+	/**
+	 * Number of keypairs generated by the
+	 * background thread.
+	 */
+	uint64_t generated;
+	/**
+	 * Number of refill cycles, e.g. how often the pool
+	 * fell below the low watermark.
+	 */
+	uint64_t refills;
+	/**
+	 * Number of failed key generations of the background
+	 * thread, which are retried after a growing wait.
+	 */
+	uint64_t failures;
+	/**
+	 * Accumulated time in nanoseconds spent generating keypairs
+	 * in the background.
+	 */
+	uint64_t refill_ns_total;
+	/**
+	 * Longest time in nanoseconds spent generating a single
+	 * keypair in the background.
+	 */
+	uint64_t refill_ns_max;
+	/**
+	 * Number of keypairs that are currently ready.
+	 */
+	uint32_t available;
+};
+
+
+/**
+ * Creates a pool of pre-generated keypairs for the given
+ * NTRU context and starts the background thread filling it.
+ * Whenever the number of ready keypairs drops below
+ * low_watermark, the pool is refilled up to high_watermark.
+ *
+ * @param params the NTRU context (will be copied)
+ * @param low_watermark refill when less keypairs than this are ready,
+ * must be larger than 0
+ * @param high_watermark the maximum number of ready keypairs,
+ * must be at least low_watermark
+ * @param rng the rng to generate the keys from, NULL for the
+ * per-thread DRBG of the background thread, must stay alive
+ * until the pool is deleted
+ * @return the newly allocated pool, NULL if the watermarks
+ * are invalid or the thread could not be started
+ */
+ntru_keypool *
+ntru_keypool_new(const ntru_params *params,
+		uint32_t low_watermark,
+		uint32_t high_watermark,
+		ntru_rng *rng);
+
+/**
+ * Takes a ready keypair out of the pool, without blocking.
+ * On a miss the caller is expected to fall back to
+ * ntru_generate_keypair() itself.
+ *
+ * @param pool the key pool
+ * @param pair where to store the keypair (the polynomials inside
+ * the struct will be automatically initialized, the caller
+ * owns them afterwards) [out]
+ * @return true for a hit, false if the pool was empty
+ */
+bool
+ntru_keypool_take(ntru_keypool *pool, keypair *pair);
+
+/**
+ * Get a snapshot of the counters of the pool.
+ *
+ * @param pool the key pool
+ * @param stats where to store the counters [out]
+ */
+void
+ntru_keypool_get_stats(ntru_keypool *pool, ntru_keypool_stats *stats);
+
+/**
+ * Stops the background thread and frees the pool
+ * including all keypairs that are still in it.
+ *
+ * @param pool the key pool to free
+ */
+void
+ntru_keypool_delete(ntru_keypool *pool);
+
+
+#endif /* NTRU_KEYPOOL_H */
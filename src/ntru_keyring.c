@@ -0,0 +1,638 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyring.c
+ * This file handles keyrings, single files holding many
+ * public keys of one parameter set together with an on-disk
+ * hash index keyed by the key fingerprint. All values are
+ * little endian. The layout is:
+ *
+ *   offset  size  field
+ *        0     8  magic "NTRUKRG\0"
+ *        8     2  format version
+ *       10     2  reserved, zero
+ *       12     4  N
+ *       16     4  q
+ *       20     4  p
+ *       24     4  record length
+ *       28     4  reserved, zero
+ *       32     8  number of indexed records
+ *       40     8  offset of the hash index
+ *       48     8  number of index slots, a power of 2
+ *       56     8  offset of the appended records
+ *
+ * followed by the indexed records, the hash index and the
+ * records appended since the last compaction. A record is the
+ * fingerprint followed by N int16_t coefficients, padded to
+ * NTRU_KEYFILE_ALIGN. An index slot holds the record number
+ * plus one, or zero if it is empty, collisions are resolved
+ * by linear probing.
+ * @brief keyrings of public keys
+ */
+
+#include "ntru_common.h"
+#include "ntru_err.h"
+#include "ntru_file.h"
+#include "ntru_keyfile.h"
+#include "ntru_keyring.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_string.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Size of the file header.
+ */
+#define KEYRING_HEADER_LEN 64
+
+/**
+ * Size of one slot of the hash index.
+ */
+#define KEYRING_SLOT_LEN 8
+
+/**
+ * Minimum number of slots of the hash index.
+ */
+#define KEYRING_MIN_SLOTS 16
+
+/**
+ * Magic bytes at the start of every keyring file.
+ */
+static const char keyring_magic[8] = "NTRUKRG";
+
+
+/**
+ * An opened keyring file.
+ */
+struct ntru_keyring {
+	/**
+	 * Path of the keyring file, NULL terminated.
+	 */
+	char *filename;
+	/**
+	 * The parameter set of all keys.
+	 */
+	ntru_params params;
+	/**
+	 * Start of the mapping.
+	 */
+	uint8_t *map;
+	/**
+	 * Length of the mapping.
+	 */
+	size_t map_len;
+	/**
+	 * Size of one record.
+	 */
+	size_t record_len;
+	/**
+	 * Number of records covered by the index.
+	 */
+	uint64_t indexed_count;
+	/**
+	 * Offset of the hash index.
+	 */
+	uint64_t index_offset;
+	/**
+	 * Number of index slots.
+	 */
+	uint64_t index_slots;
+	/**
+	 * Offset of the appended records.
+	 */
+	uint64_t tail_offset;
+	/**
+	 * Number of appended records.
+	 */
+	uint64_t tail_count;
+};
+
+
+/**
+ * Size of one record, padded to the alignment.
+ *
+ * @param params the NTRU context
+ * @return padded size in bytes
+ */
+static size_t
+keyring_record_len(const ntru_params *params);
+
+/**
+ * Builds the header of a keyring file.
+ *
+ * @param buf where to store the header [out]
+ * @param params the NTRU context
+ * @param indexed_count number of indexed records
+ * @param index_slots number of index slots
+ */
+static void
+keyring_put_header(uint8_t *buf,
+		const ntru_params *params,
+		uint64_t indexed_count,
+		uint64_t index_slots);
+
+/**
+ * (Re)maps the keyring file and validates the header.
+ * The previous mapping, if any, is dropped.
+ *
+ * @param ring the keyring, with filename set
+ * @return true for success, false if the file could not be
+ * mapped or is malformed, in which case nothing is mapped
+ */
+static bool
+keyring_map(ntru_keyring *ring);
+
+/**
+ * Unmaps the keyring file, leaving an empty keyring behind.
+ *
+ * @param ring the keyring
+ */
+static void
+keyring_unmap(ntru_keyring *ring);
+
+/**
+ * Get the record with the given number, where the
+ * appended records follow the indexed ones.
+ *
+ * @param ring the keyring
+ * @param num the record number
+ * @return pointer to the record inside the mapping
+ */
+static const uint8_t *
+keyring_record(const ntru_keyring *ring,
+		uint64_t num);
+
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+keyring_record_len(const ntru_params *params)
+{
+	size_t len = sizeof(uint64_t) + params->N * sizeof(int16_t);
+
+	return (len + NTRU_KEYFILE_ALIGN - 1) &
+		~((size_t)NTRU_KEYFILE_ALIGN - 1);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+keyring_put_header(uint8_t *buf,
+		const ntru_params *params,
+		uint64_t indexed_count,
+		uint64_t index_slots)
+{
+	size_t record_len = keyring_record_len(params);
+	uint64_t index_offset = KEYRING_HEADER_LEN +
+		indexed_count * record_len;
+
+	memset(buf, 0, KEYRING_HEADER_LEN);
+	memcpy(buf, keyring_magic, sizeof(keyring_magic));
+	put_le16(buf + 8, NTRU_KEYRING_VERSION);
+	put_le32(buf + 12, params->N);
+	put_le32(buf + 16, params->q);
+	put_le32(buf + 20, params->p);
+	put_le32(buf + 24, record_len);
+	put_le64(buf + 32, indexed_count);
+	put_le64(buf + 40, index_offset);
+	put_le64(buf + 48, index_slots);
+	put_le64(buf + 56, index_offset + index_slots * KEYRING_SLOT_LEN);
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+keyring_map(ntru_keyring *ring)
+{
+	struct stat s;
+	uint8_t *buf;
+	int fd;
+
+	keyring_unmap(ring);
+
+	if ((fd = open(ring->filename, O_RDONLY)) == -1)
+		return false;
+
+	if (fstat(fd, &s) == -1 ||
+			!S_ISREG(s.st_mode) ||
+			s.st_size < KEYRING_HEADER_LEN) {
+		close(fd);
+		return false;
+	}
+
+	buf = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (buf == MAP_FAILED)
+		return false;
+
+	ring->map = buf;
+	ring->map_len = (size_t)s.st_size;
+
+	if (memcmp(buf, keyring_magic, sizeof(keyring_magic)) ||
+			get_le16(buf + 8) != NTRU_KEYRING_VERSION)
+		goto failure_cleanup;
+
+	ring->params.N = get_le32(buf + 12);
+	ring->params.q = get_le32(buf + 16);
+	ring->params.p = get_le32(buf + 20);
+	ring->indexed_count = get_le64(buf + 32);
+	ring->index_offset = get_le64(buf + 40);
+	ring->index_slots = get_le64(buf + 48);
+	ring->tail_offset = get_le64(buf + 56);
+
+	if (ring->params.N == 0)
+		goto failure_cleanup;
+
+	ring->record_len = keyring_record_len(&ring->params);
+
+	/* the layout must be exactly what keyring_put_header() wrote,
+	 * check in an order that cannot overflow */
+	if (get_le32(buf + 24) != ring->record_len ||
+			ring->indexed_count > ring->map_len / ring->record_len ||
+			ring->index_offset != KEYRING_HEADER_LEN +
+				ring->indexed_count * ring->record_len ||
+			ring->index_slots > ring->map_len / KEYRING_SLOT_LEN ||
+			(ring->index_slots & (ring->index_slots - 1)) ||
+			ring->index_slots < ring->indexed_count ||
+			ring->tail_offset != ring->index_offset +
+				ring->index_slots * KEYRING_SLOT_LEN ||
+			ring->tail_offset > ring->map_len)
+		goto failure_cleanup;
+
+	/* a torn append leaves a partial record behind, ignore it */
+	ring->tail_count = (ring->map_len - ring->tail_offset) /
+		ring->record_len;
+
+	return true;
+
+failure_cleanup:
+	keyring_unmap(ring);
+	return false;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+keyring_unmap(ntru_keyring *ring)
+{
+	if (ring->map)
+		munmap(ring->map, ring->map_len);
+
+	ring->map = NULL;
+	ring->map_len = 0;
+	ring->indexed_count = 0;
+	ring->index_slots = 0;
+	ring->tail_count = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+static const uint8_t *
+keyring_record(const ntru_keyring *ring,
+		uint64_t num)
+{
+	if (num < ring->indexed_count)
+		return ring->map + KEYRING_HEADER_LEN + num * ring->record_len;
+
+	return ring->map + ring->tail_offset +
+		(num - ring->indexed_count) * ring->record_len;
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t
+ntru_key_fingerprint(const fmpz_poly_t pub,
+		const ntru_params *params)
+{
+	uint8_t buf[12];
+	uint64_t hash = FNV1A_64_INIT;
+
+	if (!pub || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	put_le32(buf, params->N);
+	put_le32(buf + 4, params->q);
+	put_le32(buf + 8, params->p);
+	hash = fnv1a_64(hash, buf, sizeof(buf));
+
+	for (uint32_t i = 0; i < params->N; i++) {
+		put_le16(buf, (uint16_t)fmpz_poly_get_coeff_si(pub, i));
+		hash = fnv1a_64(hash, buf, sizeof(int16_t));
+	}
+
+	return hash;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keyring_create(char const * const filename,
+		const ntru_params *params)
+{
+	uint8_t header[KEYRING_HEADER_LEN];
+	string image;
+
+	if (!filename || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	keyring_put_header(header, params, 0, 0);
+
+	image.ptr = (char *)header;
+	image.len = sizeof(header);
+
+	return write_file(&image, filename);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_keyring *
+ntru_keyring_open(char const * const filename)
+{
+	ntru_keyring *ring;
+	size_t len;
+
+	if (!filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	len = strlen(filename);
+
+	ring = ntru_calloc(1, sizeof(*ring));
+	ring->filename = ntru_malloc(len + 1);
+	memcpy(ring->filename, filename, len + 1);
+
+	if (!keyring_map(ring)) {
+		free(ring->filename);
+		free(ring);
+		return NULL;
+	}
+
+	return ring;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_keyring_get_params(const ntru_keyring *ring,
+		ntru_params *params)
+{
+	if (!ring || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	*params = ring->params;
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_keyring_count(const ntru_keyring *ring)
+{
+	if (!ring)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return ring->indexed_count + ring->tail_count;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keyring_add(ntru_keyring *ring,
+		const fmpz_poly_t pub,
+		uint64_t *fingerprint)
+{
+	uint8_t *record;
+	const int16_t *stored;
+	struct stat s;
+	uint64_t fp;
+	size_t written = 0;
+	int fd;
+	bool retval = false;
+
+	if (!ring || !pub)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	fp = ntru_key_fingerprint(pub, &ring->params);
+	if (fingerprint)
+		*fingerprint = fp;
+
+	record = ntru_calloc(1, ring->record_len);
+	put_le64(record, fp);
+	if (!ntru_key_pack_poly(record + sizeof(uint64_t), pub, &ring->params))
+		goto cleanup;
+
+	/* a different key with the same fingerprint could never
+	 * be looked up, so only the very same key is fine */
+	if ((stored = ntru_keyring_lookup(ring, fp))) {
+		retval = !memcmp(stored, record + sizeof(uint64_t),
+				ring->params.N * sizeof(int16_t));
+		goto cleanup;
+	}
+
+	if ((fd = open(ring->filename, O_WRONLY | O_APPEND)) == -1)
+		goto cleanup;
+
+	/* cut off what a torn append left behind, or every record
+	 * appended after it would be misaligned. Use the size of the
+	 * file, not of the mapping, to keep what others appended */
+	if (fstat(fd, &s) == -1 || (uint64_t)s.st_size < ring->tail_offset ||
+			ftruncate(fd, s.st_size - (s.st_size - ring->tail_offset) %
+				ring->record_len) == -1) {
+		close(fd);
+		goto cleanup;
+	}
+
+	while (written < ring->record_len) {
+		ssize_t n = write(fd, record + written,
+				ring->record_len - written);
+
+		if (n == -1) {
+			NTRU_WARN_DEBUG("Failed while appending to keyring");
+			close(fd);
+			goto cleanup;
+		}
+		written += n;
+	}
+
+	if (close(fd))
+		goto cleanup;
+
+	retval = keyring_map(ring);
+
+cleanup:
+	free(record);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+const int16_t *
+ntru_keyring_lookup(const ntru_keyring *ring,
+		uint64_t fingerprint)
+{
+	const uint8_t *record;
+
+	if (!ring)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (ring->index_slots) {
+		const uint8_t *index = ring->map + ring->index_offset;
+		uint64_t mask = ring->index_slots - 1;
+		uint64_t slot = fingerprint & mask;
+
+		for (uint64_t i = 0; i < ring->index_slots; i++) {
+			uint64_t num = get_le64(index + slot * KEYRING_SLOT_LEN);
+
+			if (num == 0 || num > ring->indexed_count)
+				break;
+
+			record = keyring_record(ring, num - 1);
+			if (get_le64(record) == fingerprint)
+				return (const int16_t *)(record + sizeof(uint64_t));
+
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	for (uint64_t i = 0; i < ring->tail_count; i++) {
+		record = keyring_record(ring, ring->indexed_count + i);
+		if (get_le64(record) == fingerprint)
+			return (const int16_t *)(record + sizeof(uint64_t));
+	}
+
+	return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keyring_get_public_key(fmpz_poly_t pub,
+		const ntru_keyring *ring,
+		uint64_t fingerprint)
+{
+	const int16_t *coeffs;
+
+	if (!pub || !ring)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!(coeffs = ntru_keyring_lookup(ring, fingerprint)))
+		return false;
+
+	ntru_key_unpack_poly(pub, (const uint8_t *)coeffs, &ring->params);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keyring_compact(ntru_keyring *ring)
+{
+	uint64_t count,
+			 slots = KEYRING_MIN_SLOTS;
+	uint8_t *buf,
+			*index;
+	char *tmp_name;
+	size_t name_len;
+	string image;
+	bool retval = false;
+
+	if (!ring)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	count = ntru_keyring_count(ring);
+
+	/* keep the load factor at or below 1/2 */
+	while (slots < 2 * count)
+		slots <<= 1;
+
+	image.len = KEYRING_HEADER_LEN + count * ring->record_len +
+		slots * KEYRING_SLOT_LEN;
+	image.ptr = ntru_calloc(1, image.len);
+	buf = (uint8_t *)image.ptr;
+	index = buf + KEYRING_HEADER_LEN + count * ring->record_len;
+
+	keyring_put_header(buf, &ring->params, count, slots);
+
+	for (uint64_t i = 0; i < count; i++) {
+		const uint8_t *record = keyring_record(ring, i);
+		uint64_t slot = get_le64(record) & (slots - 1);
+
+		memcpy(buf + KEYRING_HEADER_LEN + i * ring->record_len, record,
+				ring->record_len);
+
+		while (get_le64(index + slot * KEYRING_SLOT_LEN))
+			slot = (slot + 1) & (slots - 1);
+		put_le64(index + slot * KEYRING_SLOT_LEN, i + 1);
+	}
+
+	/* write to a temporary file and rename it over the keyring,
+	 * so readers see either the old or the new file */
+	name_len = strlen(ring->filename);
+	tmp_name = ntru_malloc(name_len + sizeof(".tmp"));
+	memcpy(tmp_name, ring->filename, name_len);
+	memcpy(tmp_name + name_len, ".tmp", sizeof(".tmp"));
+
+	if (!write_file(&image, tmp_name))
+		goto cleanup;
+
+	if (rename(tmp_name, ring->filename)) {
+		remove(tmp_name);
+		goto cleanup;
+	}
+
+	retval = keyring_map(ring);
+
+cleanup:
+	free(tmp_name);
+	free(image.ptr);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_keyring_close(ntru_keyring *ring)
+{
+	if (!ring)
+		return;
+
+	keyring_unmap(ring);
+	free(ring->filename);
+	free(ring);
+}
+
+/*------------------------------------------------------------------------*/
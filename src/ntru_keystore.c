@@ -0,0 +1,760 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keystore.c
+ * This file implements read-only key stores, which lay out
+ * many keys of one parameter set together with their
+ * precomputed inverse in a POSIX shared memory object or a
+ * file, so that many processes can map them instead of each
+ * importing their own copy. All values are little endian.
+ * The layout is:
+ *
+ *   offset  size  field
+ *        0     8  magic "NTRUKST\0"
+ *        8     2  format version
+ *       10     2  reserved, zero
+ *       12     4  N
+ *       16     4  q
+ *       20     4  p
+ *       24     4  record length
+ *       28     4  reserved, zero
+ *       32     8  number of records
+ *       40     8  offset of the hash index
+ *       48     8  number of index slots, a power of 2
+ *       56     8  total length
+ *
+ * followed by the records, the hash index and the names. The
+ * first NTRU_KEYFILE_ALIGN bytes of a record hold the 64 bit
+ * FNV-1a hash of the key name, 4 bytes of flags, 4 reserved
+ * bytes and the 8 byte offset and 4 byte length of the name
+ * within the names, followed by the aligned coefficient arrays
+ * of h, f and Fp. An index slot holds the record number plus
+ * one, or zero if it is empty, collisions are resolved by
+ * linear probing. Names are not NULL terminated.
+ * @brief shared read-only key stores
+ */
+
+#include "ntru_common.h"
+#include "ntru_err.h"
+#include "ntru_file.h"
+#include "ntru_keyfile.h"
+#include "ntru_keypair.h"
+#include "ntru_keystore.h"
+#include "ntru_lru.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_poly.h"
+#include "ntru_string.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Size of the header.
+ */
+#define KEYSTORE_HEADER_LEN 64
+
+/**
+ * Size of one slot of the hash index.
+ */
+#define KEYSTORE_SLOT_LEN 8
+
+/**
+ * Minimum number of slots of the hash index.
+ */
+#define KEYSTORE_MIN_SLOTS 16
+
+/**
+ * Size of the part of a record before the coefficients.
+ */
+#define KEYSTORE_RECORD_HEAD NTRU_KEYFILE_ALIGN
+
+/**
+ * Record flag: the record holds f and Fp.
+ */
+#define KEYSTORE_FLAG_PRIVATE 0x1
+
+/**
+ * Magic bytes at the start of every key store.
+ */
+static const char keystore_magic[8] = "NTRUKST";
+
+
+/**
+ * Collects keys until they are written out.
+ */
+struct ntru_keystore_builder {
+	/**
+	 * The NTRU context of all keys.
+	 */
+	ntru_params params;
+	/**
+	 * The records, in the layout of the store.
+	 */
+	uint8_t *records;
+	/**
+	 * Number of records.
+	 */
+	size_t count;
+	/**
+	 * Number of records that fit into records.
+	 */
+	size_t capacity;
+	/**
+	 * Size of one record.
+	 */
+	size_t record_len;
+	/**
+	 * The names of all records, one after the other.
+	 */
+	char *names;
+	/**
+	 * Length of all names.
+	 */
+	size_t names_len;
+	/**
+	 * Number of bytes that fit into names.
+	 */
+	size_t names_capacity;
+	/**
+	 * Set of the names that are taken.
+	 */
+	ntru_lru *taken;
+};
+
+/**
+ * An attached key store.
+ */
+struct ntru_keystore {
+	/**
+	 * The NTRU context of all keys.
+	 */
+	ntru_params params;
+	/**
+	 * Start of the mapping.
+	 */
+	const uint8_t *map;
+	/**
+	 * Length of the mapping.
+	 */
+	size_t map_len;
+	/**
+	 * Size of one record.
+	 */
+	size_t record_len;
+	/**
+	 * Number of records.
+	 */
+	uint64_t count;
+	/**
+	 * Number of index slots.
+	 */
+	uint64_t index_slots;
+	/**
+	 * Start of the names.
+	 */
+	const char *names;
+	/**
+	 * Length of all names.
+	 */
+	uint64_t names_len;
+};
+
+
+/**
+ * Size of one coefficient array, padded to the alignment.
+ *
+ * @param params the NTRU context
+ * @return padded size in bytes
+ */
+static size_t
+keystore_array_len(const ntru_params *params);
+
+/**
+ * Hashes a key name.
+ *
+ * @param name the name, NULL terminated
+ * @return the hash
+ */
+static uint64_t
+keystore_id(char const * const name);
+
+/**
+ * Appends a new, zeroed record to a builder.
+ *
+ * @param builder the builder
+ * @param name the name of the key
+ * @return the record, or NULL if the name is already taken
+ */
+static uint8_t *
+keystore_builder_append(ntru_keystore_builder *builder,
+		char const * const name);
+
+/**
+ * Counts the record appended last and takes its name.
+ *
+ * @param builder the builder
+ * @param name the name of the key
+ */
+static void
+keystore_builder_commit(ntru_keystore_builder *builder,
+		char const * const name);
+
+/**
+ * Builds the whole store in memory.
+ *
+ * @param builder the builder
+ * @return the newly allocated image
+ */
+static string *
+keystore_build_image(const ntru_keystore_builder *builder);
+
+/**
+ * Maps a key store read-only and validates it.
+ *
+ * @param fd file descriptor of the store, is closed
+ * @return the newly allocated store, or NULL if the store
+ * could not be mapped or is malformed
+ */
+static ntru_keystore *
+keystore_attach_fd(int fd);
+
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+keystore_array_len(const ntru_params *params)
+{
+	size_t len = params->N * sizeof(int16_t);
+
+	return (len + NTRU_KEYFILE_ALIGN - 1) &
+		~((size_t)NTRU_KEYFILE_ALIGN - 1);
+}
+
+/*------------------------------------------------------------------------*/
+
+static uint64_t
+keystore_id(char const * const name)
+{
+	return fnv1a_64(FNV1A_64_INIT, name, strlen(name));
+}
+
+/*------------------------------------------------------------------------*/
+
+static uint8_t *
+keystore_builder_append(ntru_keystore_builder *builder,
+		char const * const name)
+{
+	size_t name_len = strlen(name);
+	uint8_t *record;
+
+	/* the set only tracks presence, any non-NULL value will do */
+	if (ntru_lru_get(builder->taken, name, name_len) ||
+			name_len > UINT32_MAX)
+		return NULL;
+
+	if (builder->count == builder->capacity) {
+		builder->capacity = builder->capacity ? 2 * builder->capacity : 16;
+		REALLOC(builder->records, builder->capacity * builder->record_len);
+	}
+
+	while (builder->names_len + name_len > builder->names_capacity) {
+		builder->names_capacity = builder->names_capacity ?
+			2 * builder->names_capacity : 256;
+		REALLOC(builder->names, builder->names_capacity);
+	}
+
+	record = builder->records + builder->count * builder->record_len;
+	memset(record, 0, builder->record_len);
+	put_le64(record, keystore_id(name));
+	put_le64(record + 16, builder->names_len);
+	put_le32(record + 24, name_len);
+
+	return record;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+keystore_builder_commit(ntru_keystore_builder *builder,
+		char const * const name)
+{
+	size_t name_len = strlen(name);
+
+	memcpy(builder->names + builder->names_len, name, name_len);
+	builder->names_len += name_len;
+	ntru_lru_put(builder->taken, name, name_len, builder, 0);
+	builder->count++;
+}
+
+/*------------------------------------------------------------------------*/
+
+static string *
+keystore_build_image(const ntru_keystore_builder *builder)
+{
+	string *image = ntru_malloc(sizeof(*image));
+	uint64_t slots = KEYSTORE_MIN_SLOTS;
+	uint64_t index_offset = KEYSTORE_HEADER_LEN +
+		builder->count * builder->record_len;
+	uint8_t *buf,
+			*index;
+
+	/* keep the load factor at or below 1/2 */
+	while (slots < 2 * builder->count)
+		slots <<= 1;
+
+	image->len = index_offset + slots * KEYSTORE_SLOT_LEN +
+		builder->names_len;
+	image->ptr = ntru_calloc(1, image->len);
+	buf = (uint8_t *)image->ptr;
+	index = buf + index_offset;
+
+	memcpy(buf, keystore_magic, sizeof(keystore_magic));
+	put_le16(buf + 8, NTRU_KEYSTORE_VERSION);
+	put_le32(buf + 12, builder->params.N);
+	put_le32(buf + 16, builder->params.q);
+	put_le32(buf + 20, builder->params.p);
+	put_le32(buf + 24, builder->record_len);
+	put_le64(buf + 32, builder->count);
+	put_le64(buf + 40, index_offset);
+	put_le64(buf + 48, slots);
+	put_le64(buf + 56, image->len);
+
+	if (builder->count)
+		memcpy(buf + KEYSTORE_HEADER_LEN, builder->records,
+				builder->count * builder->record_len);
+	if (builder->names_len)
+		memcpy(index + slots * KEYSTORE_SLOT_LEN, builder->names,
+				builder->names_len);
+
+	for (uint64_t i = 0; i < builder->count; i++) {
+		const uint8_t *record = builder->records + i * builder->record_len;
+		uint64_t slot = get_le64(record) & (slots - 1);
+
+		while (get_le64(index + slot * KEYSTORE_SLOT_LEN))
+			slot = (slot + 1) & (slots - 1);
+		put_le64(index + slot * KEYSTORE_SLOT_LEN, i + 1);
+	}
+
+	return image;
+}
+
+/*------------------------------------------------------------------------*/
+
+static ntru_keystore *
+keystore_attach_fd(int fd)
+{
+	ntru_keystore *store;
+	struct stat s;
+	const uint8_t *buf;
+	void *map;
+	uint64_t index_offset;
+
+	if (fstat(fd, &s) == -1 ||
+			s.st_size < KEYSTORE_HEADER_LEN) {
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return NULL;
+
+	store = ntru_calloc(1, sizeof(*store));
+	store->map = buf = map;
+	store->map_len = (size_t)s.st_size;
+
+	if (memcmp(buf, keystore_magic, sizeof(keystore_magic)) ||
+			get_le16(buf + 8) != NTRU_KEYSTORE_VERSION ||
+			get_le64(buf + 56) != store->map_len)
+		goto failure_cleanup;
+
+	store->params.N = get_le32(buf + 12);
+	store->params.q = get_le32(buf + 16);
+	store->params.p = get_le32(buf + 20);
+	store->count = get_le64(buf + 32);
+	index_offset = get_le64(buf + 40);
+	store->index_slots = get_le64(buf + 48);
+
+	if (store->params.N == 0)
+		goto failure_cleanup;
+
+	store->record_len = KEYSTORE_RECORD_HEAD +
+		3 * keystore_array_len(&store->params);
+
+	/* the layout must be exactly what keystore_build_image()
+	 * wrote, check in an order that cannot overflow */
+	if (get_le32(buf + 24) != store->record_len ||
+			store->count > store->map_len / store->record_len ||
+			index_offset != KEYSTORE_HEADER_LEN +
+				store->count * store->record_len ||
+			store->index_slots == 0 ||
+			(store->index_slots & (store->index_slots - 1)) ||
+			store->index_slots < store->count ||
+			store->index_slots > store->map_len / KEYSTORE_SLOT_LEN ||
+			index_offset + store->index_slots * KEYSTORE_SLOT_LEN >
+				store->map_len)
+		goto failure_cleanup;
+
+	store->names = (const char *)buf + index_offset +
+		store->index_slots * KEYSTORE_SLOT_LEN;
+	store->names_len = store->map_len - (index_offset +
+			store->index_slots * KEYSTORE_SLOT_LEN);
+
+	return store;
+
+failure_cleanup:
+	ntru_keystore_detach(store);
+	return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_keystore_builder *
+ntru_keystore_builder_new(const ntru_params *params)
+{
+	ntru_keystore_builder *builder;
+
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	builder = ntru_calloc(1, sizeof(*builder));
+	builder->params = *params;
+	builder->record_len = KEYSTORE_RECORD_HEAD +
+		3 * keystore_array_len(params);
+	builder->taken = ntru_lru_new(SIZE_MAX, NULL);
+
+	return builder;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keystore_builder_add_keypair(ntru_keystore_builder *builder,
+		char const * const name,
+		const keypair *pair)
+{
+	size_t array_len;
+	fmpz_poly_t priv,
+				priv_inv;
+	uint8_t *record;
+	bool retval;
+
+	if (!builder || !name || !pair)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!(record = keystore_builder_append(builder, name)))
+		return false;
+
+	array_len = keystore_array_len(&builder->params);
+
+	/* store the same representation import_priv_key() yields */
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+	fmpz_poly_set(priv, pair->priv);
+	fmpz_poly_set(priv_inv, pair->priv_inv);
+	fmpz_poly_mod(priv, builder->params.p);
+	fmpz_poly_mod(priv_inv, builder->params.p);
+
+	put_le32(record + 8, KEYSTORE_FLAG_PRIVATE);
+	retval = ntru_key_pack_poly(record + KEYSTORE_RECORD_HEAD,
+				pair->pub, &builder->params) &&
+		ntru_key_pack_poly(record + KEYSTORE_RECORD_HEAD + array_len,
+				priv, &builder->params) &&
+		ntru_key_pack_poly(record + KEYSTORE_RECORD_HEAD + 2 * array_len,
+				priv_inv, &builder->params);
+
+	fmpz_poly_clear(priv);
+	fmpz_poly_clear(priv_inv);
+
+	if (retval)
+		keystore_builder_commit(builder, name);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keystore_builder_add_public_key(ntru_keystore_builder *builder,
+		char const * const name,
+		const fmpz_poly_t pub)
+{
+	uint8_t *record;
+
+	if (!builder || !name || !pub)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!(record = keystore_builder_append(builder, name)))
+		return false;
+
+	if (!ntru_key_pack_poly(record + KEYSTORE_RECORD_HEAD, pub,
+				&builder->params))
+		return false;
+
+	keystore_builder_commit(builder, name);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keystore_builder_write_shm(const ntru_keystore_builder *builder,
+		char const * const shm_name)
+{
+	string *image;
+	size_t written = sizeof(keystore_magic);
+	int fd;
+	bool retval = false;
+
+	if (!builder || !shm_name)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	/* truncating the old object would make attached readers
+	 * fault, unlinking leaves them their mapping. There is no
+	 * rename for shared memory objects, so the new one gets
+	 * the name right away and only counts as a key store once
+	 * its magic is written, last */
+	if (shm_unlink(shm_name) == -1 && errno != ENOENT)
+		return false;
+	if ((fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600)) == -1)
+		return false;
+
+	image = keystore_build_image(builder);
+
+	if (ftruncate(fd, image->len) == -1)
+		goto cleanup;
+
+	while (written < image->len) {
+		ssize_t n = pwrite(fd, image->ptr + written, image->len - written,
+				written);
+
+		if (n == -1) {
+			NTRU_WARN_DEBUG("Failed while writing key store");
+			goto cleanup;
+		}
+		written += n;
+	}
+
+	retval = pwrite(fd, keystore_magic, sizeof(keystore_magic), 0) ==
+		sizeof(keystore_magic);
+
+cleanup:
+	close(fd);
+	string_delete(image);
+	if (!retval)
+		shm_unlink(shm_name);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keystore_builder_write_file(const ntru_keystore_builder *builder,
+		char const * const filename)
+{
+	string *image;
+	bool retval;
+
+	if (!builder || !filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	image = keystore_build_image(builder);
+	retval = replace_file(image, filename);
+	string_delete(image);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_keystore_builder_delete(ntru_keystore_builder *builder)
+{
+	if (!builder)
+		return;
+
+	ntru_lru_delete(builder->taken);
+	free(builder->records);
+	free(builder->names);
+	free(builder);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_keystore *
+ntru_keystore_attach_shm(char const * const shm_name)
+{
+	int fd;
+
+	if (!shm_name)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if ((fd = shm_open(shm_name, O_RDONLY, 0)) == -1)
+		return NULL;
+
+	return keystore_attach_fd(fd);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_keystore *
+ntru_keystore_attach_file(char const * const filename)
+{
+	int fd;
+
+	if (!filename)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if ((fd = open(filename, O_RDONLY)) == -1)
+		return NULL;
+
+	return keystore_attach_fd(fd);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t
+ntru_keystore_count(const ntru_keystore *store)
+{
+	if (!store)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return store->count;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keystore_get(const ntru_keystore *store,
+		char const * const name,
+		ntru_key_handle *handle)
+{
+	const uint8_t *index;
+	uint64_t id,
+			 mask,
+			 slot;
+	size_t array_len,
+		   name_len;
+
+	if (!store || !name || !handle)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	name_len = strlen(name);
+	id = keystore_id(name);
+	mask = store->index_slots - 1;
+	index = store->map + KEYSTORE_HEADER_LEN +
+		store->count * store->record_len;
+	array_len = keystore_array_len(&store->params);
+
+	slot = id & mask;
+	for (uint64_t i = 0; i < store->index_slots; i++) {
+		uint64_t num = get_le64(index + slot * KEYSTORE_SLOT_LEN);
+		const uint8_t *record;
+
+		if (num == 0 || num > store->count)
+			break;
+
+		record = store->map + KEYSTORE_HEADER_LEN +
+			(num - 1) * store->record_len;
+
+		/* different names may share a hash */
+		if (get_le64(record) == id &&
+				get_le32(record + 24) == name_len &&
+				name_len <= store->names_len &&
+				get_le64(record + 16) <= store->names_len - name_len &&
+				!memcmp(store->names + get_le64(record + 16), name,
+					name_len)) {
+			const uint8_t *arrays = record + KEYSTORE_RECORD_HEAD;
+
+			handle->params = store->params;
+			handle->pub = (const int16_t *)arrays;
+			handle->priv = NULL;
+			handle->priv_inv = NULL;
+
+			if (get_le32(record + 8) & KEYSTORE_FLAG_PRIVATE) {
+				handle->priv = (const int16_t *)(arrays + array_len);
+				handle->priv_inv = (const int16_t *)(arrays + 2 * array_len);
+			}
+
+			return true;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return false;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_key_handle_get_poly(fmpz_poly_t poly,
+		const int16_t *coeffs,
+		const ntru_key_handle *handle)
+{
+	if (!poly || !coeffs || !handle)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	ntru_key_unpack_poly(poly, (const uint8_t *)coeffs, &handle->params);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_keystore_detach(ntru_keystore *store)
+{
+	if (!store)
+		return;
+
+	munmap((void *)store->map, store->map_len);
+	free(store);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_keystore_unlink_shm(char const * const shm_name)
+{
+	if (!shm_name)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return shm_unlink(shm_name) == 0;
+}
+
+/*------------------------------------------------------------------------*/
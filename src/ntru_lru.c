@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_lru.c
+ * This file implements a generic least-recently-used cache,
+ * a hash table with chaining whose entries are also kept
+ * in a doubly linked list ordered by last use.
+ * @brief generic LRU cache
+ */
+
+#include "ntru_common.h"
+#include "ntru_lru.h"
+#include "ntru_mem.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * Initial number of hash buckets, must be a power of 2.
+ */
+#define LRU_MIN_BUCKETS 16
+
+
+typedef struct lru_entry lru_entry;
+
+
+/**
+ * One cached key/value pair.
+ */
+struct lru_entry {
+	/**
+	 * Next entry in the same hash bucket.
+	 */
+	lru_entry *hnext;
+	/**
+	 * More recently used neighbour.
+	 */
+	lru_entry *prev;
+	/**
+	 * Less recently used neighbour.
+	 */
+	lru_entry *next;
+	/**
+	 * Hash of the key.
+	 */
+	uint64_t hash;
+	/**
+	 * The value, owned by the cache.
+	 */
+	void *value;
+	/**
+	 * The cost of this entry.
+	 */
+	size_t cost;
+	/**
+	 * Length of key in bytes.
+	 */
+	size_t key_len;
+	/**
+	 * The key.
+	 */
+	unsigned char key[];
+};
+
+/**
+ * The cache.
+ */
+struct ntru_lru {
+	/**
+	 * Hash buckets, the number is always a power of 2.
+	 */
+	lru_entry **buckets;
+	/**
+	 * Number of hash buckets.
+	 */
+	size_t bucket_c;
+	/**
+	 * Most recently used entry.
+	 */
+	lru_entry *head;
+	/**
+	 * Least recently used entry.
+	 */
+	lru_entry *tail;
+	/**
+	 * Evict when the accumulated cost exceeds this.
+	 */
+	size_t max_cost;
+	/**
+	 * Frees values, can be NULL.
+	 */
+	void (*free_value)(void *value);
+	/**
+	 * The counters.
+	 */
+	ntru_cache_stats stats;
+};
+
+
+/**
+ * FNV-1a hash of a byte string.
+ *
+ * @param key the bytes to hash
+ * @param key_len the number of bytes
+ * @return the 64bit hash
+ */
+static uint64_t
+lru_hash(const void *key, size_t key_len);
+
+/**
+ * Finds the entry of a key.
+ *
+ * @param lru the cache
+ * @param key the key
+ * @param key_len the length of the key
+ * @param hash the hash of the key
+ * @return pointer to the bucket slot that points to the entry,
+ * or to the NULL slot at the end of the chain if there is none
+ */
+static lru_entry **
+lru_find(ntru_lru *lru, const void *key, size_t key_len, uint64_t hash);
+
+/**
+ * Unlinks an entry from the use list.
+ *
+ * @param lru the cache
+ * @param entry the entry
+ */
+static void
+lru_unlink(ntru_lru *lru, lru_entry *entry);
+
+/**
+ * Links an entry at the front of the use list.
+ *
+ * @param lru the cache
+ * @param entry the entry
+ */
+static void
+lru_push_front(ntru_lru *lru, lru_entry *entry);
+
+/**
+ * Unlinks an entry from the table and the use list and
+ * frees it along with its value.
+ *
+ * @param lru the cache
+ * @param slot the bucket slot pointing to the entry
+ */
+static void
+lru_drop(ntru_lru *lru, lru_entry **slot);
+
+/**
+ * Doubles the number of buckets and rehashes all entries.
+ *
+ * @param lru the cache
+ */
+static void
+lru_grow(ntru_lru *lru);
+
+
+/*------------------------------------------------------------------------*/
+
+static uint64_t
+lru_hash(const void *key, size_t key_len)
+{
+	return fnv1a_64(FNV1A_64_INIT, key, key_len);
+}
+
+/*------------------------------------------------------------------------*/
+
+static lru_entry **
+lru_find(ntru_lru *lru, const void *key, size_t key_len, uint64_t hash)
+{
+	lru_entry **slot = &lru->buckets[hash & (lru->bucket_c - 1)];
+
+	while (*slot) {
+		if ((*slot)->hash == hash && (*slot)->key_len == key_len &&
+				!memcmp((*slot)->key, key, key_len))
+			break;
+		slot = &(*slot)->hnext;
+	}
+
+	return slot;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+lru_unlink(ntru_lru *lru, lru_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		lru->head = entry->next;
+
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		lru->tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+lru_push_front(ntru_lru *lru, lru_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = lru->head;
+
+	if (lru->head)
+		lru->head->prev = entry;
+	else
+		lru->tail = entry;
+
+	lru->head = entry;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+lru_drop(ntru_lru *lru, lru_entry **slot)
+{
+	lru_entry *entry = *slot;
+
+	*slot = entry->hnext;
+	lru_unlink(lru, entry);
+
+	lru->stats.entries--;
+	lru->stats.cost -= entry->cost;
+
+	if (lru->free_value)
+		lru->free_value(entry->value);
+	free(entry);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+lru_grow(ntru_lru *lru)
+{
+	size_t new_c = lru->bucket_c * 2;
+	lru_entry **new_buckets = ntru_calloc(new_c, sizeof(*new_buckets));
+
+	for (size_t i = 0; i < lru->bucket_c; i++) {
+		lru_entry *entry = lru->buckets[i];
+
+		while (entry) {
+			lru_entry *hnext = entry->hnext;
+			size_t b = entry->hash & (new_c - 1);
+
+			entry->hnext = new_buckets[b];
+			new_buckets[b] = entry;
+			entry = hnext;
+		}
+	}
+
+	free(lru->buckets);
+	lru->buckets = new_buckets;
+	lru->bucket_c = new_c;
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_lru *
+ntru_lru_new(size_t max_cost, void (*free_value)(void *value))
+{
+	ntru_lru *lru = ntru_calloc(1, sizeof(*lru));
+
+	lru->bucket_c = LRU_MIN_BUCKETS;
+	lru->buckets = ntru_calloc(lru->bucket_c, sizeof(*lru->buckets));
+	lru->max_cost = max_cost;
+	lru->free_value = free_value;
+
+	return lru;
+}
+
+/*------------------------------------------------------------------------*/
+
+void *
+ntru_lru_get(ntru_lru *lru, const void *key, size_t key_len)
+{
+	lru_entry *entry;
+
+	entry = *lru_find(lru, key, key_len, lru_hash(key, key_len));
+
+	if (!entry) {
+		lru->stats.misses++;
+		return NULL;
+	}
+
+	lru->stats.hits++;
+
+	if (lru->head != entry) {
+		lru_unlink(lru, entry);
+		lru_push_front(lru, entry);
+	}
+
+	return entry->value;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_lru_put(ntru_lru *lru,
+		const void *key,
+		size_t key_len,
+		void *value,
+		size_t cost)
+{
+	uint64_t hash = lru_hash(key, key_len);
+	lru_entry **slot;
+	lru_entry *entry;
+
+	slot = lru_find(lru, key, key_len, hash);
+	if (*slot)
+		lru_drop(lru, slot);
+
+	if (cost > lru->max_cost) {
+		if (lru->free_value)
+			lru->free_value(value);
+		return;
+	}
+
+	/* make room, least recently used first */
+	while (lru->stats.cost + cost > lru->max_cost) {
+		lru_entry *victim = lru->tail;
+
+		lru_drop(lru, lru_find(lru, victim->key, victim->key_len,
+					victim->hash));
+		lru->stats.evictions++;
+	}
+
+	if (lru->stats.entries >= lru->bucket_c)
+		lru_grow(lru);
+
+	entry = ntru_malloc(sizeof(*entry) + key_len);
+	memcpy(entry->key, key, key_len);
+	entry->key_len = key_len;
+	entry->hash = hash;
+	entry->value = value;
+	entry->cost = cost;
+
+	slot = &lru->buckets[hash & (lru->bucket_c - 1)];
+	entry->hnext = *slot;
+	*slot = entry;
+	lru_push_front(lru, entry);
+
+	lru->stats.entries++;
+	lru->stats.cost += cost;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_lru_remove(ntru_lru *lru, const void *key, size_t key_len)
+{
+	lru_entry **slot;
+
+	slot = lru_find(lru, key, key_len, lru_hash(key, key_len));
+	if (!*slot)
+		return false;
+
+	lru_drop(lru, slot);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_lru_get_stats(const ntru_lru *lru, ntru_cache_stats *stats)
+{
+	*stats = lru->stats;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_lru_delete(ntru_lru *lru)
+{
+	if (!lru)
+		return;
+
+	while (lru->head)
+		lru_drop(lru, lru_find(lru, lru->head->key, lru->head->key_len,
+					lru->head->hash));
+
+	free(lru->buckets);
+	free(lru);
+}
+
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_lru.h
+ * Header for the internal API of ntru_lru.c.
+ * @brief header for ntru_lru.c
+ */
+
+#ifndef NTRU_LRU_H
+#define NTRU_LRU_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+typedef struct ntru_lru ntru_lru;
+typedef struct ntru_cache_stats ntru_cache_stats;
+
+
+/**
+ * Counters of a cache.
+ */
+struct ntru_cache_stats {
+	/**
+	 * Number of lookups that found an entry.
+	 */
+	uint64_t hits;
+	/**
+	 * Number of lookups that found nothing.
+	 */
+	uint64_t misses;
+	/**
+	 * Number of entries that were dropped
+	 * to stay within the cost limit.
+	 */
+	uint64_t evictions;
+	/**
+	 * Number of entries currently cached.
+	 */
+	size_t entries;
+	/**
+	 * Accumulated cost of all cached entries.
+	 */
+	size_t cost;
+};
+
+
+/**
+ * Creates an empty least-recently-used cache that maps
+ * byte string keys to arbitrary values. This is not thread-safe,
+ * callers have to provide their own locking.
+ *
+ * @param max_cost the maximum accumulated cost of all entries,
+ * the least recently used ones are evicted when it is exceeded
+ * @param free_value called on values that are evicted, replaced
+ * or freed together with the cache, can be NULL
+ * @return the newly allocated cache
+ */
+ntru_lru *
+ntru_lru_new(size_t max_cost, void (*free_value)(void *value));
+
+/**
+ * Looks up a key and marks the entry as most recently used.
+ *
+ * @param lru the cache
+ * @param key the key
+ * @param key_len the length of the key in bytes
+ * @return the value, owned by the cache, or NULL if there is none
+ */
+void *
+ntru_lru_get(ntru_lru *lru, const void *key, size_t key_len);
+
+/**
+ * Inserts or replaces an entry. The cache takes ownership
+ * of the value. If cost alone exceeds the maximum cost,
+ * the value is freed right away and not cached.
+ *
+ * @param lru the cache
+ * @param key the key, will be copied
+ * @param key_len the length of the key in bytes
+ * @param value the value
+ * @param cost the cost of this entry, e.g. its memory footprint
+ */
+void
+ntru_lru_put(ntru_lru *lru,
+		const void *key,
+		size_t key_len,
+		void *value,
+		size_t cost);
+
+/**
+ * Removes an entry and frees its value.
+ *
+ * @param lru the cache
+ * @param key the key
+ * @param key_len the length of the key in bytes
+ * @return true if there was such an entry, false otherwise
+ */
+bool
+ntru_lru_remove(ntru_lru *lru, const void *key, size_t key_len);
+
+/**
+ * Get a snapshot of the counters of the cache.
+ *
+ * @param lru the cache
+ * @param stats where to store the counters [out]
+ */
+void
+ntru_lru_get_stats(const ntru_lru *lru, ntru_cache_stats *stats);
+
+/**
+ * Frees the cache and all values in it.
+ *
+ * @param lru the cache to free
+ */
+void
+ntru_lru_delete(ntru_lru *lru);
+
+
+#endif /* NTRU_LRU_H */
@@ -28,10 +28,79 @@
 
 #include "ntru_mem.h"
 
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 
+typedef struct scratch_buf scratch_buf;
+
+
+/**
+ * The per-thread buffer behind ntru_scratch().
+ */
+struct scratch_buf {
+	/**
+	 * The memory.
+	 */
+	void *ptr;
+	/**
+	 * Its size in bytes.
+	 */
+	size_t size;
+};
+
+
+/**
+ * Makes sure scratch_key is created exactly once.
+ */
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Thread-specific key of the scratch_buf of each thread.
+ */
+static pthread_key_t scratch_key;
+
+
+/**
+ * Creates scratch_key.
+ */
+static void
+scratch_init(void);
+
+/**
+ * Frees the scratch_buf of an exiting thread.
+ *
+ * @param arg the scratch_buf
+ */
+static void
+scratch_free(void *arg);
+
+
+/*------------------------------------------------------------------------*/
+
+static void
+scratch_init(void)
+{
+	if (pthread_key_create(&scratch_key, scratch_free)) {
+		fprintf(stderr, "failed to create the scratch key, aborting!");
+		abort();
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+scratch_free(void *arg)
+{
+	scratch_buf *buf = arg;
+
+	free(buf->ptr);
+	free(buf);
+}
+
+
 /*------------------------------------------------------------------------*/
 
 void *
@@ -69,3 +138,57 @@ ntru_calloc(size_t nmemb, size_t size)
 }
 
 /*------------------------------------------------------------------------*/
+
+void *
+ntru_scratch(size_t size)
+{
+	scratch_buf *buf;
+
+	pthread_once(&scratch_once, scratch_init);
+
+	if (!(buf = pthread_getspecific(scratch_key))) {
+		buf = ntru_calloc(1, sizeof(*buf));
+		pthread_setspecific(scratch_key, buf);
+	}
+
+	if (buf->size < size) {
+		/* grow geometrically, so slowly growing inputs settle fast */
+		size_t new_size = buf->size * 2 > size ? buf->size * 2 : size;
+
+		free(buf->ptr);
+		buf->ptr = ntru_malloc(new_size);
+		buf->size = new_size;
+	}
+
+	return buf->ptr;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_scratch_release(size_t used)
+{
+	scratch_buf *buf;
+	volatile uint8_t *wipe;
+
+	pthread_once(&scratch_once, scratch_init);
+
+	if (!(buf = pthread_getspecific(scratch_key)) || !buf->ptr)
+		return;
+
+	if (used > buf->size)
+		used = buf->size;
+
+	/* a plain memset right before free() may be optimized out */
+	wipe = buf->ptr;
+	for (size_t i = 0; i < used; i++)
+		wipe[i] = 0;
+
+	if (buf->size > NTRU_SCRATCH_KEEP_MAX) {
+		free(buf->ptr);
+		buf->ptr = NULL;
+		buf->size = 0;
+	}
+}
+
+/*------------------------------------------------------------------------*/
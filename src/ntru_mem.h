@@ -47,6 +47,12 @@
 }
 
 
+/**
+ * Largest scratch buffer that is kept between calls.
+ */
+#define NTRU_SCRATCH_KEEP_MAX (1 << 20)
+
+
 /**
  * Allocate memory of size and return
  * a void pointer.
@@ -68,5 +74,33 @@ ntru_malloc(size_t size);
 void *
 ntru_calloc(size_t nmemb, size_t size);
 
+/**
+ * Get a scratch buffer of at least size bytes, which belongs
+ * to the calling thread. It is only grown up to
+ * NTRU_SCRATCH_KEEP_MAX, so in steady state this does not
+ * allocate. The buffer is reused by the next call from the
+ * same thread and freed when the thread exits. Every user
+ * has to hand it back with ntru_scratch_release().
+ *
+ * @param size of the needed memory in bytes
+ * @return pointer to the scratch buffer, suitably aligned
+ * for any type, do not free it
+ */
+void *
+ntru_scratch(size_t size);
+
+/**
+ * Hands back the scratch buffer of the calling thread. The
+ * used bytes are wiped, since they may hold plaintext, and a
+ * buffer larger than NTRU_SCRATCH_KEEP_MAX is freed, so one
+ * huge message does not pin its memory for the lifetime of
+ * the thread.
+ *
+ * @param used the number of bytes at the start of the buffer
+ * that were used, at most the size passed to ntru_scratch()
+ */
+void
+ntru_scratch_release(size_t used);
+
 
 #endif /* NTRU_MEM_H */
@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_packed.c
+ * This file converts between polynomials and the packed
+ * binary ciphertext format, which stores every coefficient
+ * in ceil(log2(q)) bits behind a small header.
+ * @brief packed ciphertexts
+ */
+
+#include "ntru_common.h"
+#include "ntru_err.h"
+#include "ntru_mem.h"
+#include "ntru_packed.h"
+#include "ntru_params.h"
+#include "ntru_poly.h"
+#include "ntru_string.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Magic bytes at the start of every packed ciphertext,
+ * the 0 byte is no base64 character.
+ */
+static const char packed_magic[4] = { '\0', 'N', 'T', 'C' };
+
+
+typedef struct bit_stream bit_stream;
+
+
+/**
+ * A little endian bit stream over a byte buffer.
+ */
+struct bit_stream {
+	/**
+	 * The next byte to write or read.
+	 */
+	uint8_t *ptr;
+	/**
+	 * Bits that are not written yet or not consumed yet.
+	 */
+	uint64_t acc;
+	/**
+	 * Number of valid bits in acc.
+	 */
+	uint32_t acc_bits;
+};
+
+
+/**
+ * Number of bits to store any value in [0, n-1].
+ *
+ * @param n the number of values
+ * @return ceil(log2(n))
+ */
+static uint32_t
+bits_for(uint32_t n);
+
+/**
+ * Number of bits of one coefficient in a packed ciphertext,
+ * see ntru_packed_header.
+ *
+ * @param params the NTRU context
+ * @param dropped_bits the number of dropped quotient bits
+ * @return the number of bits
+ */
+static uint32_t
+packed_stored_bits(const ntru_params *params, uint32_t dropped_bits);
+
+/**
+ * Size of the payload of a packed ciphertext.
+ *
+ * @param params the NTRU context
+ * @param blocks the number of blocks
+ * @param dropped_bits the number of dropped quotient bits
+ * @return the size in bytes
+ */
+static size_t
+packed_payload_len(const ntru_params *params,
+		uint32_t blocks,
+		uint32_t dropped_bits);
+
+/**
+ * Append the low bits of val to a bit stream.
+ *
+ * @param bs the bit stream
+ * @param val the value
+ * @param bits the number of bits to append, at most 32
+ */
+static void
+put_bits(bit_stream *bs, uint32_t val, uint32_t bits);
+
+/**
+ * Take the next bits of a bit stream.
+ *
+ * @param bs the bit stream
+ * @param bits the number of bits to take, at most 32
+ * @return the value
+ */
+static uint32_t
+get_bits(bit_stream *bs, uint32_t bits);
+
+
+/*------------------------------------------------------------------------*/
+
+static uint32_t
+bits_for(uint32_t n)
+{
+	uint32_t bits = 0;
+
+	while (bits < 32 && (1ULL << bits) < n)
+		bits++;
+
+	return bits;
+}
+
+/*------------------------------------------------------------------------*/
+
+static uint32_t
+packed_stored_bits(const ntru_params *params, uint32_t dropped_bits)
+{
+	if (!dropped_bits)
+		return packed_coeff_bits(params);
+
+	return bits_for(params->p) + packed_quotient_bits(params) -
+		dropped_bits;
+}
+
+/*------------------------------------------------------------------------*/
+
+static size_t
+packed_payload_len(const ntru_params *params,
+		uint32_t blocks,
+		uint32_t dropped_bits)
+{
+	return ((size_t)blocks * params->N *
+			packed_stored_bits(params, dropped_bits) + ASCII_BITS - 1) /
+		ASCII_BITS;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+put_bits(bit_stream *bs, uint32_t val, uint32_t bits)
+{
+	bs->acc |= (uint64_t)val << bs->acc_bits;
+	bs->acc_bits += bits;
+
+	while (bs->acc_bits >= ASCII_BITS) {
+		*bs->ptr++ = (uint8_t)bs->acc;
+		bs->acc >>= ASCII_BITS;
+		bs->acc_bits -= ASCII_BITS;
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+static uint32_t
+get_bits(bit_stream *bs, uint32_t bits)
+{
+	uint32_t val;
+
+	while (bs->acc_bits < bits) {
+		bs->acc |= (uint64_t)*bs->ptr++ << bs->acc_bits;
+		bs->acc_bits += ASCII_BITS;
+	}
+
+	val = (uint32_t)(bs->acc & ((1ULL << bits) - 1));
+	bs->acc >>= bits;
+	bs->acc_bits -= bits;
+
+	return val;
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+packed_coeff_bits(const ntru_params *params)
+{
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return bits_for(params->q);
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+packed_quotient_bits(const ntru_params *params)
+{
+	if (!params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return bits_for((params->q + params->p - 1) / params->p);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+is_packed(const string *str)
+{
+	return str && str->len >= sizeof(packed_magic) &&
+		!memcmp(str->ptr, packed_magic, sizeof(packed_magic));
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+poly_arr_to_packed(const fmpz_poly_t **poly_array,
+		const uint32_t poly_c,
+		const ntru_params *params,
+		ntru_msg_encoding encoding,
+		uint64_t msg_len,
+		uint32_t dropped_bits)
+{
+	int32_t *coeffs;
+	uint8_t *buf;
+	bit_stream bs = { NULL, 0, 0 };
+	string *packed;
+
+	if (!poly_array || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (dropped_bits >= packed_quotient_bits(params))
+		return NULL;
+
+	packed = ntru_malloc(sizeof(*packed));
+	packed->len = NTRU_PACKED_HEADER_LEN +
+		packed_payload_len(params, poly_c, dropped_bits);
+	packed->ptr = ntru_calloc(1, packed->len);
+	buf = (uint8_t *)packed->ptr;
+
+	memcpy(buf, packed_magic, sizeof(packed_magic));
+	buf[4] = NTRU_PACKED_VERSION;
+	buf[5] = (uint8_t)encoding;
+	buf[6] = (uint8_t)dropped_bits;
+	put_le32(buf + 8, params->N);
+	put_le32(buf + 12, params->q);
+	put_le32(buf + 16, params->p);
+	put_le32(buf + 20, poly_c);
+	put_le64(buf + 24, msg_len);
+
+	coeffs = ntru_malloc(sizeof(*coeffs) * params->N);
+	bs.ptr = buf + NTRU_PACKED_HEADER_LEN;
+
+	/* little endian bit stream, coefficient after coefficient */
+	for (uint32_t i = 0; i < poly_c; i++) {
+		poly_get_residues(coeffs, *poly_array[i], params, params->q);
+
+		for (uint32_t k = 0; k < params->N; k++) {
+			const uint32_t c = (uint32_t)coeffs[k];
+
+			if (!dropped_bits) {
+				put_bits(&bs, c, packed_coeff_bits(params));
+				continue;
+			}
+
+			/* the residue mod p carries the message, only the
+			 * quotient is rounded to its top bits */
+			put_bits(&bs, c % params->p, bits_for(params->p));
+			put_bits(&bs, c / params->p >> dropped_bits,
+					packed_quotient_bits(params) - dropped_bits);
+		}
+	}
+
+	if (bs.acc_bits)
+		*bs.ptr = (uint8_t)bs.acc;
+
+	free(coeffs);
+
+	return packed;
+}
+
+/*------------------------------------------------------------------------*/
+
+fmpz_poly_t **
+packed_to_poly_arr(const string *packed,
+		const ntru_params *params,
+		ntru_packed_header *header)
+{
+	const uint8_t *buf;
+	int32_t *coeffs;
+	uint32_t dropped;
+	bit_stream bs = { NULL, 0, 0 };
+	fmpz_poly_t **poly_array;
+
+	if (!packed || !params || !header)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!is_packed(packed) || packed->len < NTRU_PACKED_HEADER_LEN)
+		return NULL;
+
+	buf = (const uint8_t *)packed->ptr;
+	header->version = buf[4];
+	header->encoding = (ntru_msg_encoding)buf[5];
+	header->dropped_bits = buf[6];
+	header->params.N = get_le32(buf + 8);
+	header->params.q = get_le32(buf + 12);
+	header->params.p = get_le32(buf + 16);
+	header->blocks = get_le32(buf + 20);
+	header->msg_len = get_le64(buf + 24);
+	dropped = header->dropped_bits;
+
+	if (header->version != NTRU_PACKED_VERSION ||
+			buf[7] ||
+			(header->encoding != NTRU_MSG_BINARY &&
+			 header->encoding != NTRU_MSG_TERNARY) ||
+			header->params.N != params->N ||
+			header->params.q != params->q ||
+			header->params.p != params->p ||
+			dropped >= packed_quotient_bits(params) ||
+			packed->len != NTRU_PACKED_HEADER_LEN +
+				packed_payload_len(params, header->blocks, dropped))
+		return NULL;
+
+	coeffs = ntru_malloc(sizeof(*coeffs) * params->N);
+	poly_array = ntru_malloc(sizeof(*poly_array) * (header->blocks + 1));
+	bs.ptr = (uint8_t *)buf + NTRU_PACKED_HEADER_LEN;
+
+	for (uint32_t i = 0; i < header->blocks; i++) {
+		for (uint32_t k = 0; k < params->N; k++) {
+			uint32_t c = params->q;
+
+			if (!dropped) {
+				c = get_bits(&bs, packed_coeff_bits(params));
+			} else {
+				const uint32_t r = get_bits(&bs, bits_for(params->p));
+				const uint32_t t = get_bits(&bs,
+						packed_quotient_bits(params) - dropped) << dropped;
+
+				/* the midpoint of the bucket, which may be cut by q */
+				if (r < params->p && r + t * params->p < params->q) {
+					uint32_t width = (params->q - 1 - r) / params->p + 1 - t;
+
+					if (width > (1U << dropped))
+						width = 1U << dropped;
+					c = r + (t + width / 2) * params->p;
+				}
+			}
+
+			if (c >= params->q) {
+				for (uint32_t j = 0; j < i; j++) {
+					poly_delete(*poly_array[j]);
+					free(poly_array[j]);
+				}
+				free(poly_array);
+				free(coeffs);
+				return NULL;
+			}
+			coeffs[k] = (int32_t)c;
+		}
+
+		poly_array[i] = ntru_malloc(sizeof(**poly_array));
+		fmpz_poly_init(*poly_array[i]);
+		poly_set_int_arr(*poly_array[i], coeffs, params);
+	}
+
+	poly_array[header->blocks] = NULL;
+
+	free(coeffs);
+
+	return poly_array;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_packed.h
+ * Header for the internal API of ntru_packed.c.
+ * @brief header for ntru_packed.c
+ */
+
+#ifndef NTRU_PACKED_H
+#define NTRU_PACKED_H
+
+
+#include "ntru_params.h"
+#include "ntru_string.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Current version of the packed ciphertext format.
+ */
+#define NTRU_PACKED_VERSION 1
+
+/**
+ * Size of the header of a packed ciphertext.
+ */
+#define NTRU_PACKED_HEADER_LEN 32
+
+
+typedef struct ntru_packed_header ntru_packed_header;
+
+
+/**
+ * The header of a packed ciphertext, which is followed by
+ * the coefficients of all blocks, each reduced mod q and
+ * stored in exactly packed_coeff_bits() bits. If low bits
+ * were dropped, a coefficient c is stored as c mod p in
+ * ceil(log2(p)) bits instead, followed by the top
+ * packed_quotient_bits() - dropped_bits bits of c / p.
+ */
+struct ntru_packed_header {
+	/**
+	 * The version of the format.
+	 */
+	uint8_t version;
+	/**
+	 * How the message was mapped to the blocks.
+	 */
+	ntru_msg_encoding encoding;
+	/**
+	 * Number of low bits of the quotient c / p of every
+	 * coefficient c that were dropped, 0 for a lossless
+	 * ciphertext.
+	 */
+	uint8_t dropped_bits;
+	/**
+	 * The parameter set the message was encrypted with.
+	 */
+	ntru_params params;
+	/**
+	 * Number of blocks.
+	 */
+	uint32_t blocks;
+	/**
+	 * Length of the original message.
+	 */
+	uint64_t msg_len;
+};
+
+
+/**
+ * Number of bits of one coefficient in the
+ * packed format, ceil(log2(q)).
+ *
+ * @param params the NTRU context
+ * @return the number of bits
+ */
+uint32_t
+packed_coeff_bits(const ntru_params *params);
+
+/**
+ * Number of bits of the quotient c / p of a coefficient
+ * c in [0, q-1], ceil(log2(ceil(q / p))).
+ *
+ * @param params the NTRU context
+ * @return the number of bits
+ */
+uint32_t
+packed_quotient_bits(const ntru_params *params);
+
+/**
+ * Checks whether a string starts like a packed ciphertext.
+ * The magic bytes are no valid base64, so this tells the
+ * packed format apart from the base64 one.
+ *
+ * @param str the string to check
+ * @return true if str looks like a packed ciphertext
+ */
+bool
+is_packed(const string *str);
+
+/**
+ * Packs an array of polynomials with coefficients in the
+ * range [0, q-1] into a packed ciphertext. With dropped_bits
+ * only c mod p and the top bits of c / p are kept of every
+ * coefficient c. This is lossy, but the error is a multiple
+ * of p, which decryption removes as long as f times it stays
+ * small, see ntru_rounding_failure_rate().
+ *
+ * @param poly_array the array of polynomials
+ * @param poly_c the amount of polynomials in poly_array
+ * @param params the NTRU parameters
+ * @param encoding how the message was mapped to the polynomials
+ * @param msg_len the length of the original message
+ * @param dropped_bits the number of low bits to drop from
+ * the quotient c / p of every coefficient c, 0 to keep all
+ * @return the packed ciphertext, newly allocated, NULL if
+ * not even one bit of the quotient would be left
+ */
+string *
+poly_arr_to_packed(const fmpz_poly_t **poly_array,
+		const uint32_t poly_c,
+		const ntru_params *params,
+		ntru_msg_encoding encoding,
+		uint64_t msg_len,
+		uint32_t dropped_bits);
+
+/**
+ * Unpacks a packed ciphertext into an array of polynomials with
+ * coefficients in the range [0, q-1]. This is the counterpart
+ * of poly_arr_to_packed(). Dropped bits are restored to the
+ * midpoint of the range the quotient was rounded from.
+ *
+ * @param packed the packed ciphertext
+ * @param params the NTRU parameters, which must match
+ * the ones in the header
+ * @param header where to store the parsed header [out]
+ * @return newly allocated array of polynomials, NULL if
+ * packed is malformed or for other parameters
+ */
+fmpz_poly_t **
+packed_to_poly_arr(const string *packed,
+		const ntru_params *params,
+		ntru_packed_header *header);
+
+
+#endif /* NTRU_PACKED_H */
@@ -34,6 +34,7 @@
 
 
 typedef struct ntru_params ntru_params;
+typedef struct ntru_compress_policy ntru_compress_policy;
 
 
 /**
@@ -57,4 +58,105 @@ struct ntru_params {
 };
 
 
+/**
+ * How the bytes of a message are mapped to
+ * the coefficients of the message polynomials.
+ * Except for NTRU_MSG_BINARY_UNFRAMED, the compressed
+ * message is prefixed with its compressed and its original
+ * length as varints, so the decoder stops at the exact byte
+ * count, the rest of the last polynomial is padding, and the
+ * decompressed message is allocated in its final size.
+ */
+typedef enum ntru_msg_encoding {
+	/**
+	 * One bit per coefficient, 1 => 1 and 0 => -1.
+	 */
+	NTRU_MSG_BINARY = 0,
+	/**
+	 * 19 bits per 12 ternary coefficients {-1, 0, 1},
+	 * about 58% more payload per polynomial. Requires p = 3.
+	 */
+	NTRU_MSG_TERNARY = 1,
+	/**
+	 * Like NTRU_MSG_BINARY, but without length prefix, the
+	 * message ends with the first trailing zero coefficient.
+	 * This is the format of older ciphertexts.
+	 */
+	NTRU_MSG_BINARY_UNFRAMED = 2,
+} ntru_msg_encoding;
+
+/**
+ * How a message is compressed before encryption.
+ */
+typedef enum ntru_compress_mode {
+	/**
+	 * LZ4 with the acceleration factor in the level of the
+	 * ntru_compress_policy, 1 is the default and higher values
+	 * are faster but compress less.
+	 */
+	NTRU_COMPRESS_FAST = 0,
+	/**
+	 * LZ4HC at the level of the ntru_compress_policy, 0 for the
+	 * default level. Much slower, but fewer blocks to encrypt
+	 * for redundant messages.
+	 */
+	NTRU_COMPRESS_HC = 1,
+	/**
+	 * No compression, the message is stored as it is.
+	 */
+	NTRU_COMPRESS_NONE = 2,
+	/**
+	 * Estimate the entropy of a prefix of the message and store
+	 * it if it would not compress, otherwise like
+	 * NTRU_COMPRESS_FAST. The message is stored as well if
+	 * compression does not make it smaller after all.
+	 */
+	NTRU_COMPRESS_AUTO = 3,
+} ntru_compress_mode;
+
+/**
+ * A compression policy, see ntru_compress_mode.
+ * The decoder does not need to know it, apart from
+ * having the same dictionary registered.
+ */
+struct ntru_compress_policy {
+	/**
+	 * How to compress.
+	 */
+	ntru_compress_mode mode;
+	/**
+	 * The acceleration factor for NTRU_COMPRESS_FAST and
+	 * NTRU_COMPRESS_AUTO, the level for NTRU_COMPRESS_HC.
+	 */
+	int level;
+	/**
+	 * The id of a dictionary registered with
+	 * ntru_compress_dict_add(), 0 for none. NTRU_COMPRESS_HC
+	 * uses LZ4 with acceleration 1 when there is a dictionary.
+	 */
+	uint32_t dict_id;
+};
+
+/**
+ * Number of 1 coefficients of the private key
+ * polynomial f, which has one -1 coefficient less
+ * than that, so that f(1) = 1.
+ */
+#define NTRU_DF(params) ((params)->N / 3)
+
+/**
+ * Number of 1 coefficients and -1 coefficients
+ * (each) of the polynomial g, which is used to
+ * create the public key.
+ */
+#define NTRU_DG(params) ((params)->N / 3)
+
+/**
+ * Number of 1 coefficients and -1 coefficients
+ * (each) of the blinding polynomials r that are
+ * sampled per block by ntru_encrypt_string_parallel().
+ */
+#define NTRU_DR(params) ((params)->N / 3)
+
+
 #endif /* NTRU_PARAMS_H */
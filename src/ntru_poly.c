@@ -27,6 +27,7 @@
  * @brief operations on polynomials
  */
 
+#include "ntru_common.h"
 #include "ntru_err.h"
 #include "ntru_mem.h"
 #include "ntru_params.h"
@@ -56,6 +57,43 @@ void poly_mod2_to_modq(fmpz_poly_t Fq,
 		const fmpz_poly_t a,
 		const ntru_params *params);
 
+/**
+ * Computes the k-th coefficient of the cyclic convolution
+ * a * b mod (x^N - 1) over int arrays, without any reduction.
+ *
+ * @param a the first factor, N coefficients
+ * @param b the second factor, N coefficients
+ * @param N the number of coefficients
+ * @param k which coefficient to compute
+ * @return the unreduced coefficient
+ */
+static int64_t
+int_star_coeff(const int32_t *a,
+		const int32_t *b,
+		uint32_t N,
+		uint32_t k);
+
+/**
+ * Reduces x to 0 <= r < modulus.
+ *
+ * @param x the value to reduce
+ * @param modulus the modulus
+ * @return the residue
+ */
+static int32_t
+int_mod(int64_t x, uint32_t modulus);
+
+/**
+ * Lifts a residue 0 <= r < modulus to -modulus/2 < r <= modulus/2,
+ * the same as fmpz_poly_set_nmod_poly() does.
+ *
+ * @param r the residue
+ * @param modulus the modulus
+ * @return the center-lifted value
+ */
+static int32_t
+int_center(int32_t r, uint32_t modulus);
+
 
 /*------------------------------------------------------------------------*/
 
@@ -296,6 +334,149 @@ poly_starmultiply(fmpz_poly_t c,
 
 /*------------------------------------------------------------------------*/
 
+static int64_t
+int_star_coeff(const int32_t *a,
+		const int32_t *b,
+		uint32_t N,
+		uint32_t k)
+{
+	int64_t acc = 0;
+
+	/* two straight loops instead of a wrapping index */
+	for (uint32_t i = 0; i <= k; i++)
+		acc += (int64_t)a[i] * b[k - i];
+	for (uint32_t i = k + 1; i < N; i++)
+		acc += (int64_t)a[i] * b[N + k - i];
+
+	return acc;
+}
+
+/*------------------------------------------------------------------------*/
+
+static int32_t
+int_mod(int64_t x, uint32_t modulus)
+{
+	int64_t r = x % modulus;
+
+	return (int32_t)(r + ((int64_t)modulus & -(int64_t)(r < 0)));
+}
+
+/*------------------------------------------------------------------------*/
+
+static int32_t
+int_center(int32_t r, uint32_t modulus)
+{
+	return r - ((int32_t)modulus & -(int32_t)(r > (int32_t)(modulus / 2)));
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+poly_get_residues(int32_t *out,
+		const fmpz_poly_t poly,
+		const ntru_params *params,
+		uint32_t modulus)
+{
+	if (!out || !poly || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	for (uint32_t i = 0; i < params->N; i++) {
+		fmpz *coeff = fmpz_poly_get_coeff_ptr(poly, i);
+
+		out[i] = coeff ? (int32_t)fmpz_fdiv_ui(coeff, modulus) : 0;
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+poly_get_residues_le16(int32_t *out,
+		const int16_t *in,
+		const ntru_params *params,
+		uint32_t modulus)
+{
+	if (!out || !in || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	for (uint32_t i = 0; i < params->N; i++) {
+		int32_t c = (int16_t)get_le16((const uint8_t *)(in + i)) %
+			(int32_t)modulus;
+
+		out[i] = c < 0 ? c + (int32_t)modulus : c;
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+poly_set_int_arr(fmpz_poly_t poly,
+		const int32_t *in,
+		const ntru_params *params)
+{
+	if (!poly || !in || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	fmpz_poly_zero(poly);
+	fmpz_poly_fit_length(poly, params->N);
+
+	for (uint32_t i = 0; i < params->N; i++)
+		fmpz_poly_set_coeff_si(poly, i, in[i]);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+poly_encrypt_kernel(int32_t *out,
+		const int32_t *h,
+		const int32_t *r,
+		const int32_t *m,
+		const ntru_params *params)
+{
+	if (!out || !h || !r || !m || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	for (uint32_t k = 0; k < params->N; k++)
+		out[k] = int_mod(int_star_coeff(h, r, params->N, k) + m[k],
+				params->q);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+poly_decrypt_kernel(int32_t *out,
+		int32_t *tmp,
+		const int32_t *f,
+		const int32_t *e,
+		const int32_t *fp,
+		const ntru_params *params)
+{
+	int32_t *a,
+			*fp_p;
+
+	if (!out || !tmp || !f || !e || !fp || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	a = tmp;
+	fp_p = tmp + params->N;
+
+	/*
+	 * fp only matters mod p, but like in the fmpz implementation
+	 * its representative is the center lift mod q
+	 */
+	for (uint32_t i = 0; i < params->N; i++)
+		fp_p[i] = int_mod(int_center(fp[i], params->q), params->p);
+
+	for (uint32_t k = 0; k < params->N; k++)
+		a[k] = int_center(int_mod(int_star_coeff(f, e, params->N, k),
+					params->q), params->q);
+
+	for (uint32_t k = 0; k < params->N; k++)
+		out[k] = int_center(int_mod(int_star_coeff(a, fp_p, params->N, k),
+					params->p), params->p);
+}
+
+/*------------------------------------------------------------------------*/
+
 bool
 poly_inverse_poly_q(fmpz_poly_t Fq,
 		const fmpz_poly_t a,
@@ -472,6 +653,10 @@ poly_inverse_poly_p(fmpz_poly_t Fp,
 		if (fmpz_poly_is_zero(g) == 1)
 			goto cleanup;
 
+		/* f and x^N - 1 share a factor, not invertible */
+		if (fmpz_poly_is_zero(f) == 1)
+			goto cleanup;
+
 		if (fmpz_poly_degree(f) == 0)
 			break;
 
@@ -180,6 +180,96 @@ poly_starmultiply(fmpz_poly_t c,
 		const ntru_params *params,
 		uint32_t modulus);
 
+/**
+ * Loads the first params->N coefficients of a polynomial into
+ * an int array, as residues 0 <= r < modulus, for the kernels
+ * below.
+ *
+ * @param out where to store the params->N residues [out]
+ * @param poly the polynomial
+ * @param params NTRU parameters
+ * @param modulus the modulus
+ */
+void
+poly_get_residues(int32_t *out,
+		const fmpz_poly_t poly,
+		const ntru_params *params,
+		uint32_t modulus);
+
+/**
+ * Loads params->N little endian int16_t coefficients, as they
+ * are laid out in memory-mapped key files and key stores, into
+ * an int array like poly_get_residues().
+ *
+ * @param out where to store the params->N residues [out]
+ * @param in the params->N little endian coefficients
+ * @param params NTRU parameters
+ * @param modulus the modulus
+ */
+void
+poly_get_residues_le16(int32_t *out,
+		const int16_t *in,
+		const ntru_params *params,
+		uint32_t modulus);
+
+/**
+ * Sets a polynomial to the params->N coefficients of an
+ * int array, the inverse of poly_get_residues().
+ *
+ * @param poly polynomial, must be initialized [out]
+ * @param in the params->N coefficients
+ * @param params NTRU parameters
+ */
+void
+poly_set_int_arr(fmpz_poly_t poly,
+		const int32_t *in,
+		const ntru_params *params);
+
+/**
+ * Fused encryption kernel, computing
+ * out = (h * r + m) mod q
+ * in one pass over int arrays, with 0 <= out < q.
+ * This gives the same as poly_starmultiply(), fmpz_poly_add()
+ * and fmpz_poly_mod_unsigned() in a row.
+ *
+ * @param out the params->N result coefficients,
+ * may not alias an input [out]
+ * @param h the public key, residues mod q
+ * @param r the random poly, residues mod q
+ * @param m the message, residues mod q
+ * @param params NTRU parameters
+ */
+void
+poly_encrypt_kernel(int32_t *out,
+		const int32_t *h,
+		const int32_t *r,
+		const int32_t *m,
+		const ntru_params *params);
+
+/**
+ * Fused decryption kernel, computing
+ * a = f * e mod q, center-lifted to -q/2 < a <= q/2, and
+ * out = a * fp mod p, center-lifted to -p/2 < out <= p/2,
+ * where each coefficient is lifted and reduced as soon as its
+ * sum is complete. This gives the same as the poly_starmultiply()
+ * and fmpz_poly_mod() chain of the fmpz implementation.
+ *
+ * @param out the params->N result coefficients,
+ * may not alias an input [out]
+ * @param tmp scratch space for 2 * params->N coefficients
+ * @param f the private key, residues mod q
+ * @param e the encrypted message, residues mod q
+ * @param fp the inverse of f mod p, residues mod q
+ * @param params NTRU parameters
+ */
+void
+poly_decrypt_kernel(int32_t *out,
+		int32_t *tmp,
+		const int32_t *f,
+		const int32_t *e,
+		const int32_t *fp,
+		const ntru_params *params);
+
 /**
  * Compute the inverse of a polynomial in modulo a power of 2,
  * which is q. This is based off the pseudo-code for "Inversion
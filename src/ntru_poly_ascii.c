@@ -27,14 +27,14 @@
  */
 
 #include "ntru_poly_ascii.h"
+#include "ntru_base64.h"
 #include "ntru_common.h"
+#include "ntru_err.h"
 #include "ntru_mem.h"
 #include "ntru_params.h"
 #include "ntru_poly.h"
 #include "ntru_string.h"
 
-#include <glib.h>
-
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,132 +44,173 @@
 
 
 /**
- * Converts a binary representation of multiple concatenated
- * integers to the corresponding array of ascii chars, which
- * is NULL-terminated.
- *
- * It reads in 8bit chunks, as in:
- *
- * 10110101|00111100|01011001 => 90|60|89 => "Z<Y"
- *
- * Chunks that are 00000000 are stripped from the result.
+ * Packs 8 binary coefficients into one byte, the first
+ * coefficient becoming the most significant bit, with the
+ * mapping 1 => 1, -1 => 0.
  *
- * @param binary_rep the binary representation of multiple
- * integers concatenated
- * @return string of corresponding ascii-chars,
- * newly allocated
+ * @param in the 8 coefficients
+ * @return the packed byte
  */
-static string *
-get_bin_arr_to_ascii(const char *binary_rep);
+static inline uint8_t
+bin_coeffs_to_byte(const int8_t *in);
 
 
 /*------------------------------------------------------------------------*/
 
-static string *
-get_bin_arr_to_ascii(const char *binary_rep)
+static inline uint8_t
+bin_coeffs_to_byte(const int8_t *in)
 {
-	size_t int_arr_size = 0;
-	uint8_t *int_arr = NULL;
-	uint32_t i = 0;
-	char *int_string = NULL;
-	string *result = ntru_malloc(sizeof(*result));
+	uint64_t x = get_le64((const uint8_t *)in);
 
-	if (!binary_rep || !*binary_rep)
-		return NULL;
+	/* 0x01 => 1, everything else has bit 0 cleared or bit 7 set */
+	x = x & ~(x >> 7) & 0x0101010101010101ULL;
 
-	int_arr_size = strlen(binary_rep) / ASCII_BITS + 1;
-	int_arr = ntru_malloc(sizeof(*int_arr) * int_arr_size);
+	/* gather the low bit of byte i into bit 63 - i */
+	return (uint8_t)((x * 0x8040201008040201ULL) >> 56);
+}
 
-	while (*binary_rep) {
-		int_arr[i] = 0;
+/*------------------------------------------------------------------------*/
 
-		/* convert one binary integer to real integer */
-		for (uint32_t j = 0; j < ASCII_BITS && *binary_rep; j++) {
-			if (*binary_rep == '1')
-				int_arr[i] = int_arr[i] * 2 + 1;
-			else if (*binary_rep == '0')
-				int_arr[i] *= 2;
-			binary_rep++;
-		}
+void
+bin_coeffs_to_bytes(uint8_t *out,
+		const int8_t *in,
+		size_t bit_off,
+		size_t nbits)
+{
+	size_t i = 0;
 
-		i++; /* amount of real integers */
-	}
+	if (!out || !in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
 
-	int_string = ntru_malloc(CHAR_SIZE * (i + 1));
+	/* leading bits up to the next byte boundary */
+	for (; i < nbits && (bit_off + i) % ASCII_BITS; i++) {
+		size_t bit = bit_off + i;
 
-	for (uint32_t j = 0; j < i; j++)
-		int_string[j] = (char) int_arr[j];
+		if (in[i] == 1)
+			out[bit / ASCII_BITS] |= 1 << (7 - bit % ASCII_BITS);
+	}
 
-	result->ptr = int_string;
-	result->len = i;
+	for (; nbits - i >= ASCII_BITS; i += ASCII_BITS)
+		out[(bit_off + i) / ASCII_BITS] = bin_coeffs_to_byte(in + i);
 
-	free(int_arr);
+	for (; i < nbits; i++) {
+		size_t bit = bit_off + i;
 
-	return result;
+		if (in[i] == 1)
+			out[bit / ASCII_BITS] |= 1 << (7 - bit % ASCII_BITS);
+	}
 }
 
 /*------------------------------------------------------------------------*/
 
 string *
-bin_poly_to_ascii(const fmpz_poly_t poly,
+bin_poly_arr_to_ascii(const fmpz_poly_t **bin_poly_arr,
+		const uint32_t poly_c,
 		const ntru_params *params)
 {
-	string *result_string = ntru_malloc(sizeof(*result_string));
-	char *binary_rep = ntru_malloc(CHAR_SIZE * (params->N));
-	uint32_t i = 0;
-
-	for (i = 0; i < params->N; i++) {
-		fmpz *coeff = fmpz_poly_get_coeff_ptr(poly, i);
-
-		if (coeff) {
-			if (!fmpz_cmp_si(coeff, 1))
-				binary_rep[i] = '1';
-			else if (!fmpz_cmp_si(coeff, -1))
-				binary_rep[i] = '0';
-		} else {
-			break;
-		}
+	int8_t *coeffs = ntru_malloc(params->N);
+	uint8_t *bytes;
+	size_t bits = 0;
+	string *ascii_string = NULL;
+
+	bytes = ntru_calloc(1, (size_t)params->N * poly_c / ASCII_BITS + 2);
+
+	for (uint32_t i = 0; i < poly_c; i++) {
+		slong len = fmpz_poly_length(*bin_poly_arr[i]);
+
+		if (len > (slong)params->N)
+			len = params->N;
+
+		for (slong k = 0; k < len; k++)
+			coeffs[k] = fmpz_cmp_si(fmpz_poly_get_coeff_ptr(
+						*bin_poly_arr[i], k), 1) ? -1 : 1;
+
+		bin_coeffs_to_bytes(bytes, coeffs, bits, len);
+		bits += len;
 	}
 
-	result_string->ptr = binary_rep;
-	result_string->len = i;
+	free(coeffs);
 
-	return result_string;
+	if (!bits) {
+		free(bytes);
+		return NULL;
+	}
+
+	/* a partial last byte holds the bits in its low end */
+	if (bits % ASCII_BITS)
+		bytes[bits / ASCII_BITS] >>= ASCII_BITS - bits % ASCII_BITS;
+
+	ascii_string = ntru_malloc(sizeof(*ascii_string));
+	ascii_string->ptr = (char *)bytes;
+	ascii_string->len = (bits + ASCII_BITS - 1) / ASCII_BITS;
+
+	return ascii_string;
 }
 
 /*------------------------------------------------------------------------*/
 
-string *
-bin_poly_arr_to_ascii(const fmpz_poly_t **bin_poly_arr,
-		const uint32_t poly_c,
-		const ntru_params *params)
+bool
+tern_coeffs_to_bytes(uint8_t *out,
+		const int8_t *in,
+		size_t ncoeffs)
 {
-	char *binary_rep = NULL;
-	size_t string_len = 0;
-	string *ascii_string = NULL;
+	if (!out || !in)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	for (size_t g = 0; g < ncoeffs / TERN_GROUP_TRITS; g++) {
+		const size_t bit = g * TERN_GROUP_BITS;
+		const int8_t *cur = in + g * TERN_GROUP_TRITS;
+		uint32_t v = 0,
+				 window;
+
+		for (uint32_t j = 0; j < TERN_GROUP_TRITS; j++) {
+			if (cur[j] < -1 || cur[j] > 1)
+				return false;
+			v = v * 3 + (uint32_t)(cur[j] + 1);
+		}
 
-	/*
-	 * parse the polynomial coefficients into a string
-	 */
-	binary_rep = ntru_malloc(CHAR_SIZE * (params->N * poly_c + 1));
-	for (uint32_t i = 0; i < poly_c; i++) {
-		string *single_poly_string = NULL;
+		/* 3^12 > 2^19, the rest are not valid groups */
+		if (v >> TERN_GROUP_BITS)
+			return false;
 
-		single_poly_string = bin_poly_to_ascii(*bin_poly_arr[i], params);
+		window = v << (32 - TERN_GROUP_BITS - bit % ASCII_BITS);
+		for (size_t b = bit / ASCII_BITS, k = 0;
+				b <= (bit + TERN_GROUP_BITS - 1) / ASCII_BITS; b++, k++)
+			out[b] |= (uint8_t)(window >> (24 - 8 * k));
+	}
 
-		memcpy(binary_rep + string_len,
-				single_poly_string->ptr,
-				single_poly_string->len);
+	return true;
+}
 
-		string_len += single_poly_string->len;
+/*------------------------------------------------------------------------*/
 
-		string_delete(single_poly_string);
+string *
+tern_poly_arr_to_ascii(const fmpz_poly_t **tern_poly_arr,
+		const uint32_t poly_c,
+		const ntru_params *params)
+{
+	const size_t ncoeffs = (size_t)poly_c * params->N /
+		TERN_GROUP_TRITS * TERN_GROUP_TRITS;
+	int8_t *coeffs = ntru_malloc((size_t)poly_c * params->N + 1);
+	string *ascii_string = ntru_malloc(sizeof(*ascii_string));
+
+	ascii_string->len = ncoeffs / TERN_GROUP_TRITS * TERN_GROUP_BITS /
+		ASCII_BITS;
+	ascii_string->ptr = ntru_calloc(ascii_string->len + 4, 1);
+
+	/* trailing zero coefficients are not stored in the polys */
+	for (uint32_t i = 0; i < poly_c; i++)
+		for (uint32_t k = 0; k < params->N; k++)
+			coeffs[(size_t)i * params->N + k] = (int8_t)
+				fmpz_poly_get_coeff_si(*tern_poly_arr[i], k);
+
+	if (!tern_coeffs_to_bytes((uint8_t *)ascii_string->ptr, coeffs,
+				ncoeffs)) {
+		string_delete(ascii_string);
+		ascii_string = NULL;
 	}
-	binary_rep[string_len] = '\0';
-
-	ascii_string = get_bin_arr_to_ascii(binary_rep);
 
-	free(binary_rep);
+	free(coeffs);
 
 	return ascii_string;
 }
@@ -183,13 +224,8 @@ poly_to_ascii(const fmpz_poly_t poly,
 	string *result_string = ntru_malloc(sizeof(*result_string));
 	char *string_rep = ntru_malloc(CHAR_SIZE * (params->N));
 
-	for (uint32_t j = 0; j < params->N; j++) {
-		uint8_t coeff = fmpz_poly_get_coeff_ui(poly, j);
-		if (coeff == params->q)
-			string_rep[j] = '\0';
-		else
-			string_rep[j] = (char)coeff;
-	}
+	for (uint32_t j = 0; j < params->N; j++)
+		string_rep[j] = (char)fmpz_poly_get_coeff_ui(poly, j);
 
 	result_string->ptr = string_rep;
 	result_string->len = params->N;
@@ -239,15 +275,15 @@ poly_to_base64(const fmpz_poly_t poly,
 {
 	string *result_string = ntru_malloc(sizeof(*result_string));
 	string *string_rep = NULL;
-	gchar *base64_string = NULL;
 
 	string_rep = poly_to_ascii(poly, params);
 
-	base64_string = g_base64_encode((const guchar *)string_rep->ptr,
-			string_rep->len);
-
-	result_string->ptr = base64_string;
-	result_string->len = strlen(base64_string);
+	/* null-terminated, so it can be used as a C string as well */
+	result_string->ptr = ntru_malloc(
+			BASE64_ENCODED_LEN(string_rep->len) + 1);
+	result_string->len = base64_encode(result_string->ptr,
+			(const uint8_t *)string_rep->ptr, string_rep->len);
+	result_string->ptr[result_string->len] = '\0';
 
 	string_delete(string_rep);
 
@@ -264,15 +300,14 @@ poly_arr_to_base64(const fmpz_poly_t **poly_array,
 	string *string_rep;
 	string *result_string = ntru_malloc(sizeof(*result_string));
 
-	gchar *base64_string = NULL;
-
 	string_rep = poly_arr_to_ascii(poly_array, poly_c, params);
 
-	base64_string = g_base64_encode((const guchar *)string_rep->ptr,
-			string_rep->len);
-
-	result_string->ptr = base64_string;
-	result_string->len = strlen(base64_string);
+	/* null-terminated, so it can be used as a C string as well */
+	result_string->ptr = ntru_malloc(
+			BASE64_ENCODED_LEN(string_rep->len) + 1);
+	result_string->len = base64_encode(result_string->ptr,
+			(const uint8_t *)string_rep->ptr, string_rep->len);
+	result_string->ptr[result_string->len] = '\0';
 
 	string_delete(string_rep);
 
@@ -35,30 +35,35 @@
 
 #include <fmpz_poly.h>
 #include <fmpz.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 
 /**
- * Convert a single binary polynomial back to a real string.
- * The polynomial coefficients represent a binary format of the
- * ascii string with the following mapping:
+ * Packs binary polynomial coefficients into bits of a byte buffer,
+ * without going through a string of '0's and '1's. The bits are
+ * written most significant bit first, starting at an arbitrary bit
+ * offset, and the following mapping will apply between
+ * coefficient -> binary:
  *
  * 1 => 1
  *
  * -1 => 0
  *
- *  2 => 0
- *
- * The 2's are only used for filling up the rest of the polynomial,
- * so they will just end up as '\0's at the end of the string and will
- * not confuse the result.
+ * Bits are OR'ed into bytes that are only partially covered, so
+ * the buffer should be zeroed beforehand. Whole bytes are packed
+ * 8 coefficients at a time.
  *
- * @param poly the binary polynomial to convert
- * @param params the NTRU parameters
- * @return the real string, newly allocated
+ * @param out the byte buffer [out]
+ * @param in the coefficients, nbits of them
+ * @param bit_off the index of the first bit to write
+ * @param nbits the number of bits to write
  */
-string *
-bin_poly_to_ascii(const fmpz_poly_t poly,
-		const ntru_params *params);
+void
+bin_coeffs_to_bytes(uint8_t *out,
+		const int8_t *in,
+		size_t bit_off,
+		size_t nbits);
 
 /**
  * Convert an array of binary polynomials back to a real string.
@@ -71,9 +76,10 @@ bin_poly_to_ascii(const fmpz_poly_t poly,
  *
  *  2 => 0
  *
- * The 2's are only used for filling up the last polynomial, so they will
- * just end up as '\0's at the end of the string and will not confuse
- * the result.
+ * The 2's and 0's are only used for filling up the last polynomial,
+ * so they will just end up as '\0's at the end of the string. Framed
+ * messages carry their length, so this padding does not confuse the
+ * result.
  *
  * @param bin_poly_arr the array of polynomials
  * @param poly_c the amount of polynomials in bin_poly_arr
@@ -85,15 +91,48 @@ bin_poly_arr_to_ascii(const fmpz_poly_t **bin_poly_arr,
 		const uint32_t poly_c,
 		const ntru_params *params);
 
+/**
+ * Unpacks ternary coefficients back into the bits of a byte
+ * buffer, the inverse of bytes_to_tern_coeffs().
+ *
+ * @param out the byte buffer, zeroed and large enough for
+ * ncoeffs / TERN_GROUP_TRITS * TERN_GROUP_BITS bits [out]
+ * @param in the coefficients
+ * @param ncoeffs the number of coefficients, the ones after
+ * the last whole group are ignored
+ * @return true for success, false if a coefficient is not
+ * in {-1, 0, 1} or a group does not fit in TERN_GROUP_BITS
+ * bits, which means decryption failed
+ */
+bool
+tern_coeffs_to_bytes(uint8_t *out,
+		const int8_t *in,
+		size_t ncoeffs);
+
+/**
+ * Convert an array of ternary polynomials, as created by
+ * ascii_to_tern_poly_arr(), back to a real string. All
+ * polynomials are expected to have N coefficients (trailing
+ * zero coefficients can be missing though). The padding of
+ * the last polynomial ends up as extra bytes at the end.
+ *
+ * @param tern_poly_arr the array of polynomials
+ * @param poly_c the amount of polynomials in tern_poly_arr
+ * @param params the NTRU parameters
+ * @return the real string, newly allocated, NULL if the
+ * polynomials are no valid encoding
+ */
+string *
+tern_poly_arr_to_ascii(const fmpz_poly_t **tern_poly_arr,
+		const uint32_t poly_c,
+		const ntru_params *params);
+
 /**
  * Convert a single polynom back to a real string which is
  * ascii encoded (full 256 C char spectrum).
  * The polynomial coefficients are expected to be in the range
  * [0, q-1] and will be casted back to chars without any mapping.
- *
- * Trailing q coefficients are only used for filling up the rest of
- * a polynomial with '\0', so they will not confuse the result.
- *
+ * *
  * @param poly the polynomial to convert
  * @param params the NTRU parameters
  * @return the real string, newly allocated
@@ -106,10 +145,7 @@ poly_to_ascii(const fmpz_poly_t poly,
  * Convert an array of polynomials back to a real string.
  * The polynomial coefficients are expected to be in the range
  * [0, q-1] and will be casted back to chars without any mapping.
- *
- * Trailing q coefficients are only used for filling up the rest of
- * a polynomial with '\0', so they will not confuse the result.
- *
+ * *
  * @param poly_array the array of polynomials
  * @param poly_c the amount of polynomials in poly_arr
  * @param params the NTRU parameters
@@ -125,10 +161,7 @@ poly_arr_to_ascii(const fmpz_poly_t **poly_array,
  * base64 encoded.
  * The polynomial coefficients are expected to be in the range
  * [0, q-1] and will be casted back to chars without any mapping.
- *
- * Trailing q coefficients are only used for filling up the rest of
- * a polynomial with '\0', so they will not confuse the result.
- *
+ * *
  * @param poly the polynomial to convert
  * @param params the NTRU parameters
  * @return the real string, newly allocated
@@ -142,10 +175,7 @@ poly_to_base64(const fmpz_poly_t poly,
  * is base64 encoded.
  * The polynomial coefficients are expected to be in the range
  * [0, q-1] and will be casted back to chars without any mapping.
- *
- * Trailing q coefficients are only used for filling up the rest of
- * a polynomial with '\0', so they will not confuse the result.
- *
+ * *
  * @param poly_arr the array of polynomials
  * @param poly_c the amount of polynomials in poly_arr
  * @param params the NTRU parameters
@@ -25,38 +25,393 @@
  * @brief random polynomials
  */
 
+#include "ntru_common.h"
+#include "ntru_drbg.h"
 #include "ntru_err.h"
+#include "ntru_mem.h"
 #include "ntru_params.h"
 #include "ntru_poly.h"
+#include "ntru_rnd.h"
 
+#include <errno.h>
 #include <fmpz_poly.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
 #include <unistd.h>
 
 
+typedef struct rnd_state rnd_state;
+
+
+/**
+ * The per-thread DRBG behind get_urnd_int() and ntru_rnd_bytes().
+ */
+struct rnd_state {
+	/**
+	 * The DRBG.
+	 */
+	ntru_drbg drbg;
+	/**
+	 * Number of bytes handed out since the last reseed.
+	 */
+	uint64_t output;
+	/**
+	 * Value of rnd_fork_gen at the last reseed.
+	 */
+	uint64_t fork_gen;
+};
+
+
+/**
+ * An explicit random number generator, see ntru_rng_new().
+ */
+struct ntru_rng {
+	/**
+	 * The DRBG.
+	 */
+	ntru_drbg drbg;
+	/**
+	 * Whether the rng is seeded from the kernel and reseeded
+	 * like the per-thread DRBG, false for a reproducible one.
+	 */
+	bool os_seeded;
+	/**
+	 * Number of bytes handed out since the last reseed.
+	 */
+	uint64_t output;
+	/**
+	 * Value of rnd_fork_gen at the last reseed.
+	 */
+	uint64_t fork_gen;
+	/**
+	 * Serializes the draws of multiple threads.
+	 */
+	pthread_mutex_t lock;
+};
+
+
+/**
+ * Makes sure rnd_key is created exactly once.
+ */
+static pthread_once_t rnd_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Thread-specific key of the rnd_state of each thread.
+ */
+static pthread_key_t rnd_key;
+
+/**
+ * Incremented in the child after every fork(), so that
+ * parent and child never continue the same stream.
+ */
+static uint64_t rnd_fork_gen;
+
+
+/**
+ * Fills a buffer with seed material from the kernel,
+ * via getrandom() or /dev/urandom as fallback.
+ *
+ * @param buf the buffer to fill [out]
+ * @param len the number of bytes
+ */
+static void
+rnd_get_seed(uint8_t *buf, size_t len);
+
+/**
+ * Sets up rnd_key and the fork handler.
+ */
+static void
+rnd_init(void);
+
+/**
+ * Wipes and frees the rnd_state of an exiting thread.
+ *
+ * @param arg the rnd_state
+ */
+static void
+rnd_state_free(void *arg);
+
+/**
+ * Counts forks in the child, see rnd_fork_gen.
+ */
+static void
+rnd_atfork_child(void);
+
+/**
+ * Get the rnd_state of the calling thread, which is created
+ * on first use and reseeded if due.
+ *
+ * @param len the number of bytes about to be drawn
+ * @return the rnd_state
+ */
+static rnd_state *
+rnd_get_state(size_t len);
+
+/**
+ * Allocates a ntru_rng with the given DRBG seed and nonce.
+ *
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param nonce the nonce
+ * @return the new rng
+ */
+static ntru_rng *
+rng_new(const uint8_t *seed, uint64_t nonce);
+
+/**
+ * Branch-free compare and swap, so that afterwards
+ * *a <= *b.
+ *
+ * @param a the first word
+ * @param b the second word
+ */
+static void
+rnd_minmax(uint32_t *a, uint32_t *b);
+
+/**
+ * Sorts an array with a sorting network, so the sequence of
+ * memory accesses and comparisons only depends on len.
+ *
+ * @param x the array to sort
+ * @param len the number of elements
+ */
+static void
+rnd_sort(uint32_t *x, size_t len);
+
+/**
+ * Turns params->N random words into a ternary polynomial with
+ * exactly num_ones 1 and num_neg_ones -1 coefficients. The low
+ * two bits of each word are replaced by a tag (1 for the first
+ * num_ones words, 2 for the next num_neg_ones, 0 otherwise) and
+ * the array is sorted by the random high bits, which shuffles
+ * the tags into random positions with a fixed amount of work.
+ * The words are wiped afterwards.
+ *
+ * @param poly the resulting random polynomial [out]
+ * @param params the NTRU context
+ * @param num_ones the number of 1 coefficients
+ * @param num_neg_ones the number of -1 coefficients
+ * @param x params->N random words
+ */
+static void
+rnd_tern_from_words(fmpz_poly_t poly,
+		const ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones,
+		uint32_t *x);
+
+
 /*------------------------------------------------------------------------*/
 
-int
-get_rnd_int(void)
+static void
+rnd_get_seed(uint8_t *buf, size_t len)
+{
+	size_t got = 0;
+	int fd;
+
+	while (got < len) {
+		ssize_t n = getrandom(buf + got, len - got, 0);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		got += n;
+	}
+
+	if (got == len)
+		return;
+
+	/* kernels before 3.17 have no getrandom() */
+	if ((fd = open("/dev/urandom", O_RDONLY)) == -1)
+		NTRU_ABORT("Unable to open /dev/urandom!\n");
+
+	while (got < len) {
+		ssize_t n = read(fd, buf + got, len - got);
+
+		if (n <= 0)
+			NTRU_ABORT("Unable to read /dev/urandom!\n");
+		got += n;
+	}
+
+	close(fd);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+rnd_init(void)
+{
+	if (pthread_key_create(&rnd_key, rnd_state_free))
+		NTRU_ABORT("Unable to create the thread-specific key!\n");
+
+	pthread_atfork(NULL, NULL, rnd_atfork_child);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+rnd_state_free(void *arg)
+{
+	rnd_state *state = arg;
+
+	ntru_drbg_wipe(&state->drbg);
+	free(state);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+rnd_atfork_child(void)
+{
+	rnd_fork_gen++;
+}
+
+/*------------------------------------------------------------------------*/
+
+static rnd_state *
+rnd_get_state(size_t len)
+{
+	rnd_state *state;
+
+	pthread_once(&rnd_once, rnd_init);
+
+	if (!(state = pthread_getspecific(rnd_key))) {
+		state = ntru_calloc(1, sizeof(*state));
+		state->output = NTRU_RND_RESEED_INTERVAL;
+		pthread_setspecific(rnd_key, state);
+	}
+
+	if (state->output + len > NTRU_RND_RESEED_INTERVAL ||
+			state->fork_gen != rnd_fork_gen) {
+		uint8_t seed[NTRU_SEED_LEN];
+
+		rnd_get_seed(seed, sizeof(seed));
+		ntru_drbg_init(&state->drbg, seed, 0);
+		memset(seed, 0, sizeof(seed));
+
+		state->output = 0;
+		state->fork_gen = rnd_fork_gen;
+	}
+
+	state->output += len;
+
+	return state;
+}
+
+/*------------------------------------------------------------------------*/
+
+static ntru_rng *
+rng_new(const uint8_t *seed, uint64_t nonce)
+{
+	ntru_rng *rng = ntru_calloc(1, sizeof(*rng));
+
+	ntru_drbg_init(&rng->drbg, seed, nonce);
+	pthread_mutex_init(&rng->lock, NULL);
+
+	return rng;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+rnd_minmax(uint32_t *a, uint32_t *b)
+{
+	uint32_t x = *a,
+			 y = *b;
+	uint32_t mask = -(uint32_t)(((uint64_t)y - x) >> 63);
+	uint32_t swap = (x ^ y) & mask;
+
+	*a = x ^ swap;
+	*b = y ^ swap;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+rnd_sort(uint32_t *x, size_t len)
+{
+	size_t top = 1;
+
+	if (len < 2)
+		return;
+
+	while (top < len - top)
+		top += top;
+
+	/* Batcher's merge exchange, branches depend on the indices only */
+	for (size_t p = top; p > 0; p >>= 1) {
+		size_t i;
+
+		for (i = 0; i < len - p; i++)
+			if (!(i & p))
+				rnd_minmax(&x[i], &x[i + p]);
+
+		i = 0;
+		for (size_t q = top; q > p; q >>= 1) {
+			for (; i < len - q; i++) {
+				if (!(i & p)) {
+					uint32_t a = x[i + p];
+
+					for (size_t r = q; r > p; r >>= 1)
+						rnd_minmax(&a, &x[i + r]);
+					x[i + p] = a;
+				}
+			}
+		}
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+rnd_tern_from_words(fmpz_poly_t poly,
+		const ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones,
+		uint32_t *x)
 {
-	int rnd_data = open("/dev/random", O_RDONLY);
-	int rnd_int;
-	size_t rnd_len = 0;
+	volatile uint32_t *wipe = x;
 
-	while (rnd_len < sizeof(rnd_int)) {
-		ssize_t result = read(rnd_data, ((char*)&rnd_int) + rnd_len,
-				sizeof(rnd_int) - rnd_len);
+	if (num_ones > params->N || num_neg_ones > params->N - num_ones)
+		NTRU_ABORT_DEBUG("Too many non-zero coefficients in");
 
-		if (result < 0)
-			NTRU_ABORT("Unable to read /dev/random!\n");
+	for (uint32_t i = 0; i < params->N; i++) {
+		uint32_t tag = (i < num_ones) |
+			((uint32_t)(i - num_ones < num_neg_ones) << 1);
 
-		rnd_len += result;
+		x[i] = (x[i] & ~(uint32_t)3) | tag;
 	}
 
-	close(rnd_data);
+	rnd_sort(x, params->N);
+
+	fmpz_poly_zero(poly);
+	for (uint32_t i = 0; i < params->N; i++) {
+		uint32_t tag = x[i] & 3;
+
+		fmpz_poly_set_coeff_si(poly, i, (long)(tag & 1) - (long)(tag >> 1));
+	}
 
-	return rnd_int;
+	for (uint32_t i = 0; i < params->N; i++)
+		wipe[i] = 0;
+}
+
+
+/*------------------------------------------------------------------------*/
+
+int
+get_rnd_int(void)
+{
+	/* the DRBG is seeded with a blocking getrandom(), reading
+	 * /dev/random per integer only added syscalls and stalls */
+	rnd_state *state = rnd_get_state(sizeof(uint32_t));
+
+	return (int)ntru_drbg_uint32(&state->drbg);
 }
 
 /*------------------------------------------------------------------------*/
@@ -64,19 +419,144 @@ get_rnd_int(void)
 int
 get_urnd_int(void)
 {
-	int rnd_data = open("/dev/urandom", O_RDONLY);
-	int rnd_int;
-	ssize_t result;
+	rnd_state *state = rnd_get_state(sizeof(uint32_t));
+
+	return (int)ntru_drbg_uint32(&state->drbg);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_rnd_bytes(void *buf, size_t len)
+{
+	rnd_state *state;
+
+	if (!buf && len)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	/* reseed between chunks, so huge requests keep the schedule */
+	while (len) {
+		size_t chunk = len < NTRU_RND_RESEED_INTERVAL ?
+			len : NTRU_RND_RESEED_INTERVAL;
+
+		state = rnd_get_state(chunk);
+		ntru_drbg_fill(&state->drbg, buf, chunk);
+
+		buf = (uint8_t *)buf + chunk;
+		len -= chunk;
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_rng *
+ntru_rng_new(void)
+{
+	uint8_t seed[NTRU_SEED_LEN];
+	ntru_rng *rng;
+
+	/* register the fork handler before the first fork() */
+	pthread_once(&rnd_once, rnd_init);
+
+	rnd_get_seed(seed, sizeof(seed));
+	rng = rng_new(seed, 0);
+	memset(seed, 0, sizeof(seed));
+
+	rng->os_seeded = true;
+	rng->fork_gen = rnd_fork_gen;
+
+	return rng;
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_rng *
+ntru_rng_new_seeded(const uint8_t *seed, size_t len)
+{
+	uint8_t key[NTRU_SEED_LEN] = { 0 };
+	ntru_rng *rng;
+
+	if (!seed && len)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (len > NTRU_SEED_LEN)
+		return NULL;
+
+	/* the length goes into the nonce, so "a" and "a\0" differ */
+	memcpy(key, seed, len);
+	rng = rng_new(key, len);
+	memset(key, 0, sizeof(key));
+
+	return rng;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_rng_bytes(ntru_rng *rng, void *buf, size_t len)
+{
+	if (!rng) {
+		ntru_rnd_bytes(buf, len);
+		return;
+	}
+
+	if (!buf && len)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&rng->lock);
+
+	/* as in rnd_get_state(), a child must never continue the
+	 * stream of its parent or its siblings */
+	while (len) {
+		size_t chunk = len < NTRU_RND_RESEED_INTERVAL ?
+			len : NTRU_RND_RESEED_INTERVAL;
+
+		if (rng->os_seeded &&
+				(rng->output + chunk > NTRU_RND_RESEED_INTERVAL ||
+				 rng->fork_gen != rnd_fork_gen)) {
+			uint8_t seed[NTRU_SEED_LEN];
+
+			rnd_get_seed(seed, sizeof(seed));
+			ntru_drbg_init(&rng->drbg, seed, 0);
+			memset(seed, 0, sizeof(seed));
+
+			rng->output = 0;
+			rng->fork_gen = rnd_fork_gen;
+		}
+
+		ntru_drbg_fill(&rng->drbg, buf, chunk);
+		rng->output += chunk;
+
+		buf = (uint8_t *)buf + chunk;
+		len -= chunk;
+	}
+
+	pthread_mutex_unlock(&rng->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+ntru_rng_uint32(ntru_rng *rng)
+{
+	uint8_t buf[4];
 
-	result = read(rnd_data, ((char*)&rnd_int),
-			sizeof(rnd_int));
+	ntru_rng_bytes(rng, buf, sizeof(buf));
 
-	if (result < 0)
-		NTRU_ABORT("Unable to read /dev/urandom!\n");
+	return get_le32(buf);
+}
 
-	close(rnd_data);
+/*------------------------------------------------------------------------*/
+
+void
+ntru_rng_delete(ntru_rng *rng)
+{
+	if (!rng)
+		return;
 
-	return rnd_int;
+	pthread_mutex_destroy(&rng->lock);
+	ntru_drbg_wipe(&rng->drbg);
+	free(rng);
 }
 
 /*------------------------------------------------------------------------*/
@@ -86,26 +566,72 @@ ntru_get_rnd_tern_poly_num(fmpz_poly_t poly,
 		const ntru_params *params,
 		uint32_t num_ones,
 		uint32_t num_neg_ones,
-		int (*rnd_int)(void))
+		ntru_rng *rng)
 {
-	if (!poly || ! params)
-		NTRU_ABORT_DEBUG("unexpected NULL parameters");
+	uint32_t *x;
 
-	fmpz_poly_zero(poly);
+	if (!poly || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
 
-	while (num_ones != 0 || num_neg_ones != 0) {
-		int32_t pos = rnd_int() % params->N;
+	x = ntru_malloc(sizeof(*x) * params->N);
+	ntru_rng_bytes(rng, x, sizeof(*x) * params->N);
 
-		if (!fmpz_cmp_si_n(fmpz_poly_get_coeff_ptr(poly, pos), 0)) {
-			if (num_ones > 0) {
-				fmpz_poly_set_coeff_si(poly, pos, 1);
-				num_ones--;
-			} else if (num_neg_ones > 0) {
-				fmpz_poly_set_coeff_si(poly, pos, -1);
-				num_neg_ones--;
-			}
-		}
-	}
+	rnd_tern_from_words(poly, params, num_ones, num_neg_ones, x);
+
+	free(x);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_get_rnd_tern_poly_drbg(fmpz_poly_t poly,
+		const ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones,
+		ntru_drbg *drbg)
+{
+	uint32_t *x;
+
+	if (!poly || !params || !drbg)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	x = ntru_malloc(sizeof(*x) * params->N);
+
+	for (uint32_t i = 0; i < params->N; i++)
+		x[i] = ntru_drbg_uint32(drbg);
+
+	rnd_tern_from_words(poly, params, num_ones, num_neg_ones, x);
+
+	free(x);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_get_rnd_tern_poly_batch(fmpz_poly_t *polys,
+		size_t count,
+		const ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones,
+		ntru_rng *rng)
+{
+	uint32_t *x;
+
+	if ((!polys && count) || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!count)
+		return;
+
+	/* one DRBG call for the whole batch */
+	x = ntru_malloc(sizeof(*x) * params->N * count);
+	ntru_rng_bytes(rng, x, sizeof(*x) * params->N * count);
+
+	for (size_t i = 0; i < count; i++)
+		rnd_tern_from_words(polys[i], params, num_ones, num_neg_ones,
+				x + i * params->N);
+
+	free(x);
 }
 
 /*------------------------------------------------------------------------*/
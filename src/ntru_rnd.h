@@ -28,15 +28,31 @@
 #ifndef NTRU_RND_H
 #define NTRU_RND_H
 
+#include "ntru_drbg.h"
 #include "ntru_params.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <fmpz_poly.h>
 
 
 /**
- * Get a random integer from /dev/random.
+ * Number of bytes the per-thread DRBG hands out
+ * before it is reseeded from the kernel.
+ */
+#define NTRU_RND_RESEED_INTERVAL (1 << 20)
+
+
+typedef struct ntru_rng ntru_rng;
+
+
+/**
+ * Get a random integer. This is the same as get_urnd_int(),
+ * the per-thread DRBG is seeded via getrandom() without
+ * GRND_NONBLOCK, which waits until the kernel pool is
+ * initialized, so it is as good as reading /dev/random
+ * without a syscall per integer.
  *
  * @return random integer
  */
@@ -44,30 +60,150 @@ int
 get_rnd_int(void);
 
 /**
- * Get a pseudo random integer from /dev/urandom.
+ * Get a pseudo random integer from the ChaCha20 DRBG of the
+ * calling thread. The DRBG is seeded via getrandom() on first
+ * use and reseeded after NTRU_RND_RESEED_INTERVAL bytes and in
+ * the child after fork(), so this does not do a syscall per
+ * integer and is safe to call from any thread.
  *
  * @return pseudo-random integer.
  */
 int
 get_urnd_int(void);
 
+/**
+ * Fills a buffer with pseudo random bytes from the same
+ * per-thread DRBG as get_urnd_int().
+ *
+ * @param buf the buffer to fill [out]
+ * @param len the number of bytes
+ */
+void
+ntru_rnd_bytes(void *buf, size_t len);
+
+/**
+ * Creates a random number generator seeded from the kernel
+ * (getrandom() or /dev/urandom). It can be shared between
+ * threads, draws are serialized. Like the per-thread DRBG it
+ * is reseeded after NTRU_RND_RESEED_INTERVAL bytes and in the
+ * child after fork(), so processes forked from one parent
+ * never draw the same bytes.
+ *
+ * Instead of a ntru_rng, all functions taking one also accept
+ * NULL, which uses the per-thread DRBG of get_urnd_int(). That
+ * is the right choice for production use.
+ *
+ * @return the new rng, free with ntru_rng_delete()
+ */
+ntru_rng *
+ntru_rng_new(void);
+
+/**
+ * Creates a deterministic random number generator. Two rngs
+ * with the same seed produce the same stream, so keys, blinding
+ * polynomials and everything else sampled from them can be
+ * reproduced bit for bit, e.g. for benchmarks or for replaying
+ * a run. Never use this with a guessable seed for real keys.
+ * It is never reseeded, so after fork() parent and children
+ * draw the same stream.
+ *
+ * @param seed the seed
+ * @param len the length of the seed, at most NTRU_SEED_LEN (32)
+ * bytes
+ * @return the new rng, or NULL if the seed is too long,
+ * free with ntru_rng_delete()
+ */
+ntru_rng *
+ntru_rng_new_seeded(const uint8_t *seed, size_t len);
+
+/**
+ * Fills a buffer with random bytes from a rng.
+ *
+ * @param rng the rng, NULL for the per-thread DRBG
+ * @param buf the buffer to fill [out]
+ * @param len the number of bytes
+ */
+void
+ntru_rng_bytes(ntru_rng *rng, void *buf, size_t len);
+
+/**
+ * Get a random 32 bit integer from a rng.
+ *
+ * @param rng the rng, NULL for the per-thread DRBG
+ * @return random integer
+ */
+uint32_t
+ntru_rng_uint32(ntru_rng *rng);
+
+/**
+ * Wipes and frees a rng.
+ *
+ * @param rng the rng, may be NULL
+ */
+void
+ntru_rng_delete(ntru_rng *rng);
+
 /**
  * Get a random ternary polynomial with specified numbers
- * of 1 coefficients and -1 coefficients.
+ * of 1 coefficients and -1 coefficients. This draws exactly
+ * params->N 32 bit words from rng and places the coefficients
+ * with a constant-time sort, so neither the running time nor
+ * the distribution depends on the drawn values.
  *
  * @param poly the resulting random polynomial, must be initialized [out]
  * @param params the NTRU context
  * @param num_ones the number of 1 coefficients
  * @param num_neg_ones the number of -1 coefficients
- * @param rnd_int function callback which should return
- * a random integer
+ * @param rng the rng to draw from, NULL for the per-thread DRBG
  */
 void
 ntru_get_rnd_tern_poly_num(fmpz_poly_t poly,
 		const ntru_params *params,
 		uint32_t num_ones,
 		uint32_t num_neg_ones,
-		int (*rnd_int)(void));
+		ntru_rng *rng);
+
+/**
+ * Get a batch of random ternary polynomials with specified numbers
+ * of 1 coefficients and -1 coefficients, e.g. the blinding
+ * polynomials of several encryptions. All random words are
+ * drawn from rng at once, and every polynomial is sampled in
+ * constant time like in ntru_get_rnd_tern_poly_num().
+ *
+ * @param polys the resulting random polynomials,
+ * must be initialized [out]
+ * @param count the number of polynomials
+ * @param params the NTRU context
+ * @param num_ones the number of 1 coefficients
+ * @param num_neg_ones the number of -1 coefficients
+ * @param rng the rng to draw from, NULL for the per-thread DRBG
+ */
+void
+ntru_get_rnd_tern_poly_batch(fmpz_poly_t *polys,
+		size_t count,
+		const ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones,
+		ntru_rng *rng);
+
+/**
+ * Get a random ternary polynomial with specified numbers
+ * of 1 coefficients and -1 coefficients, sampled in constant
+ * time like in ntru_get_rnd_tern_poly_num(). The same DRBG state
+ * always yields the same polynomial.
+ *
+ * @param poly the resulting random polynomial, must be initialized [out]
+ * @param params the NTRU context
+ * @param num_ones the number of 1 coefficients
+ * @param num_neg_ones the number of -1 coefficients
+ * @param drbg the DRBG to draw from
+ */
+void
+ntru_get_rnd_tern_poly_drbg(fmpz_poly_t poly,
+		const ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones,
+		ntru_drbg *drbg);
 
 
 #endif /* NTRU_RND_H */
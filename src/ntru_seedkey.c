@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_seedkey.c
+ * This file handles private keys that are stored as
+ * a short seed and deterministically expanded on demand,
+ * optionally through a bounded cache.
+ * @brief seed-compressed private keys
+ */
+
+#include "ntru_common.h"
+#include "ntru_drbg.h"
+#include "ntru_err.h"
+#include "ntru_file.h"
+#include "ntru_keypair.h"
+#include "ntru_lru.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_poly.h"
+#include "ntru_rnd.h"
+#include "ntru_seedkey.h"
+#include "ntru_string.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Maximum number of seeds that are tried by
+ * ntru_generate_seed_key() before giving up.
+ */
+#define NTRU_SEEDGEN_MAX_TRIES 1000
+
+/**
+ * Size of the header of a seed key file, followed
+ * by the seed.
+ */
+#define SEEDKEY_HEADER_LEN 24
+
+/**
+ * Magic bytes at the start of every seed key file.
+ */
+static const char seedkey_magic[8] = "NTRUSED";
+
+
+typedef struct seed_cache_entry seed_cache_entry;
+
+
+/**
+ * An expanded private key, as stored in the cache.
+ */
+struct seed_cache_entry {
+	/**
+	 * The private key f.
+	 */
+	fmpz_poly_t priv;
+	/**
+	 * The inverse Fp of f.
+	 */
+	fmpz_poly_t priv_inv;
+};
+
+/**
+ * A thread-safe LRU cache of expanded private keys.
+ */
+struct ntru_seed_cache {
+	/**
+	 * Maps seed and parameters to seed_cache_entry.
+	 */
+	ntru_lru *lru;
+	/**
+	 * Protects lru.
+	 */
+	pthread_mutex_t lock;
+};
+
+
+/**
+ * Sets up the DRBG for expanding a seed. The parameters
+ * go into the nonce, so one seed yields unrelated keys for
+ * different parameter sets.
+ *
+ * @param drbg the DRBG to initialize [out]
+ * @param seed the seed, NTRU_SEED_LEN bytes
+ * @param params the NTRU context
+ */
+static void
+seed_drbg_init(ntru_drbg *drbg,
+		const uint8_t *seed,
+		const ntru_params *params);
+
+/**
+ * Frees a seed_cache_entry, used as callback for the LRU.
+ *
+ * @param value the seed_cache_entry
+ */
+static void
+seed_cache_entry_free(void *value);
+
+
+/*------------------------------------------------------------------------*/
+
+static void
+seed_drbg_init(ntru_drbg *drbg,
+		const uint8_t *seed,
+		const ntru_params *params)
+{
+	uint64_t nonce = ((uint64_t)params->N << 32) |
+		((uint64_t)(params->q & 0xffffff) << 8) |
+		(params->p & 0xff);
+
+	ntru_drbg_init(drbg, seed, nonce);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+seed_cache_entry_free(void *value)
+{
+	seed_cache_entry *entry = value;
+
+	fmpz_poly_clear(entry->priv);
+	fmpz_poly_clear(entry->priv_inv);
+	free(entry);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_generate_seed_key(uint8_t *seed,
+		keypair *pair,
+		const ntru_params *params,
+		ntru_rng *rng)
+{
+	if (!seed || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	for (uint32_t i = 0; i < NTRU_SEEDGEN_MAX_TRIES; i++) {
+		keypair tmp_pair;
+
+		ntru_rng_bytes(rng, seed, NTRU_SEED_LEN);
+
+		if (ntru_expand_seed_keypair(&tmp_pair, seed, params)) {
+			if (pair)
+				*pair = tmp_pair;
+			else
+				ntru_delete_keypair(&tmp_pair);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_expand_seed_keypair(keypair *pair,
+		const uint8_t *seed,
+		const ntru_params *params)
+{
+	ntru_drbg drbg;
+	fmpz_poly_t f,
+				g;
+	bool retval;
+
+	if (!pair || !seed || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	fmpz_poly_init(f);
+	fmpz_poly_init(g);
+
+	seed_drbg_init(&drbg, seed, params);
+	ntru_get_rnd_tern_poly_drbg(f, params,
+			NTRU_DF(params), NTRU_DF(params) - 1, &drbg);
+	ntru_get_rnd_tern_poly_drbg(g, params,
+			NTRU_DG(params), NTRU_DG(params), &drbg);
+	ntru_drbg_wipe(&drbg);
+
+	retval = ntru_create_keypair(pair, f, g, params);
+
+	fmpz_poly_clear(f);
+	fmpz_poly_clear(g);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_expand_seed_priv(fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		const uint8_t *seed,
+		const ntru_params *params)
+{
+	ntru_drbg drbg;
+
+	if (!priv || !priv_inv || !seed || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	/* f is drawn first, so we can stop right after it */
+	seed_drbg_init(&drbg, seed, params);
+	ntru_get_rnd_tern_poly_drbg(priv, params,
+			NTRU_DF(params), NTRU_DF(params) - 1, &drbg);
+	ntru_drbg_wipe(&drbg);
+
+	return poly_inverse_poly_p(priv_inv, priv, params);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+export_seed_key(char const * const filename,
+		const uint8_t *seed,
+		const ntru_params *params)
+{
+	uint8_t buf[SEEDKEY_HEADER_LEN + NTRU_SEED_LEN] = { 0 };
+	string seed_string;
+
+	if (!filename || !seed || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	memcpy(buf, seedkey_magic, sizeof(seedkey_magic));
+	put_le16(buf + 8, NTRU_SEEDKEY_VERSION);
+	put_le32(buf + 12, params->N);
+	put_le32(buf + 16, params->p);
+	put_le32(buf + 20, params->q);
+	memcpy(buf + SEEDKEY_HEADER_LEN, seed, NTRU_SEED_LEN);
+
+	seed_string.ptr = (char *)buf;
+	seed_string.len = sizeof(buf);
+
+	return write_file(&seed_string, filename);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+import_seed_key(uint8_t *seed,
+		char const * const filename,
+		const ntru_params *params)
+{
+	string *seed_string;
+	const uint8_t *buf;
+	bool retval = false;
+
+	if (!seed || !filename || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!(seed_string = read_file(filename)))
+		return false;
+
+	buf = (const uint8_t *)seed_string->ptr;
+
+	/* a seed expands to a different key under other parameters */
+	if (seed_string->len == SEEDKEY_HEADER_LEN + NTRU_SEED_LEN &&
+			!memcmp(buf, seedkey_magic, sizeof(seedkey_magic)) &&
+			get_le16(buf + 8) == NTRU_SEEDKEY_VERSION &&
+			get_le32(buf + 12) == params->N &&
+			get_le32(buf + 16) == params->p &&
+			get_le32(buf + 20) == params->q) {
+		memcpy(seed, buf + SEEDKEY_HEADER_LEN, NTRU_SEED_LEN);
+		retval = true;
+	}
+
+	string_delete(seed_string);
+
+	return retval;
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_seed_cache *
+ntru_seed_cache_new(size_t capacity)
+{
+	ntru_seed_cache *cache = ntru_malloc(sizeof(*cache));
+
+	/* every entry costs 1, so the cost limit is the capacity */
+	cache->lru = ntru_lru_new(capacity, seed_cache_entry_free);
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool
+ntru_seed_cache_get_priv(ntru_seed_cache *cache,
+		fmpz_poly_t priv,
+		fmpz_poly_t priv_inv,
+		const uint8_t *seed,
+		const ntru_params *params)
+{
+	uint8_t key[NTRU_SEED_LEN + 3 * sizeof(uint32_t)];
+	seed_cache_entry *entry;
+
+	if (!cache || !priv || !priv_inv || !seed || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	memcpy(key, seed, NTRU_SEED_LEN);
+	memcpy(key + NTRU_SEED_LEN, &params->N, sizeof(uint32_t));
+	memcpy(key + NTRU_SEED_LEN + 4, &params->q, sizeof(uint32_t));
+	memcpy(key + NTRU_SEED_LEN + 8, &params->p, sizeof(uint32_t));
+
+	pthread_mutex_lock(&cache->lock);
+	if ((entry = ntru_lru_get(cache->lru, key, sizeof(key)))) {
+		fmpz_poly_set(priv, entry->priv);
+		fmpz_poly_set(priv_inv, entry->priv_inv);
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	if (entry)
+		return true;
+
+	/* expand without holding the lock */
+	if (!ntru_expand_seed_priv(priv, priv_inv, seed, params))
+		return false;
+
+	entry = ntru_malloc(sizeof(*entry));
+	fmpz_poly_init(entry->priv);
+	fmpz_poly_init(entry->priv_inv);
+	fmpz_poly_set(entry->priv, priv);
+	fmpz_poly_set(entry->priv_inv, priv_inv);
+
+	pthread_mutex_lock(&cache->lock);
+	ntru_lru_put(cache->lru, key, sizeof(key), entry, 1);
+	pthread_mutex_unlock(&cache->lock);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_seed_cache_get_stats(ntru_seed_cache *cache,
+		ntru_cache_stats *stats)
+{
+	if (!cache || !stats)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	pthread_mutex_lock(&cache->lock);
+	ntru_lru_get_stats(cache->lru, stats);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_seed_cache_delete(ntru_seed_cache *cache)
+{
+	if (!cache)
+		return;
+
+	ntru_lru_delete(cache->lru);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+/*------------------------------------------------------------------------*/
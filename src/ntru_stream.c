@@ -0,0 +1,714 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_stream.c
+ * This file handles the encryption and decryption of
+ * messages that arrive in pieces, in constant memory.
+ * @brief streaming encryption/decryption
+ */
+
+#include "ntru_ascii_poly.h"
+#include "ntru_base64.h"
+#include "ntru_common.h"
+#include "ntru_compress.h"
+#include "ntru_err.h"
+#include "ntru_mem.h"
+#include "ntru_params.h"
+#include "ntru_poly.h"
+#include "ntru_poly_ascii.h"
+#include "ntru_rnd.h"
+#include "ntru_stream.h"
+#include "ntru_string.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fmpz_poly.h>
+#include <fmpz.h>
+
+
+/**
+ * State of a message that is encrypted in pieces.
+ */
+struct ntru_encrypt_ctx {
+	/**
+	 * The NTRU context.
+	 */
+	ntru_params params;
+	/**
+	 * The public key, residues mod q.
+	 */
+	int32_t *h;
+	/**
+	 * The random poly of the current block, residues mod q.
+	 */
+	int32_t *r;
+	/**
+	 * The random poly of the current block.
+	 */
+	fmpz_poly_t rnd;
+	/**
+	 * Where the random polys come from, NULL for the
+	 * per-thread DRBG.
+	 */
+	ntru_rng *rng;
+	/**
+	 * The message of the current block.
+	 */
+	int32_t *m;
+	/**
+	 * The ciphertext of the current block.
+	 */
+	int32_t *c;
+	/**
+	 * The bits of the current block as coefficients.
+	 */
+	int8_t *coeffs;
+	/**
+	 * The message bytes that do not fill a chunk yet,
+	 * COMPRESS_CHUNK_LEN bytes.
+	 */
+	uint8_t *buf;
+	/**
+	 * Number of bytes in buf.
+	 */
+	size_t buf_len;
+	/**
+	 * The frame of the current chunk,
+	 * compress_bound(COMPRESS_CHUNK_LEN) bytes.
+	 */
+	uint8_t *frame;
+	/**
+	 * The ciphertext bytes that are not base64 encoded yet,
+	 * params.N + 2 bytes.
+	 */
+	uint8_t *raw;
+	/**
+	 * Number of bytes in raw.
+	 */
+	size_t raw_len;
+};
+
+/**
+ * State of a ciphertext that is decrypted in pieces.
+ */
+struct ntru_decrypt_ctx {
+	/**
+	 * The NTRU context.
+	 */
+	ntru_params params;
+	/**
+	 * The private key, residues mod q.
+	 */
+	int32_t *f;
+	/**
+	 * The inverse of the private key, residues mod q.
+	 */
+	int32_t *fp;
+	/**
+	 * The ciphertext of the current block.
+	 */
+	int32_t *e;
+	/**
+	 * The message of the current block.
+	 */
+	int32_t *d;
+	/**
+	 * Scratch space of the decryption kernel.
+	 */
+	int32_t *tmp;
+	/**
+	 * The message of the current block as bits.
+	 */
+	int8_t *coeffs;
+	/**
+	 * Base64 characters that do not fill a group yet.
+	 */
+	char group[4];
+	/**
+	 * Number of characters in group.
+	 */
+	size_t group_len;
+	/**
+	 * The ciphertext bytes that do not fill a block yet,
+	 * params.N + STREAM_DECODE_LEN bytes.
+	 */
+	uint8_t *raw;
+	/**
+	 * Number of bytes in raw.
+	 */
+	size_t raw_len;
+	/**
+	 * The bits of the frame of the current chunk, zeroed
+	 * behind frame_bits.
+	 */
+	uint8_t *frame;
+	/**
+	 * Number of bits in frame.
+	 */
+	size_t frame_bits;
+	/**
+	 * Whether the end of the stream was decrypted.
+	 */
+	bool done;
+	/**
+	 * Whether the ciphertext turned out to be invalid.
+	 */
+	bool failed;
+};
+
+
+/**
+ * The frame that marks the end of a stream. A frame never
+ * starts with four zero bytes otherwise.
+ */
+static const uint8_t stream_end[4] = { 0, 0, 0, 0 };
+
+
+/**
+ * Grows a string so that more bytes can be appended.
+ *
+ * @param out the string
+ * @param cap the allocated size of out->ptr, updated [in, out]
+ * @param more the number of bytes to append
+ * @return where to append them
+ */
+static char *
+out_reserve(string *out, size_t *cap, size_t more);
+
+/**
+ * Encrypts a frame into the next blocks and appends the
+ * base64 of all complete groups of 3 bytes to out, the rest
+ * is kept in ctx->raw.
+ *
+ * @param ctx the context
+ * @param frame the frame
+ * @param frame_len the size of the frame
+ * @param out where to append the base64 [out]
+ * @param cap the allocated size of out->ptr [in, out]
+ */
+static void
+encrypt_segment(ntru_encrypt_ctx *ctx,
+		const uint8_t *frame,
+		size_t frame_len,
+		string *out,
+		size_t *cap);
+
+/**
+ * Compresses a chunk and encrypts its frame.
+ *
+ * @param ctx the context
+ * @param in the chunk
+ * @param len the size of the chunk, at most COMPRESS_CHUNK_LEN
+ * @param out where to append the base64 [out]
+ * @param cap the allocated size of out->ptr [in, out]
+ * @return true for success, false if compression failed
+ */
+static bool
+encrypt_chunk(ntru_encrypt_ctx *ctx,
+		const uint8_t *in,
+		size_t len,
+		string *out,
+		size_t *cap);
+
+/**
+ * Frees an encryption context.
+ *
+ * @param ctx the context
+ */
+static void
+encrypt_ctx_delete(ntru_encrypt_ctx *ctx);
+
+/**
+ * Checks whether the frame of the current chunk is complete,
+ * if so its message is appended to out and the next chunk
+ * starts.
+ *
+ * @param ctx the context
+ * @param out where to append the message [out]
+ * @param cap the allocated size of out->ptr [in, out]
+ * @return true for success, false if the frame is invalid
+ */
+static bool
+decrypt_segment(ntru_decrypt_ctx *ctx, string *out, size_t *cap);
+
+/**
+ * Decrypts all complete blocks in ctx->raw, the rest is
+ * moved to its front.
+ *
+ * @param ctx the context
+ * @param out where to append the message [out]
+ * @param cap the allocated size of out->ptr [in, out]
+ * @return true for success, false if the ciphertext is invalid
+ */
+static bool
+decrypt_blocks(ntru_decrypt_ctx *ctx, string *out, size_t *cap);
+
+/**
+ * Frees a decryption context.
+ *
+ * @param ctx the context
+ */
+static void
+decrypt_ctx_delete(ntru_decrypt_ctx *ctx);
+
+
+/*------------------------------------------------------------------------*/
+
+static char *
+out_reserve(string *out, size_t *cap, size_t more)
+{
+	if (out->len + more > *cap) {
+		*cap = (out->len + more > 2 * *cap) ? out->len + more : 2 * *cap;
+		REALLOC(out->ptr, *cap);
+	}
+
+	return out->ptr + out->len;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+encrypt_segment(ntru_encrypt_ctx *ctx,
+		const uint8_t *frame,
+		size_t frame_len,
+		string *out,
+		size_t *cap)
+{
+	const uint32_t N = ctx->params.N;
+	size_t bits = frame_len * ASCII_BITS,
+		   raw_len = (bits + N - 1) / N * N;
+	char *dst = out_reserve(out, cap, (ctx->raw_len + raw_len) / 3 * 4);
+
+	for (size_t i = 0; i < raw_len; i += N) {
+		uint32_t len = (bits - i > N) ? N : bits - i;
+		size_t whole;
+
+		/* bit 1 is coefficient 1, bit 0 is -1, padding is 0 */
+		bytes_to_bin_coeffs(ctx->coeffs, frame, i, len);
+		for (uint32_t k = 0; k < N; k++)
+			ctx->m[k] = k < len ? ctx->coeffs[k] : 0;
+
+		/* a shared r would be revealed by any known block */
+		ntru_get_rnd_tern_poly_num(ctx->rnd, &ctx->params,
+				NTRU_DR(&ctx->params), NTRU_DR(&ctx->params), ctx->rng);
+		poly_get_residues(ctx->r, ctx->rnd, &ctx->params, ctx->params.q);
+
+		poly_encrypt_kernel(ctx->c, ctx->h, ctx->r, ctx->m, &ctx->params);
+
+		for (uint32_t k = 0; k < N; k++)
+			ctx->raw[ctx->raw_len + k] = (uint8_t)ctx->c[k];
+		ctx->raw_len += N;
+
+		/* base64 without padding needs groups of 3 bytes */
+		whole = ctx->raw_len / 3 * 3;
+		dst += base64_encode(dst, ctx->raw, whole);
+		memmove(ctx->raw, ctx->raw + whole, ctx->raw_len - whole);
+		ctx->raw_len -= whole;
+	}
+
+	out->len = dst - out->ptr;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+encrypt_chunk(ntru_encrypt_ctx *ctx,
+		const uint8_t *in,
+		size_t len,
+		string *out,
+		size_t *cap)
+{
+	size_t frame_len;
+
+	/* fails e.g. if the dictionary of the policy is gone */
+	if (!(frame_len = compress_frame(ctx->frame, in, len, NULL, NULL)))
+		return false;
+
+	encrypt_segment(ctx, ctx->frame, frame_len, out, cap);
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+encrypt_ctx_delete(ntru_encrypt_ctx *ctx)
+{
+	fmpz_poly_clear(ctx->rnd);
+	free(ctx->h);
+	free(ctx->buf);
+	free(ctx);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_encrypt_ctx *
+ntru_encrypt_init(const fmpz_poly_t pub_key,
+		const ntru_params *params,
+		ntru_rng *rng)
+{
+	ntru_encrypt_ctx *ctx;
+	uint32_t N;
+
+	if (!pub_key || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	/* the string format has one byte per coefficient */
+	if (params->q > 256)
+		return NULL;
+
+	N = params->N;
+	ctx = ntru_malloc(sizeof(*ctx));
+	ctx->params = *params;
+	ctx->h = ntru_malloc(sizeof(*ctx->h) * 4 * N + 2 * N + 2);
+	ctx->r = ctx->h + N;
+	ctx->m = ctx->h + 2 * N;
+	ctx->c = ctx->h + 3 * N;
+	ctx->coeffs = (int8_t *)(ctx->h + 4 * N);
+	ctx->raw = (uint8_t *)(ctx->coeffs + N);
+	ctx->raw_len = 0;
+	ctx->buf = ntru_malloc(COMPRESS_CHUNK_LEN +
+			compress_bound(COMPRESS_CHUNK_LEN));
+	ctx->buf_len = 0;
+	ctx->frame = ctx->buf + COMPRESS_CHUNK_LEN;
+
+	poly_get_residues(ctx->h, pub_key, params, params->q);
+	fmpz_poly_init(ctx->rnd);
+	ctx->rng = rng;
+
+	return ctx;
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_encrypt_update(ntru_encrypt_ctx *ctx, const string *chunk)
+{
+	const uint8_t *in;
+	size_t len,
+		   n,
+		   cap = 1;
+	string *out;
+
+	if (!ctx || !chunk)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	in = (const uint8_t *)chunk->ptr;
+	len = chunk->len;
+	out = ntru_malloc(sizeof(*out));
+	out->ptr = ntru_malloc(cap);
+	out->len = 0;
+
+	while (len) {
+		/* whole chunks are compressed without a copy */
+		if (!ctx->buf_len && len >= COMPRESS_CHUNK_LEN) {
+			if (!encrypt_chunk(ctx, in, COMPRESS_CHUNK_LEN, out, &cap))
+				goto failure_cleanup;
+			in += COMPRESS_CHUNK_LEN;
+			len -= COMPRESS_CHUNK_LEN;
+			continue;
+		}
+
+		n = COMPRESS_CHUNK_LEN - ctx->buf_len;
+		if (n > len)
+			n = len;
+		memcpy(ctx->buf + ctx->buf_len, in, n);
+		ctx->buf_len += n;
+		in += n;
+		len -= n;
+
+		if (ctx->buf_len == COMPRESS_CHUNK_LEN) {
+			if (!encrypt_chunk(ctx, ctx->buf, ctx->buf_len, out, &cap))
+				goto failure_cleanup;
+			ctx->buf_len = 0;
+		}
+	}
+
+	return out;
+
+failure_cleanup:
+	string_delete(out);
+	return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_encrypt_final(ntru_encrypt_ctx *ctx)
+{
+	size_t cap = 1;
+	string *out;
+	char *dst;
+
+	if (!ctx)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	out = ntru_malloc(sizeof(*out));
+	out->ptr = ntru_malloc(cap);
+	out->len = 0;
+
+	if (ctx->buf_len && !encrypt_chunk(ctx, ctx->buf, ctx->buf_len, out,
+				&cap)) {
+		string_delete(out);
+		encrypt_ctx_delete(ctx);
+		return NULL;
+	}
+
+	encrypt_segment(ctx, stream_end, sizeof(stream_end), out, &cap);
+
+	/* only the very end is padded */
+	dst = out_reserve(out, &cap, BASE64_ENCODED_LEN(ctx->raw_len));
+	out->len += base64_encode(dst, ctx->raw, ctx->raw_len);
+
+	encrypt_ctx_delete(ctx);
+
+	return out;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+decrypt_segment(ntru_decrypt_ctx *ctx, string *out, size_t *cap)
+{
+	size_t have = ctx->frame_bits / ASCII_BITS,
+		   header_len,
+		   payload_len,
+		   content_len;
+	uint32_t dict_id;
+	bool stored;
+	char *dst;
+
+	if (have >= sizeof(stream_end) &&
+			!memcmp(ctx->frame, stream_end, sizeof(stream_end))) {
+		ctx->done = true;
+		return true;
+	}
+
+	/* the frame of a chunk cannot get any larger */
+	if (!frame_header(ctx->frame, have, &header_len, &payload_len,
+				&content_len, &stored, &dict_id))
+		return have < compress_bound(COMPRESS_CHUNK_LEN);
+
+	if (content_len > COMPRESS_CHUNK_LEN)
+		return false;
+
+	dst = out_reserve(out, cap, content_len);
+	if (decompress_frame_into(dst, content_len, ctx->frame, have,
+				NULL) != content_len)
+		return false;
+	out->len += content_len;
+
+	/* the next chunk starts with a fresh block */
+	memset(ctx->frame, 0, (ctx->frame_bits + ASCII_BITS - 1) / ASCII_BITS);
+	ctx->frame_bits = 0;
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool
+decrypt_blocks(ntru_decrypt_ctx *ctx, string *out, size_t *cap)
+{
+	const uint32_t N = ctx->params.N;
+	size_t off;
+
+	for (off = 0; ctx->raw_len - off >= N; off += N) {
+		/* nothing may follow the end of the stream */
+		if (ctx->done)
+			return false;
+
+		for (uint32_t k = 0; k < N; k++)
+			ctx->e[k] = ctx->raw[off + k] % ctx->params.q;
+
+		poly_decrypt_kernel(ctx->d, ctx->tmp, ctx->f, ctx->e, ctx->fp,
+				&ctx->params);
+
+		/* the padding decrypts to zeros, which become 0 bits */
+		for (uint32_t k = 0; k < N; k++)
+			ctx->coeffs[k] = (int8_t)ctx->d[k];
+
+		bin_coeffs_to_bytes(ctx->frame, ctx->coeffs, ctx->frame_bits, N);
+		ctx->frame_bits += N;
+
+		if (!decrypt_segment(ctx, out, cap))
+			return false;
+	}
+
+	memmove(ctx->raw, ctx->raw + off, ctx->raw_len - off);
+	ctx->raw_len -= off;
+
+	return true;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+decrypt_ctx_delete(ntru_decrypt_ctx *ctx)
+{
+	free(ctx->f);
+	free(ctx->raw);
+	free(ctx);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_decrypt_ctx *
+ntru_decrypt_init(const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params)
+{
+	ntru_decrypt_ctx *ctx;
+	size_t frame_max;
+	uint32_t N;
+
+	if (!priv_key || !priv_key_inv || !params)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	/* the string format has one byte per coefficient */
+	if (params->q > 256)
+		return NULL;
+
+	N = params->N;
+	ctx = ntru_malloc(sizeof(*ctx));
+	ctx->params = *params;
+	ctx->f = ntru_malloc(sizeof(*ctx->f) * 6 * N + N);
+	ctx->fp = ctx->f + N;
+	ctx->e = ctx->f + 2 * N;
+	ctx->d = ctx->f + 3 * N;
+	ctx->tmp = ctx->f + 4 * N;
+	ctx->coeffs = (int8_t *)(ctx->f + 6 * N);
+	ctx->group_len = 0;
+
+	/* one more block can be added to a frame that is not complete */
+	frame_max = compress_bound(COMPRESS_CHUNK_LEN) +
+		(N + ASCII_BITS - 1) / ASCII_BITS + 1;
+	ctx->raw = ntru_malloc(N + STREAM_DECODE_LEN + frame_max);
+	ctx->raw_len = 0;
+	ctx->frame = ctx->raw + N + STREAM_DECODE_LEN;
+	memset(ctx->frame, 0, frame_max);
+	ctx->frame_bits = 0;
+	ctx->done = false;
+	ctx->failed = false;
+
+	poly_get_residues(ctx->f, priv_key, params, params->q);
+	poly_get_residues(ctx->fp, priv_key_inv, params, params->q);
+
+	return ctx;
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_decrypt_update(ntru_decrypt_ctx *ctx, const string *chunk)
+{
+	const char *in;
+	size_t len,
+		   n,
+		   decoded,
+		   cap = 1;
+	string *out;
+	bool valid;
+
+	if (!ctx || !chunk)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	if (ctx->failed)
+		return NULL;
+
+	in = chunk->ptr;
+	len = chunk->len;
+	out = ntru_malloc(sizeof(*out));
+	out->ptr = ntru_malloc(cap);
+	out->len = 0;
+
+	while (len) {
+		/* groups of 4 characters may be split between pieces */
+		if (ctx->group_len || len < 4) {
+			n = 4 - ctx->group_len;
+			if (n > len)
+				n = len;
+			memcpy(ctx->group + ctx->group_len, in, n);
+			ctx->group_len += n;
+			in += n;
+			len -= n;
+			if (ctx->group_len < 4)
+				break;
+
+			valid = base64_decode(ctx->raw + ctx->raw_len, &decoded,
+					ctx->group, 4);
+			ctx->group_len = 0;
+		} else {
+			n = len / 4 * 4;
+			if (n > STREAM_DECODE_LEN / 3 * 4)
+				n = STREAM_DECODE_LEN / 3 * 4;
+
+			valid = base64_decode(ctx->raw + ctx->raw_len, &decoded, in, n);
+			in += n;
+			len -= n;
+		}
+
+		if (!valid) {
+			ctx->failed = true;
+			break;
+		}
+		ctx->raw_len += decoded;
+
+		if (!decrypt_blocks(ctx, out, &cap)) {
+			ctx->failed = true;
+			break;
+		}
+	}
+
+	if (ctx->failed) {
+		string_delete(out);
+		return NULL;
+	}
+
+	return out;
+}
+
+/*------------------------------------------------------------------------*/
+
+string *
+ntru_decrypt_final(ntru_decrypt_ctx *ctx)
+{
+	string *out = NULL;
+
+	if (!ctx)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters");
+
+	/* a truncated stream ends before its end block */
+	if (!ctx->failed && ctx->done && !ctx->group_len && !ctx->raw_len) {
+		out = ntru_malloc(sizeof(*out));
+		out->ptr = ntru_malloc(1);
+		out->len = 0;
+	}
+
+	decrypt_ctx_delete(ctx);
+
+	return out;
+}
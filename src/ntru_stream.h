@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_stream.h
+ * Header for the internal API of ntru_stream.c.
+ * @brief header for ntru_stream.c
+ */
+
+#ifndef NTRU_STREAM_H
+#define NTRU_STREAM_H
+
+
+#include "ntru_params.h"
+#include "ntru_rnd.h"
+#include "ntru_string.h"
+
+#include <fmpz_poly.h>
+
+
+/**
+ * Number of bytes ntru_decrypt_update() decodes from
+ * the base64 at once, a multiple of 3.
+ */
+#define STREAM_DECODE_LEN (48 * 1024)
+
+
+typedef struct ntru_encrypt_ctx ntru_encrypt_ctx;
+typedef struct ntru_decrypt_ctx ntru_decrypt_ctx;
+
+
+/**
+ * Starts encrypting a message that arrives in pieces. Up to
+ * one compression chunk of the message is buffered, each full
+ * chunk is compressed into its own frame, which starts with a
+ * fresh block, and encrypted right away. The end of the stream
+ * is marked by a block, so truncated ciphertexts are detected.
+ * The compression policy is the one set with
+ * ntru_set_compress_policy(). Like in ntru_encrypt_string_parallel(),
+ * every block gets its own random poly r, sampled from rng with
+ * NTRU_DR() 1 and -1 coefficients (each).
+ *
+ * @param pub_key the public key
+ * @param params ntru_params the ntru context
+ * @param rng the rng for the random polys, NULL for the
+ * per-thread DRBG, must stay valid until ntru_encrypt_final()
+ * @return the newly allocated context, NULL if q is larger than
+ * 256, as one byte is stored per coefficient
+ */
+ntru_encrypt_ctx *
+ntru_encrypt_init(const fmpz_poly_t pub_key,
+		const ntru_params *params,
+		ntru_rng *rng);
+
+/**
+ * Encrypts the next piece of a message.
+ *
+ * @param ctx the context from ntru_encrypt_init()
+ * @param chunk the next piece, of any size
+ * @return the next part of the base64 ciphertext, newly
+ * allocated and possibly empty, NULL on failure
+ */
+string *
+ntru_encrypt_update(ntru_encrypt_ctx *ctx, const string *chunk);
+
+/**
+ * Encrypts the rest of the message and the end of the stream
+ * and frees the context.
+ *
+ * @param ctx the context from ntru_encrypt_init()
+ * @return the last part of the base64 ciphertext, newly
+ * allocated, NULL on failure
+ */
+string *
+ntru_encrypt_final(ntru_encrypt_ctx *ctx);
+
+/**
+ * Starts decrypting a ciphertext of ntru_encrypt_init() that
+ * arrives in pieces. Only the frame of one compression chunk
+ * and a piece of the base64 are buffered, so the memory does
+ * not depend on the size of the message.
+ *
+ * @param priv_key the polynomial containing the private key to decrypt
+ * 		the message
+ * @param priv_key_inv the inverse polynome to the private key
+ * @param params the ntru_params
+ * @return the newly allocated context, NULL if q is larger than 256
+ */
+ntru_decrypt_ctx *
+ntru_decrypt_init(const fmpz_poly_t priv_key,
+		const fmpz_poly_t priv_key_inv,
+		const ntru_params *params);
+
+/**
+ * Decrypts the next piece of a ciphertext.
+ *
+ * @param ctx the context from ntru_decrypt_init()
+ * @param chunk the next piece of the base64, of any size,
+ * without whitespace
+ * @return the message of all chunks completed by this piece,
+ * newly allocated and possibly empty, NULL if the ciphertext
+ * is invalid, then all further calls fail as well
+ */
+string *
+ntru_decrypt_update(ntru_decrypt_ctx *ctx, const string *chunk);
+
+/**
+ * Checks that the whole ciphertext arrived and frees the
+ * context.
+ *
+ * @param ctx the context from ntru_decrypt_init()
+ * @return an empty string, newly allocated, NULL if the
+ * ciphertext is invalid or truncated
+ */
+string *
+ntru_decrypt_final(ntru_decrypt_ctx *ctx);
+
+
+#endif /* NTRU_STREAM_H */
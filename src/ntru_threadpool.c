@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_threadpool.c
+ * This file implements a simple pool of worker threads
+ * with a FIFO task queue, shared by everything in the
+ * library that works in parallel.
+ * @brief thread pool
+ */
+
+#include "ntru_err.h"
+#include "ntru_mem.h"
+#include "ntru_threadpool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+typedef struct pool_task pool_task;
+typedef struct parallel_job parallel_job;
+
+
+/**
+ * A queued task.
+ */
+struct pool_task {
+	/**
+	 * The function to run.
+	 */
+	void (*task)(void *arg);
+	/**
+	 * The argument passed to task.
+	 */
+	void *arg;
+	/**
+	 * The next task in the queue.
+	 */
+	pool_task *next;
+};
+
+/**
+ * A pool of worker threads.
+ */
+struct ntru_thread_pool {
+	/**
+	 * The worker threads.
+	 */
+	pthread_t *threads;
+	/**
+	 * Number of started worker threads.
+	 */
+	uint32_t num_threads;
+	/**
+	 * First task in the queue.
+	 */
+	pool_task *head;
+	/**
+	 * Last task in the queue.
+	 */
+	pool_task *tail;
+	/**
+	 * Whether the workers should terminate once
+	 * the queue is empty.
+	 */
+	bool stop;
+	/**
+	 * Protects the queue and stop.
+	 */
+	pthread_mutex_t lock;
+	/**
+	 * Signals the workers that a task was queued
+	 * or that they should stop.
+	 */
+	pthread_cond_t wakeup;
+};
+
+/**
+ * State of one ntru_thread_pool_parallel_for() call,
+ * shared between the caller and the helper tasks.
+ */
+struct parallel_job {
+	/**
+	 * The function to run for every iteration.
+	 */
+	void (*body)(size_t i, void *arg);
+	/**
+	 * The argument passed to body.
+	 */
+	void *arg;
+	/**
+	 * Number of iterations.
+	 */
+	size_t n;
+	/**
+	 * Next iteration to hand out.
+	 */
+	size_t next;
+	/**
+	 * Number of finished iterations.
+	 */
+	size_t done;
+	/**
+	 * Number of helper tasks that still reference
+	 * the job, plus one for the caller.
+	 */
+	uint32_t refs;
+	/**
+	 * Protects next, done and refs.
+	 */
+	pthread_mutex_t lock;
+	/**
+	 * Signals the caller that all iterations finished.
+	 */
+	pthread_cond_t finished;
+};
+
+
+/**
+ * Main loop of a worker thread.
+ *
+ * @param arg the ntru_thread_pool
+ * @return NULL
+ */
+static void *
+pool_worker(void *arg);
+
+/**
+ * Runs iterations of a parallel_job until none are left.
+ *
+ * @param job the job
+ */
+static void
+parallel_job_run(parallel_job *job);
+
+/**
+ * Helper task of ntru_thread_pool_parallel_for().
+ *
+ * @param arg the parallel_job
+ */
+static void
+parallel_job_task(void *arg);
+
+/**
+ * Drops a reference of a parallel_job and frees it
+ * when it was the last one.
+ *
+ * @param job the job
+ */
+static void
+parallel_job_unref(parallel_job *job);
+
+
+/*------------------------------------------------------------------------*/
+
+static void *
+pool_worker(void *arg)
+{
+	ntru_thread_pool *pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		pool_task *task;
+
+		while (!pool->head && !pool->stop)
+			pthread_cond_wait(&pool->wakeup, &pool->lock);
+
+		if (!pool->head)
+			break;
+
+		task = pool->head;
+		pool->head = task->next;
+		if (!pool->head)
+			pool->tail = NULL;
+
+		pthread_mutex_unlock(&pool->lock);
+		task->task(task->arg);
+		free(task);
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+parallel_job_run(parallel_job *job)
+{
+	while (1) {
+		size_t i;
+
+		pthread_mutex_lock(&job->lock);
+		if (job->next == job->n) {
+			pthread_mutex_unlock(&job->lock);
+			return;
+		}
+		i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+
+		job->body(i, job->arg);
+
+		pthread_mutex_lock(&job->lock);
+		if (++job->done == job->n)
+			pthread_cond_signal(&job->finished);
+		pthread_mutex_unlock(&job->lock);
+	}
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+parallel_job_task(void *arg)
+{
+	parallel_job *job = arg;
+
+	parallel_job_run(job);
+	parallel_job_unref(job);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void
+parallel_job_unref(parallel_job *job)
+{
+	uint32_t refs;
+
+	pthread_mutex_lock(&job->lock);
+	refs = --job->refs;
+	pthread_mutex_unlock(&job->lock);
+
+	if (refs)
+		return;
+
+	pthread_mutex_destroy(&job->lock);
+	pthread_cond_destroy(&job->finished);
+	free(job);
+}
+
+/*------------------------------------------------------------------------*/
+
+ntru_thread_pool *
+ntru_thread_pool_new(uint32_t num_threads)
+{
+	ntru_thread_pool *pool;
+
+	if (num_threads == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		num_threads = cpus > 0 ? (uint32_t)cpus : 1;
+	}
+
+	pool = ntru_calloc(1, sizeof(*pool));
+	pool->threads = ntru_malloc(sizeof(*pool->threads) * num_threads);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wakeup, NULL);
+
+	for (uint32_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&pool->threads[pool->num_threads], NULL,
+					pool_worker, pool))
+			break;
+		pool->num_threads++;
+	}
+
+	if (!pool->num_threads) {
+		NTRU_WARN_DEBUG("Failed to start any worker thread");
+		ntru_thread_pool_delete(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+/*------------------------------------------------------------------------*/
+
+uint32_t
+ntru_thread_pool_size(const ntru_thread_pool *pool)
+{
+	if (!pool)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	return pool->num_threads;
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_thread_pool_submit(ntru_thread_pool *pool,
+		void (*task)(void *arg),
+		void *arg)
+{
+	pool_task *new_task;
+
+	if (!pool || !task)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	new_task = ntru_malloc(sizeof(*new_task));
+	new_task->task = task;
+	new_task->arg = arg;
+	new_task->next = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->tail)
+		pool->tail->next = new_task;
+	else
+		pool->head = new_task;
+	pool->tail = new_task;
+	pthread_cond_signal(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_thread_pool_parallel_for(ntru_thread_pool *pool,
+		size_t n,
+		void (*body)(size_t i, void *arg),
+		void *arg)
+{
+	parallel_job *job;
+	uint32_t helpers;
+
+	if (!body)
+		NTRU_ABORT_DEBUG("Unexpected NULL parameters in");
+
+	if (!pool || n <= 1) {
+		for (size_t i = 0; i < n; i++)
+			body(i, arg);
+		return;
+	}
+
+	helpers = pool->num_threads;
+	if (helpers > n - 1)
+		helpers = n - 1;
+
+	/* the job lives on the heap, helper tasks may only
+	 * get to run after the caller already returned */
+	job = ntru_malloc(sizeof(*job));
+	job->body = body;
+	job->arg = arg;
+	job->n = n;
+	job->next = 0;
+	job->done = 0;
+	job->refs = helpers + 1;
+	pthread_mutex_init(&job->lock, NULL);
+	pthread_cond_init(&job->finished, NULL);
+
+	for (uint32_t i = 0; i < helpers; i++)
+		ntru_thread_pool_submit(pool, parallel_job_task, job);
+
+	parallel_job_run(job);
+
+	pthread_mutex_lock(&job->lock);
+	while (job->done < job->n)
+		pthread_cond_wait(&job->finished, &job->lock);
+	pthread_mutex_unlock(&job->lock);
+
+	parallel_job_unref(job);
+}
+
+/*------------------------------------------------------------------------*/
+
+void
+ntru_thread_pool_delete(ntru_thread_pool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->wakeup);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (uint32_t i = 0; i < pool->num_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->wakeup);
+	free(pool->threads);
+	free(pool);
+}
+
+/*------------------------------------------------------------------------*/
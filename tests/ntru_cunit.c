@@ -125,6 +125,10 @@ int main(void)
 							 test_create_keypair1)) ||
 		(NULL == CU_add_test(pSuite, "test2 keypair creation",
 							 test_create_keypair2)) ||
+		(NULL == CU_add_test(pSuite, "test1 keypair generation",
+							 test_generate_keypair1)) ||
+		(NULL == CU_add_test(pSuite, "test2 keypair generation",
+							 test_generate_keypair2)) ||
 		(NULL == CU_add_test(pSuite, "test1 public key export",
 							 test_export_public_key1)) ||
 		(NULL == CU_add_test(pSuite, "test2 public key export",
@@ -147,6 +151,211 @@ int main(void)
 		return CU_get_error();
 	}
 
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("keypool tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 keypool take",
+							 test_keypool_take1)) ||
+		(NULL == CU_add_test(pSuite, "test2 keypool take",
+							 test_keypool_take2)) ||
+		(NULL == CU_add_test(pSuite, "test3 keypool take",
+							 test_keypool_take3))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("seed key tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 seed key expansion",
+							 test_seed_key_expand1)) ||
+		(NULL == CU_add_test(pSuite, "test1 seed key export",
+							 test_seed_key_export1)) ||
+		(NULL == CU_add_test(pSuite, "test1 seed cache",
+							 test_seed_cache1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("key file tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 public key file",
+							 test_keyfile_public1)) ||
+		(NULL == CU_add_test(pSuite, "test1 priv key file",
+							 test_keyfile_private1)) ||
+		(NULL == CU_add_test(pSuite, "test1 key file view",
+							 test_key_view1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("keyring tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 keyring add",
+							 test_keyring_add1)) ||
+		(NULL == CU_add_test(pSuite, "test2 keyring add",
+							 test_keyring_add2)) ||
+		(NULL == CU_add_test(pSuite, "test3 keyring add",
+							 test_keyring_add3)) ||
+		(NULL == CU_add_test(pSuite, "test1 keyring compaction",
+							 test_keyring_compact1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("key cache tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 key cache public key",
+							 test_key_cache_public1)) ||
+		(NULL == CU_add_test(pSuite, "test1 key cache priv key",
+							 test_key_cache_private1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("thread pool tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 thread pool parallel for",
+							 test_thread_pool_parallel_for1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("key loader tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 key loader",
+							 test_key_loader1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("key store tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 key store file",
+							 test_keystore_file1)) ||
+		(NULL == CU_add_test(pSuite, "test1 key store shared memory",
+							 test_keystore_shm1)) ||
+		(NULL == CU_add_test(pSuite, "test1 key store crypt",
+							 test_keystore_crypt1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("random number tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 random bytes",
+							 test_rnd_bytes1)) ||
+		(NULL == CU_add_test(pSuite, "test1 random bytes after fork",
+							 test_rnd_fork1)) ||
+		(NULL == CU_add_test(pSuite, "test1 rng fork",
+							 test_rng_fork1)) ||
+		(NULL == CU_add_test(pSuite, "test1 ternary polynomial sampling",
+							 test_rnd_tern_poly1)) ||
+		(NULL == CU_add_test(pSuite, "test1 ternary polynomial batch",
+							 test_rnd_tern_poly_batch1)) ||
+		(NULL == CU_add_test(pSuite, "test1 seeded rng",
+							 test_rng_seeded1))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
 	/* add a suite to the registry */
 	pSuite = CU_add_suite("encryption tests",
 		init_suite,
@@ -159,7 +368,23 @@ int main(void)
 	/* add the tests to the suite */
 	if (
 		(NULL == CU_add_test(pSuite, "test1 string encryption",
-							 test_encrypt_string1))
+							 test_encrypt_string1)) ||
+		(NULL == CU_add_test(pSuite, "test1 parallel string encryption",
+							 test_encrypt_string_parallel1)) ||
+		(NULL == CU_add_test(pSuite, "test1 chunked string encryption",
+							 test_encrypt_string_chunked1)) ||
+		(NULL == CU_add_test(pSuite, "test1 string encryption into buffer",
+							 test_encrypt_string_into1)) ||
+		(NULL == CU_add_test(pSuite, "test1 ternary string encryption",
+							 test_encrypt_string_tern1)) ||
+		(NULL == CU_add_test(pSuite, "test1 packed string encryption",
+							 test_encrypt_string_packed1)) ||
+		(NULL == CU_add_test(pSuite, "test1 rounded string encryption",
+							 test_encrypt_string_rounded1)) ||
+		(NULL == CU_add_test(pSuite, "test1 compressed string encryption",
+							 test_encrypt_string_compressed1)) ||
+		(NULL == CU_add_test(pSuite, "test1 dictionary string encryption",
+							 test_encrypt_string_dict1))
 		) {
 
 		CU_cleanup_registry();
@@ -178,7 +403,44 @@ int main(void)
 	/* add the tests to the suite */
 	if (
 		(NULL == CU_add_test(pSuite, "test1 string decryption",
-							 test_decrypt_string1))
+							 test_decrypt_string1)) ||
+		(NULL == CU_add_test(pSuite, "test2 string decryption",
+							 test_decrypt_string2)) ||
+		(NULL == CU_add_test(pSuite, "test3 string decryption",
+							 test_decrypt_string3)) ||
+		(NULL == CU_add_test(pSuite, "test4 string decryption",
+							 test_decrypt_string4)) ||
+		(NULL == CU_add_test(pSuite, "test5 string decryption",
+							 test_decrypt_string5)) ||
+		(NULL == CU_add_test(pSuite, "test6 string decryption",
+							 test_decrypt_string6)) ||
+		(NULL == CU_add_test(pSuite, "test1 string decryption into buffer",
+							 test_decrypt_string_into1)) ||
+		(NULL == CU_add_test(pSuite, "test2 string decryption into buffer",
+							 test_decrypt_string_into2))
+		) {
+
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add a suite to the registry */
+	pSuite = CU_add_suite("stream tests",
+		init_suite,
+		clean_suite);
+	if (NULL == pSuite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* add the tests to the suite */
+	if (
+		(NULL == CU_add_test(pSuite, "test1 stream encryption",
+							 test_stream1)) ||
+		(NULL == CU_add_test(pSuite, "test2 stream encryption",
+							 test_stream2)) ||
+		(NULL == CU_add_test(pSuite, "test3 stream encryption",
+							 test_stream3))
 		) {
 
 		CU_cleanup_registry();
@@ -48,6 +48,8 @@ void test_poly_new2(void);
  */
 void test_create_keypair1(void);
 void test_create_keypair2(void);
+void test_generate_keypair1(void);
+void test_generate_keypair2(void);
 void test_export_public_key1(void);
 void test_export_public_key2(void);
 void test_export_private_key1(void);
@@ -57,12 +59,96 @@ void test_import_public_key2(void);
 void test_import_private_key1(void);
 void test_import_private_key2(void);
 
+/*
+ * keypool
+ */
+void test_keypool_take1(void);
+void test_keypool_take2(void);
+void test_keypool_take3(void);
+
+/*
+ * seed keys
+ */
+void test_seed_key_expand1(void);
+void test_seed_key_export1(void);
+void test_seed_cache1(void);
+
+/*
+ * binary key files
+ */
+void test_keyfile_public1(void);
+void test_keyfile_private1(void);
+void test_key_view1(void);
+
+/*
+ * keyrings
+ */
+void test_keyring_add1(void);
+void test_keyring_add2(void);
+void test_keyring_add3(void);
+void test_keyring_compact1(void);
+
+/*
+ * key cache
+ */
+void test_key_cache_public1(void);
+void test_key_cache_private1(void);
+
+/*
+ * thread pool
+ */
+void test_thread_pool_parallel_for1(void);
+
+/*
+ * key loader
+ */
+void test_key_loader1(void);
+
+/*
+ * key stores
+ */
+void test_keystore_file1(void);
+void test_keystore_shm1(void);
+void test_keystore_crypt1(void);
+
+/*
+ * random numbers
+ */
+void test_rnd_bytes1(void);
+void test_rnd_fork1(void);
+void test_rng_fork1(void);
+void test_rnd_tern_poly1(void);
+void test_rnd_tern_poly_batch1(void);
+void test_rng_seeded1(void);
+
 /*
  * encryption
  */
 void test_encrypt_string1(void);
+void test_encrypt_string_parallel1(void);
+void test_encrypt_string_chunked1(void);
+void test_encrypt_string_into1(void);
+void test_encrypt_string_tern1(void);
+void test_encrypt_string_packed1(void);
+void test_encrypt_string_rounded1(void);
+void test_encrypt_string_compressed1(void);
+void test_encrypt_string_dict1(void);
 
 /*
  * decryption
  */
 void test_decrypt_string1(void);
+void test_decrypt_string2(void);
+void test_decrypt_string3(void);
+void test_decrypt_string4(void);
+void test_decrypt_string5(void);
+void test_decrypt_string6(void);
+void test_decrypt_string_into1(void);
+void test_decrypt_string_into2(void);
+
+/*
+ * streaming
+ */
+void test_stream1(void);
+void test_stream2(void);
+void test_stream3(void);
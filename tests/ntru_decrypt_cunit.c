@@ -27,17 +27,63 @@
 
 #include "ntru.h"
 #include "ntru_decrypt.h"
+#include "ntru_encrypt.h"
 #include "ntru_keypair.h"
+#include "ntru_rnd.h"
 
 #include <CUnit/Basic.h>
 #include <CUnit/Console.h>
 #include <CUnit/Automated.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 
+/**
+ * Encrypts the bytes of a frame as they are, with r = 0, so
+ * that the ciphertext is just the message. This gets frames
+ * to the decoder that the encryption functions never create.
+ *
+ * @param frame the bytes of the frame
+ * @param len the number of bytes
+ * @param params the NTRU context, q at most 256
+ * @return the base64 ciphertext, newly allocated
+ */
+static string *
+encrypt_raw_frame(const uint8_t *frame,
+		size_t len,
+		const ntru_params *params)
+{
+	const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t bits = len * 8,
+		   raw_len = (bits + params->N - 1) / params->N * params->N;
+	uint8_t *raw = calloc(raw_len + 2, 1);
+	string *enc = malloc(sizeof(*enc));
+
+	/* bit 1 is coefficient 1, bit 0 is -1, padding is 0 */
+	for (size_t i = 0; i < bits; i++)
+		raw[i] = ((frame[i / 8] >> (7 - i % 8)) & 1) ? 1 : params->q - 1;
+
+	enc->ptr = malloc((raw_len + 2) / 3 * 4);
+	enc->len = 0;
+	for (size_t i = 0; i < raw_len; i += 3) {
+		uint32_t v = raw[i] << 16 | raw[i + 1] << 8 | raw[i + 2];
+
+		enc->ptr[enc->len++] = alphabet[v >> 18];
+		enc->ptr[enc->len++] = alphabet[(v >> 12) & 63];
+		enc->ptr[enc->len++] = i + 1 < raw_len ? alphabet[(v >> 6) & 63] : '=';
+		enc->ptr[enc->len++] = i + 2 < raw_len ? alphabet[v & 63] : '=';
+	}
+
+	free(raw);
+
+	return enc;
+}
+
 /**
  * Test decrypting an encrypted string.
  */
@@ -74,3 +120,323 @@ void test_decrypt_string1(void)
 
 	CU_ASSERT_EQUAL(strcmp(dec_c_str, "BLAHFASEL\n"), 0);
 }
+
+/**
+ * Test decrypting a string that is no valid base64.
+ */
+void test_decrypt_string2(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+	string *enc_string;
+	char dec_c[64];
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+
+	enc_string = read_file("to-decrypt.txt");
+	enc_string->ptr[enc_string->len / 2] = '*';
+
+	CU_ASSERT_PTR_NULL(ntru_decrypt_string(enc_string, pair.priv,
+				pair.priv_inv, &params));
+	CU_ASSERT_EQUAL(0, ntru_decrypt_string_into(enc_string, pair.priv,
+				pair.priv_inv, &params, dec_c, sizeof(dec_c)));
+
+	string_delete(enc_string);
+	ntru_delete_keypair(&pair);
+	poly_delete_all(f, g, NULL);
+}
+
+/**
+ * Test decrypting a ciphertext of the old format without
+ * length prefix.
+ */
+void test_decrypt_string3(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+	char enc_c_str[] = "EAobFg4PHQYZBhEOChkYDg8fBhkGEw4KGRgOD"
+		"x0GGQYREAoZGA4PHQYbBBEODBsWDhEdBhkEER"
+		"AKGxYQDx0IGwQTDgoZGA4RHQgZBBMQChkWDg8"
+		"dCBkGEQ==";
+	string enc_string = { enc_c_str, sizeof(enc_c_str) - 1 };
+	string *dec_string;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+
+	/* the framed default rejects it */
+	CU_ASSERT_PTR_NULL(ntru_decrypt_string(&enc_string, pair.priv,
+				pair.priv_inv, &params));
+
+	dec_string = ntru_decrypt_string_encoded(&enc_string, pair.priv,
+			pair.priv_inv, &params, NTRU_MSG_BINARY_UNFRAMED);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec_string);
+	CU_ASSERT_EQUAL(dec_string->len, 10);
+	CU_ASSERT_EQUAL(memcmp(dec_string->ptr, "BLAHFASEL\n", 10), 0);
+	string_delete(dec_string);
+}
+
+/**
+ * Test decrypting a message that compresses far better
+ * than 3:1.
+ */
+void test_decrypt_string4(void)
+{
+	keypair pair;
+	fmpz_poly_t rnd;
+	ntru_params params;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"ratio", 5);
+	char msg_c[16384];
+	string msg,
+		   *enc_string,
+		   *dec_string;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, 35, 35, rng);
+
+	memset(msg_c, 'x', sizeof(msg_c));
+	msg.ptr = msg_c;
+	msg.len = sizeof(msg_c);
+
+	enc_string = ntru_encrypt_string(&msg, pair.pub, rnd, &params);
+	dec_string = ntru_decrypt_string(enc_string, pair.priv,
+			pair.priv_inv, &params);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec_string);
+	CU_ASSERT_EQUAL(msg.len, dec_string->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg_c, dec_string->ptr, msg.len));
+
+	string_delete(enc_string);
+	string_delete(dec_string);
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test decrypting into a caller-provided buffer, also
+ * a message that needs many blocks.
+ */
+void test_decrypt_string_into1(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g, rnd;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"into", 4);
+	string *enc_string,
+		   msg,
+		   enc;
+	char msg_c[4096],
+		 dec_c[4096];
+	size_t len;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+
+	enc_string = read_file("to-decrypt.txt");
+	CU_ASSERT(ntru_decrypt_bound(enc_string->len, &params) >= 10);
+	len = ntru_decrypt_string_into(enc_string, pair.priv, pair.priv_inv,
+			&params, dec_c, sizeof(dec_c));
+	CU_ASSERT_EQUAL(10, len);
+	CU_ASSERT_EQUAL(0, memcmp(dec_c, "BLAHFASEL\n", 10));
+
+	/* too small */
+	CU_ASSERT_EQUAL(0, ntru_decrypt_string_into(enc_string, pair.priv,
+				pair.priv_inv, &params, dec_c, 9));
+	string_delete(enc_string);
+	ntru_delete_keypair(&pair);
+
+	/* N = 11 fails to decrypt long messages too often */
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, 35, 35, rng);
+
+	msg.len = 0;
+	for (uint32_t i = 0; msg.len < sizeof(msg_c) - 32; i++)
+		msg.len += sprintf(msg_c + msg.len, "%u cubed is %u\n",
+				i, i * i * i);
+	msg.ptr = msg_c;
+
+	len = ntru_encrypt_bound(msg.len, &params);
+	enc.ptr = malloc(len);
+	enc.len = ntru_encrypt_string_into(&msg, pair.pub, rnd, &params,
+			enc.ptr, len);
+	CU_ASSERT(enc.len > 0);
+	len = ntru_decrypt_string_into(&enc, pair.priv, pair.priv_inv,
+			&params, dec_c, sizeof(dec_c));
+	CU_ASSERT_EQUAL(msg.len, len);
+	CU_ASSERT_EQUAL(0, memcmp(msg_c, dec_c, msg.len));
+
+	free(enc.ptr);
+	ntru_delete_keypair(&pair);
+	ntru_rng_delete(rng);
+	poly_delete_all(f, g, rnd, NULL);
+}
+
+/**
+ * Test decrypting into a buffer a message whose scratch
+ * space is too large to be kept, then a short one.
+ */
+void test_decrypt_string_into2(void)
+{
+	keypair pair;
+	fmpz_poly_t rnd;
+	ntru_params params;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"into", 4);
+	string msg,
+		   enc;
+	char *dec_c;
+	size_t lens[] = { 192 * 1024, 10 },
+		   len;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, 35, 35, rng);
+
+	for (uint32_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+		/* random bytes do not compress */
+		msg.len = lens[i];
+		msg.ptr = malloc(msg.len);
+		ntru_rng_bytes(rng, msg.ptr, msg.len);
+
+		len = ntru_encrypt_bound(msg.len, &params);
+		enc.ptr = malloc(len);
+		enc.len = ntru_encrypt_string_into(&msg, pair.pub, rnd, &params,
+				enc.ptr, len);
+		CU_ASSERT(enc.len > 0);
+
+		dec_c = malloc(msg.len);
+		len = ntru_decrypt_string_into(&enc, pair.priv, pair.priv_inv,
+				&params, dec_c, msg.len);
+		CU_ASSERT_EQUAL(msg.len, len);
+		CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec_c, msg.len));
+
+		free(dec_c);
+		free(enc.ptr);
+		free(msg.ptr);
+	}
+
+	ntru_delete_keypair(&pair);
+	ntru_rng_delete(rng);
+	fmpz_poly_clear(rnd);
+}
+
+/**
+ * Test that a frame whose chunks claim more bytes than
+ * chunks can hold is rejected instead of allocated.
+ */
+void test_decrypt_string5(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+	const uint8_t hello[] = { 0, 5, 'h', 'e', 'l', 'l', 'o' },
+		  huge_chunk[] = { 1, 0x80, 0x80, 0x80, 0xf0, 0x07, 0 };
+	uint8_t frame[5 + 200 * sizeof(huge_chunk)] = { 0, 0, 0, 200, 1 };
+	string *enc,
+		   *dec;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+
+	/* a valid frame gets through this way */
+	enc = encrypt_raw_frame(hello, sizeof(hello), &params);
+	dec = ntru_decrypt_string(enc, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(5, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(dec->ptr, "hello", 5));
+	string_delete(dec);
+	string_delete(enc);
+
+	/* 200 chunks of one payload byte, each claiming almost 2 GB */
+	for (uint32_t i = 0; i < 200; i++)
+		memcpy(frame + 5 + i * sizeof(huge_chunk), huge_chunk,
+				sizeof(huge_chunk));
+	enc = encrypt_raw_frame(frame, sizeof(frame), &params);
+	CU_ASSERT_PTR_NULL(ntru_decrypt_string(enc, pair.priv, pair.priv_inv,
+				&params));
+	string_delete(enc);
+
+	ntru_delete_keypair(&pair);
+	poly_delete_all(f, g, NULL);
+}
+
+/**
+ * Test that a frame claiming more bytes than its payload
+ * can expand to is rejected instead of allocated.
+ */
+void test_decrypt_string6(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+	/* one payload byte claiming almost 2 GB */
+	const uint8_t frame[] = { 1, 0x80, 0x80, 0x80, 0xf0, 0x07, 0 };
+	string *enc;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+
+	enc = encrypt_raw_frame(frame, sizeof(frame), &params);
+	CU_ASSERT_PTR_NULL(ntru_decrypt_string(enc, pair.priv, pair.priv_inv,
+				&params));
+	string_delete(enc);
+
+	ntru_delete_keypair(&pair);
+	poly_delete_all(f, g, NULL);
+}
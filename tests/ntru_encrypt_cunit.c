@@ -26,8 +26,12 @@
  */
 
 #include "ntru.h"
+#include "ntru_compress.h"
 #include "ntru_encrypt.h"
+#include "ntru_decrypt.h"
 #include "ntru_keypair.h"
+#include "ntru_rnd.h"
+#include "ntru_threadpool.h"
 
 #include <CUnit/Basic.h>
 #include <CUnit/Console.h>
@@ -35,6 +39,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 
@@ -73,8 +78,531 @@ void test_encrypt_string1(void)
 	string_delete(enc_string);
 
 	CU_ASSERT_EQUAL(strcmp(enc_c_str,
-				"EAobFg4PHQYZBhEOChkYDg8fBhkGEw4KGRgOD"
-				"x0GGQYREAoZGA4PHQYbBBEODBsWDhEdBhkEER"
-				"AKGxYQDx0IGwQTDgoZGA4RHQgZBBMQChkWDg8"
-				"dCBkGEQ=="), 0);
+				"DgoZFhAPHwgZBBEODBkYDhEdCBkEEQ4KGRgOD"
+				"x0GGwQREAoZGBAPHQYbBBEOChkYDhEdBhsEEQ"
+				"4KGxYODx8IGQQTDgoZFg4RHQgZBhEODBsWEA8"
+				"dBhsEEw4MGRYQER0GGQQRDgwZGA4QHgcaBRI="), 0);
+}
+
+/**
+ * Test encrypting a multi-block string with a fresh
+ * random poly per block, in parallel.
+ */
+void test_encrypt_string_parallel1(void)
+{
+	keypair pair;
+	ntru_params params;
+	ntru_thread_pool *pool = ntru_thread_pool_new(4);
+	ntru_rng *rng1 = ntru_rng_new_seeded((const uint8_t *)"enc", 3),
+			 *rng2 = ntru_rng_new_seeded((const uint8_t *)"enc", 3),
+			 *rng_key;
+	char msg_c[2048];
+	string msg,
+		   *enc1,
+		   *enc2,
+		   *enc3,
+		   *dec;
+
+	/* N = 11 fails to decrypt too often with random blinding */
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	rng_key = ntru_rng_new_seeded((const uint8_t *)"key", 3);
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1,
+				rng_key));
+	ntru_rng_delete(rng_key);
+
+	msg.len = 0;
+	for (uint32_t i = 0; msg.len < sizeof(msg_c) - 32; i++)
+		msg.len += sprintf(msg_c + msg.len, "%u squared is %u\n",
+				i, i * i);
+	msg.ptr = msg_c;
+
+	/* same seed, with and without pool: same ciphertext */
+	enc1 = ntru_encrypt_string_parallel(&msg, pair.pub, &params,
+			rng1, pool);
+	enc2 = ntru_encrypt_string_parallel(&msg, pair.pub, &params,
+			rng2, NULL);
+	CU_ASSERT_EQUAL(enc1->len, enc2->len);
+	CU_ASSERT_EQUAL(0, memcmp(enc1->ptr, enc2->ptr, enc1->len));
+
+	/* the process-wide DRBG gives a different ciphertext */
+	enc3 = ntru_encrypt_string_parallel(&msg, pair.pub, &params,
+			NULL, pool);
+	CU_ASSERT_NOT_EQUAL(0, memcmp(enc1->ptr, enc3->ptr, enc1->len));
+
+	dec = ntru_decrypt_string(enc1, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	dec = ntru_decrypt_string_parallel(enc3, pair.priv, pair.priv_inv,
+			&params, pool);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	string_delete(enc1);
+	string_delete(enc2);
+	string_delete(enc3);
+	ntru_rng_delete(rng1);
+	ntru_rng_delete(rng2);
+	ntru_thread_pool_delete(pool);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test encrypting a message large enough to be compressed
+ * in parallel chunks, which must decrypt and be deterministic.
+ */
+void test_encrypt_string_chunked1(void)
+{
+	keypair pair;
+	ntru_params params;
+	ntru_thread_pool *pool = ntru_thread_pool_new(4);
+	ntru_rng *rng1 = ntru_rng_new_seeded((const uint8_t *)"chunk", 5),
+			 *rng2 = ntru_rng_new_seeded((const uint8_t *)"chunk", 5),
+			 *rng_key;
+	const size_t msg_max = 3 * 512 * 1024;
+	string msg,
+		   *enc1,
+		   *enc2,
+		   *dec;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	rng_key = ntru_rng_new_seeded((const uint8_t *)"key", 3);
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1,
+				rng_key));
+	ntru_rng_delete(rng_key);
+
+	/* large enough to be split into several chunks */
+	msg.ptr = malloc(msg_max);
+	msg.len = 0;
+	for (uint32_t i = 0; msg.len < msg_max - 64; i++)
+		msg.len += sprintf(msg.ptr + msg.len, "line %u of a large message\n",
+				i);
+
+	/* the chunks do not depend on the pool */
+	enc1 = ntru_encrypt_string_parallel(&msg, pair.pub, &params,
+			rng1, pool);
+	enc2 = ntru_encrypt_string_parallel(&msg, pair.pub, &params,
+			rng2, NULL);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(enc1);
+	CU_ASSERT_EQUAL(enc1->len, enc2->len);
+	CU_ASSERT_EQUAL(0, memcmp(enc1->ptr, enc2->ptr, enc1->len));
+
+	dec = ntru_decrypt_string_parallel(enc1, pair.priv, pair.priv_inv,
+			&params, pool);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	dec = ntru_decrypt_string(enc2, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	string_delete(enc1);
+	string_delete(enc2);
+	free(msg.ptr);
+	ntru_rng_delete(rng1);
+	ntru_rng_delete(rng2);
+	ntru_thread_pool_delete(pool);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test encrypting a string into a caller-provided buffer,
+ * which must give the same as ntru_encrypt_string().
+ */
+void test_encrypt_string_into1(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g, rnd;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	int rnd_c[] = {-1, 0, 1, 1, 1, -1, 0, -1, 0, 0, 0};
+	ntru_params params;
+	string *enc_string,
+		   *clear_string;
+	char buf[1024];
+	size_t bound,
+		   len;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+	poly_new(rnd, rnd_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+
+	clear_string = read_file("to-encrypt.txt");
+	bound = ntru_encrypt_bound(clear_string->len, &params);
+
+	enc_string = ntru_encrypt_string(clear_string, pair.pub,
+			rnd, &params);
+	len = ntru_encrypt_string_into(clear_string, pair.pub, rnd, &params,
+			buf, sizeof(buf));
+
+	CU_ASSERT_EQUAL(enc_string->len, len);
+	CU_ASSERT_EQUAL(0, memcmp(enc_string->ptr, buf, len));
+	CU_ASSERT(len <= bound);
+
+	/* too small */
+	CU_ASSERT_EQUAL(0, ntru_encrypt_string_into(clear_string, pair.pub,
+				rnd, &params, buf, len - 1));
+
+	string_delete(enc_string);
+	string_delete(clear_string);
+	ntru_delete_keypair(&pair);
+	poly_delete_all(f, g, rnd, NULL);
+}
+
+/**
+ * Test encrypting a string with the ternary message
+ * encoding, which needs fewer blocks than the binary one.
+ */
+void test_encrypt_string_tern1(void)
+{
+	keypair pair;
+	ntru_params params;
+	fmpz_poly_t rnd;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"tern", 4);
+	char msg_c[2048];
+	string msg,
+		   *enc_bin,
+		   *enc_tern,
+		   *dec;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, params.N / 3,
+			params.N / 3, rng);
+
+	msg.len = 0;
+	for (uint32_t i = 0; msg.len < sizeof(msg_c) - 32; i++)
+		msg.len += sprintf(msg_c + msg.len, "%u cubed is %u\n",
+				i, i * i * i);
+	msg.ptr = msg_c;
+
+	enc_bin = ntru_encrypt_string_encoded(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_BINARY);
+	enc_tern = ntru_encrypt_string_encoded(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_TERNARY);
+	CU_ASSERT(enc_tern->len < enc_bin->len / 3 * 2);
+
+	dec = ntru_decrypt_string_encoded(enc_tern, pair.priv, pair.priv_inv,
+			&params, NTRU_MSG_TERNARY);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	/* binary is the default format */
+	dec = ntru_decrypt_string(enc_bin, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	/* a trit needs p = 3 */
+	params.p = 5;
+	CU_ASSERT_PTR_NULL(ntru_encrypt_string_encoded(&msg, pair.pub, rnd,
+				&params, NTRU_MSG_TERNARY));
+
+	string_delete(enc_bin);
+	string_delete(enc_tern);
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test encrypting a string into the packed format, which
+ * also works for q > 256.
+ */
+void test_encrypt_string_packed1(void)
+{
+	keypair pair;
+	ntru_params params;
+	fmpz_poly_t rnd;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"packed", 6);
+	char msg_c[1024];
+	string msg,
+		   *enc,
+		   *dec;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 2048;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, params.N / 3,
+			params.N / 3, rng);
+
+	msg.len = 0;
+	for (uint32_t i = 0; msg.len < sizeof(msg_c) - 32; i++)
+		msg.len += sprintf(msg_c + msg.len, "%u, ", i * 2654435761U);
+	msg.ptr = msg_c;
+
+	/* 32 byte header and 11 bits per coefficient */
+	enc = ntru_encrypt_string_packed(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_TERNARY);
+	CU_ASSERT_EQUAL(0, (enc->len - 32) * 8 / 11 % params.N);
+	CU_ASSERT_EQUAL(0, enc->ptr[0]);
+
+	dec = ntru_decrypt_string(enc, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	/* a different parameter set is rejected */
+	params.q = 256;
+	CU_ASSERT_PTR_NULL(ntru_decrypt_string(enc, pair.priv, pair.priv_inv,
+				&params));
+
+	string_delete(enc);
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test encrypting a string with rounded coefficients.
+ */
+void test_encrypt_string_rounded1(void)
+{
+	keypair pair;
+	ntru_params params;
+	fmpz_poly_t rnd;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"rounded", 7);
+	char msg_c[1024];
+	uint32_t keep_bits;
+	size_t blocks;
+	string msg,
+		   *enc,
+		   *dec;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 2048;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, params.N / 3,
+			params.N / 3, rng);
+
+	msg.len = 0;
+	for (uint32_t i = 0; msg.len < sizeof(msg_c) - 32; i++)
+		msg.len += sprintf(msg_c + msg.len, "%u, ", i * 2654435761U);
+	msg.ptr = msg_c;
+
+	/* fewer bits mean more failures */
+	keep_bits = ntru_rounding_keep_bits(&params, 1e-9);
+	CU_ASSERT(keep_bits > 1 && keep_bits < 10);
+	CU_ASSERT(ntru_rounding_failure_rate(&params, keep_bits) <= 1e-9);
+	CU_ASSERT(ntru_rounding_failure_rate(&params, keep_bits - 1) > 1e-9);
+	CU_ASSERT(ntru_rounding_failure_rate(&params, 10) <
+			ntru_rounding_failure_rate(&params, keep_bits));
+
+	/* 683 quotients fit into 10 bits */
+	CU_ASSERT_PTR_NULL(ntru_encrypt_string_rounded(&msg, pair.pub, rnd,
+				&params, NTRU_MSG_BINARY, 11));
+
+	/* the same blocks as the lossless format, with fewer bits */
+	enc = ntru_encrypt_string_packed(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_BINARY);
+	blocks = (enc->len - 32) * 8 / 11 / params.N;
+	string_delete(enc);
+
+	enc = ntru_encrypt_string_rounded(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_BINARY, keep_bits);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(enc);
+	/* 2 bits for the residue mod 3 */
+	CU_ASSERT_EQUAL(enc->len,
+			32 + (blocks * params.N * (2 + keep_bits) + 7) / 8);
+
+	dec = ntru_decrypt_string(enc, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+
+	string_delete(enc);
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test encrypting strings with the different
+ * compression policies.
+ */
+void test_encrypt_string_compressed1(void)
+{
+	keypair pair;
+	ntru_params params;
+	fmpz_poly_t rnd;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"policy", 6);
+	ntru_compress_policy none = { NTRU_COMPRESS_NONE, 0, 0 },
+						 fast = { NTRU_COMPRESS_FAST, 8, 0 },
+						 hc = { NTRU_COMPRESS_HC, 12, 0 },
+						 automatic = { NTRU_COMPRESS_AUTO, 1, 0 };
+	const ntru_compress_policy *policies[] = { &none, &fast, &hc,
+		&automatic };
+	char msg_c[2048];
+	size_t lens[4];
+	string msg,
+		   *enc,
+		   *dec;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, 35, 35, rng);
+	msg.ptr = msg_c;
+
+	/* redundant text first, then random bytes */
+	for (uint32_t round = 0; round < 2; round++) {
+		if (round) {
+			ntru_rng_bytes(rng, msg_c, sizeof(msg_c));
+			msg.len = sizeof(msg_c);
+		} else {
+			msg.len = 0;
+			for (uint32_t i = 0; msg.len < sizeof(msg_c) - 32; i++)
+				msg.len += sprintf(msg_c + msg.len, "%u squared is %u\n",
+						i, i * i);
+		}
+
+		for (uint32_t i = 0; i < 4; i++) {
+			enc = ntru_encrypt_string_compressed(&msg, pair.pub, rnd,
+					&params, NTRU_MSG_BINARY, policies[i]);
+			dec = ntru_decrypt_string(enc, pair.priv, pair.priv_inv,
+					&params);
+			CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+			CU_ASSERT_EQUAL(msg.len, dec->len);
+			CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+			lens[i] = enc->len;
+			string_delete(dec);
+			string_delete(enc);
+		}
+
+		if (round) {
+			/* auto does not compress random bytes */
+			CU_ASSERT_EQUAL(lens[0], lens[3]);
+		} else {
+			CU_ASSERT(lens[2] <= lens[1]);
+			CU_ASSERT(lens[1] < lens[0]);
+			CU_ASSERT(lens[3] < lens[0]);
+		}
+	}
+
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test encrypting a short string compressed with a preshared
+ * dictionary, which must be smaller than without one.
+ */
+void test_encrypt_string_dict1(void)
+{
+	keypair pair;
+	ntru_params params;
+	fmpz_poly_t rnd;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"dict", 4);
+	ntru_compress_policy plain = { NTRU_COMPRESS_FAST, 1, 0 },
+						 dict = { NTRU_COMPRESS_FAST, 1, 42 },
+						 hc_dict = { NTRU_COMPRESS_HC, 9, 42 },
+						 unknown = { NTRU_COMPRESS_FAST, 1, 43 };
+	const char *records = "{\"user\": \"alice\", \"status\": \"active\", "
+		"\"role\": \"admin\", \"created\": \"2014-06-01T12:00:00Z\"}\n"
+		"{\"user\": \"bob\", \"status\": \"inactive\", "
+		"\"role\": \"user\", \"created\": \"2014-06-02T08:30:00Z\"}\n";
+	char msg_c[] = "{\"user\": \"carol\", \"status\": \"active\", "
+		"\"role\": \"user\", \"created\": \"2014-06-03T17:45:00Z\"}";
+	string msg,
+		   *enc,
+		   *enc_dict,
+		   *enc_hc_dict,
+		   *dec;
+
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1, rng));
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, 35, 35, rng);
+	msg.ptr = msg_c;
+	msg.len = strlen(msg_c);
+
+	CU_ASSERT_EQUAL(false, ntru_compress_dict_add(0, records,
+				strlen(records)));
+	CU_ASSERT_EQUAL(true, ntru_compress_dict_add(42, records,
+				strlen(records)));
+	CU_ASSERT_EQUAL(true, ntru_compress_dict_add(42, records,
+				strlen(records)));
+	CU_ASSERT_EQUAL(false, ntru_compress_dict_add(42, msg_c, msg.len));
+
+	enc = ntru_encrypt_string_compressed(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_BINARY, &plain);
+	enc_dict = ntru_encrypt_string_compressed(&msg, pair.pub, rnd, &params,
+			NTRU_MSG_BINARY, &dict);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(enc_dict);
+	CU_ASSERT(enc_dict->len < enc->len);
+
+	/* the HC level is no acceleration factor */
+	enc_hc_dict = ntru_encrypt_string_compressed(&msg, pair.pub, rnd,
+			&params, NTRU_MSG_BINARY, &hc_dict);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(enc_hc_dict);
+	CU_ASSERT_EQUAL(enc_dict->len, enc_hc_dict->len);
+	CU_ASSERT_EQUAL(0, memcmp(enc_dict->ptr, enc_hc_dict->ptr,
+				enc_dict->len));
+	string_delete(enc_hc_dict);
+
+	dec = ntru_decrypt_string(enc_dict, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+	string_delete(enc_dict);
+	string_delete(enc);
+
+	/* the default policy is used by ntru_encrypt_string() */
+	CU_ASSERT_EQUAL(false, ntru_set_compress_policy(&unknown));
+	CU_ASSERT_EQUAL(true, ntru_set_compress_policy(&dict));
+	enc = ntru_encrypt_string(&msg, pair.pub, rnd, &params);
+	CU_ASSERT_EQUAL(true, ntru_set_compress_policy(NULL));
+	dec = ntru_decrypt_string(enc, pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+	string_delete(enc);
+
+	CU_ASSERT_PTR_NULL(ntru_encrypt_string_compressed(&msg, pair.pub, rnd,
+				&params, NTRU_MSG_BINARY, &unknown));
+
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
 }
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keycache_cunit.c
+ * Test cases for the cache of imported keys.
+ * @brief tests for ntru_keycache.c
+ */
+
+#include "ntru.h"
+#include "ntru_keycache.h"
+#include "ntru_keyfile.h"
+#include "ntru_keypair.h"
+#include "ntru_rnd.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/**
+ * Test that a cached public key is served until
+ * the key file is replaced.
+ */
+void test_key_cache_public1(void)
+{
+	ntru_key_cache *cache;
+	ntru_cache_stats stats;
+	keypair pair1,
+			pair2;
+	fmpz_poly_t pub;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(pub);
+
+	ntru_generate_keypair(&pair1, &params, 1, NULL);
+	ntru_generate_keypair(&pair2, &params, 1, NULL);
+	export_public_key("pub.key", pair1.pub, &params);
+
+	cache = ntru_key_cache_new(1 << 20);
+
+	CU_ASSERT_EQUAL(true, ntru_key_cache_get_public_key(cache, pub,
+				"pub.key", &params));
+	CU_ASSERT_EQUAL(true, ntru_key_cache_get_public_key(cache, pub,
+				"pub.key", &params));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair1.pub));
+
+	/* a new inode invalidates the entry */
+	export_public_key("pub2.key", pair2.pub, &params);
+	rename("pub2.key", "pub.key");
+	CU_ASSERT_EQUAL(true, ntru_key_cache_get_public_key(cache, pub,
+				"pub.key", &params));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair2.pub));
+	CU_ASSERT_EQUAL(false, ntru_key_cache_get_public_key(cache, pub,
+				"foo", &params));
+
+	ntru_key_cache_get_stats(cache, &stats);
+	CU_ASSERT_EQUAL(stats.hits, 1);
+	CU_ASSERT_EQUAL(stats.misses, 2);
+	CU_ASSERT_EQUAL(stats.entries, 1);
+
+	remove("pub.key");
+	ntru_key_cache_delete(cache);
+	ntru_delete_keypair(&pair1);
+	ntru_delete_keypair(&pair2);
+}
+
+/**
+ * Test that private keys from binary and base64
+ * files are cached together with their inverse.
+ */
+void test_key_cache_private1(void)
+{
+	ntru_key_cache *cache;
+	ntru_cache_stats stats;
+	keypair pair;
+	fmpz_poly_t priv, priv_inv, priv_b64, priv_inv_b64;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+	fmpz_poly_init(priv_b64);
+	fmpz_poly_init(priv_inv_b64);
+
+	ntru_generate_keypair(&pair, &params, 1, NULL);
+	export_priv_key("priv.key", pair.priv, &params);
+	export_priv_key_bin("priv.bkey", &pair, &params);
+
+	cache = ntru_key_cache_new(1 << 20);
+
+	for (uint32_t i = 0; i < 2; i++) {
+		CU_ASSERT_EQUAL(true, ntru_key_cache_get_priv_key(cache,
+					priv_b64, priv_inv_b64, "priv.key", &params));
+		CU_ASSERT_EQUAL(true, ntru_key_cache_get_priv_key(cache,
+					priv, priv_inv, "priv.bkey", &params));
+	}
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv, priv_b64));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv_inv, priv_inv_b64));
+
+	ntru_key_cache_get_stats(cache, &stats);
+	CU_ASSERT_EQUAL(stats.hits, 2);
+	CU_ASSERT_EQUAL(stats.misses, 2);
+	CU_ASSERT(stats.cost > 0);
+
+	remove("priv.key");
+	remove("priv.bkey");
+	ntru_key_cache_delete(cache);
+	ntru_delete_keypair(&pair);
+}
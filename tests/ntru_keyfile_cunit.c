@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyfile_cunit.c
+ * Test cases for the binary key file format.
+ * @brief tests for ntru_keyfile.c
+ */
+
+#include "ntru.h"
+#include "ntru_keyfile.h"
+#include "ntru_keypair.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/**
+ * Test exporting and importing a public key
+ * in the binary format.
+ */
+void test_keyfile_public1(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g, pub;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params,
+				other_params;
+
+	fmpz_poly_init(pub);
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+	other_params = params;
+	other_params.q = 64;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+	CU_ASSERT_EQUAL(true, export_public_key_bin("pub.bkey", pair.pub,
+				&params));
+	CU_ASSERT_EQUAL(true, import_public_key_bin(pub, "pub.bkey",
+				&params));
+	CU_ASSERT_EQUAL(false, import_public_key_bin(pub, "pub.bkey",
+				&other_params));
+	CU_ASSERT_EQUAL(false, import_public_key_bin(pub, "to-encrypt.txt",
+				&params));
+
+	remove("pub.bkey");
+
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair.pub));
+}
+
+/**
+ * Test that the binary private key file yields the same
+ * keys as the base64 one, including the inverse.
+ */
+void test_keyfile_private1(void)
+{
+	keypair pair;
+	fmpz_poly_t f, g, priv, priv_inv, priv_b64, priv_inv_b64;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+	fmpz_poly_init(priv_b64);
+	fmpz_poly_init(priv_inv_b64);
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+	export_priv_key("priv.key", pair.priv, &params);
+	import_priv_key(priv_b64, priv_inv_b64, "priv.key", &params);
+
+	CU_ASSERT_EQUAL(true, export_priv_key_bin("priv.bkey", &pair,
+				&params));
+	CU_ASSERT_EQUAL(true, import_priv_key_bin(priv, priv_inv, "priv.bkey",
+				&params));
+	/* public key files carry no private key */
+	export_public_key_bin("pub.bkey", pair.pub, &params);
+	CU_ASSERT_EQUAL(false, import_priv_key_bin(priv_b64, priv_inv_b64,
+				"pub.bkey", &params));
+
+	remove("priv.key");
+	remove("priv.bkey");
+	remove("pub.bkey");
+
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv, priv_b64));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv_inv, priv_inv_b64));
+}
+
+/**
+ * Test the mapped view of a binary private key file.
+ */
+void test_key_view1(void)
+{
+	keypair pair;
+	ntru_key_view view;
+	fmpz_poly_t f, g, pub;
+	int f_c[] = { -1, 1, 1, 0, -1, 0, 1, 0, 0, 1, -1 };
+	int g_c[] = { -1, 0, 1, 1, 0, 1, 0, 0, -1, 0, -1 };
+	ntru_params params;
+
+	fmpz_poly_init(pub);
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	poly_new(f, f_c, 11);
+	poly_new(g, g_c, 11);
+
+	ntru_create_keypair(&pair, f, g, &params);
+	export_priv_key_bin("priv.bkey", &pair, &params);
+
+	CU_ASSERT_EQUAL(true, ntru_key_view_open(&view, "priv.bkey"));
+	CU_ASSERT_EQUAL(view.type, NTRU_KEY_PRIVATE);
+	CU_ASSERT_EQUAL(view.params.N, params.N);
+	CU_ASSERT_EQUAL(view.params.q, params.q);
+	CU_ASSERT_EQUAL(view.params.p, params.p);
+	CU_ASSERT_EQUAL(0, (uintptr_t)view.priv_inv % NTRU_KEYFILE_ALIGN);
+
+	ntru_key_view_get_poly(pub, view.pub, &view);
+	ntru_key_view_close(&view);
+
+	remove("priv.bkey");
+
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair.pub));
+	CU_ASSERT_EQUAL(false, ntru_key_view_open(&view, "to-encrypt.txt"));
+}
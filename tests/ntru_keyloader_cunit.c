@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyloader_cunit.c
+ * Test cases for bulk loading of private keys.
+ * @brief tests for ntru_keyloader.c
+ */
+
+#include "ntru.h"
+#include "ntru_keyfile.h"
+#include "ntru_keyloader.h"
+#include "ntru_keypair.h"
+#include "ntru_rnd.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+
+/**
+ * Test loading a directory of base64 and binary private
+ * keys, one of which is not invertible, and stray files.
+ */
+void test_key_loader1(void)
+{
+	ntru_key_loader *loader;
+	ntru_key_loader_stats stats;
+	keypair pair[4];
+	fmpz_poly_t f, priv, priv_inv;
+	int f_c[] = { 1, 1, 1 };
+	char filename[32];
+	FILE *file;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+
+	mkdir("keys", 0700);
+	for (uint32_t i = 0; i < 4; i++) {
+		ntru_generate_keypair(&pair[i], &params, 1, NULL);
+		sprintf(filename, "keys/%u.key", i);
+		if (i % 2)
+			export_priv_key_bin(filename, &pair[i], &params);
+		else
+			export_priv_key(filename, pair[i].priv, &params);
+	}
+	/* f(1) = 3, so f is not invertible mod 3 */
+	poly_new(f, f_c, 3);
+	export_priv_key("keys/broken.key", f, &params);
+	poly_delete(f);
+
+	/* decodes to nothing */
+	file = fopen("keys/empty.key", "w");
+	fputs("\n", file);
+	fclose(file);
+	/* decodes to 24 bytes, more than one poly */
+	file = fopen("keys/long.key", "w");
+	fputs("AQEBAQEBAQEBAQEBAQEBAQEBAQEBAQEB", file);
+	fclose(file);
+
+	loader = ntru_key_loader_new(&params, NULL);
+	CU_ASSERT_EQUAL(ntru_key_loader_add_dir(loader, "keys"), 7);
+	CU_ASSERT_EQUAL(false, ntru_key_loader_add_file(loader, "keys/0.key"));
+
+	for (uint32_t i = 0; i < 4; i++) {
+		sprintf(filename, "keys/%u.key", i);
+		CU_ASSERT_EQUAL(true, ntru_key_loader_get_priv_key(loader, priv,
+					priv_inv, filename, true));
+		CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv, pair[i].priv));
+	}
+	ntru_key_loader_wait(loader);
+	CU_ASSERT_EQUAL(false, ntru_key_loader_get_priv_key(loader, priv,
+				priv_inv, "keys/broken.key", true));
+	CU_ASSERT_EQUAL(false, ntru_key_loader_get_priv_key(loader, priv,
+				priv_inv, "keys/none.key", true));
+
+	ntru_key_loader_get_stats(loader, &stats);
+	CU_ASSERT_EQUAL(stats.loaded, 4);
+	CU_ASSERT_EQUAL(stats.failed, 3);
+	CU_ASSERT_EQUAL(stats.pending, 0);
+
+	ntru_key_loader_delete(loader);
+	for (uint32_t i = 0; i < 4; i++) {
+		sprintf(filename, "keys/%u.key", i);
+		remove(filename);
+		ntru_delete_keypair(&pair[i]);
+	}
+	remove("keys/broken.key");
+	remove("keys/empty.key");
+	remove("keys/long.key");
+	rmdir("keys");
+}
@@ -26,7 +26,10 @@
  */
 
 #include "ntru.h"
+#include "ntru_decrypt.h"
+#include "ntru_encrypt.h"
 #include "ntru_keypair.h"
+#include "ntru_rnd.h"
 
 #include <CUnit/Basic.h>
 #include <CUnit/Console.h>
@@ -34,6 +37,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 
@@ -86,6 +90,93 @@ void test_create_keypair2(void)
 	CU_ASSERT_EQUAL(false, ntru_create_keypair(&pair, f, g, &params));
 }
 
+/**
+ * Checks that a generated keypair has a private key of the
+ * expected weight and can decrypt what the public key encrypted.
+ *
+ * @param pair the generated keypair
+ * @param params the NTRU context used for generation
+ * @return true if the keypair is usable, false otherwise
+ */
+static bool
+check_generated_keypair(keypair *pair, ntru_params *params)
+{
+	fmpz_poly_t rnd;
+	string msg,
+		   *enc_string,
+		   *dec_string;
+	uint32_t ones = 0,
+			 neg_ones = 0;
+	bool retval;
+
+	for (uint32_t i = 0; i < params->N; i++) {
+		fmpz *coeff = fmpz_poly_get_coeff_ptr(pair->priv, i);
+
+		if (coeff && !fmpz_cmp_si(coeff, 1))
+			ones++;
+		else if (coeff && !fmpz_cmp_si(coeff, -1))
+			neg_ones++;
+	}
+
+	msg.ptr = "BLAHFASEL\n";
+	msg.len = strlen(msg.ptr);
+
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, params, 5, 5, NULL);
+
+	enc_string = ntru_encrypt_string(&msg, pair->pub, rnd, params);
+	dec_string = ntru_decrypt_string(enc_string, pair->priv,
+			pair->priv_inv, params);
+
+	retval = ones == params->N / 3 &&
+		neg_ones == params->N / 3 - 1 &&
+		dec_string->len == msg.len &&
+		!memcmp(dec_string->ptr, msg.ptr, msg.len);
+
+	string_delete(enc_string);
+	string_delete(dec_string);
+	fmpz_poly_clear(rnd);
+
+	return retval;
+}
+
+/**
+ * Test generating a keypair from scratch, sequentially.
+ */
+void test_generate_keypair1(void)
+{
+	keypair pair;
+	ntru_params params;
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 1,
+				NULL));
+	CU_ASSERT_EQUAL(true, check_generated_keypair(&pair, &params));
+
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test generating a keypair from scratch, with parallel
+ * candidate search.
+ */
+void test_generate_keypair2(void)
+{
+	keypair pair;
+	ntru_params params;
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair, &params, 4,
+				NULL));
+	CU_ASSERT_EQUAL(true, check_generated_keypair(&pair, &params));
+
+	ntru_delete_keypair(&pair);
+}
+
 /**
  * Test exporting public key and reading the resulting file.
  */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keypool_cunit.c
+ * Test cases for the pool of pre-generated keypairs.
+ * @brief tests for ntru_keypool.c
+ */
+
+#include "ntru.h"
+#include "ntru_keypair.h"
+#include "ntru_keypool.h"
+#include "ntru_rnd.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/**
+ * Test that the pool fills up in the background and
+ * that taking keypairs counts as hits.
+ */
+void test_keypool_take1(void)
+{
+	ntru_keypool *pool;
+	ntru_keypool_stats stats;
+	keypair pair;
+	struct timespec delay = { 0, 10000000 };
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	pool = ntru_keypool_new(&params, 2, 4, NULL);
+	CU_ASSERT_PTR_NOT_NULL(pool);
+
+	/* give the refill thread up to 10 seconds */
+	for (uint32_t i = 0; i < 1000; i++) {
+		ntru_keypool_get_stats(pool, &stats);
+		if (stats.available == 4)
+			break;
+		nanosleep(&delay, NULL);
+	}
+	CU_ASSERT_EQUAL(stats.available, 4);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		CU_ASSERT_EQUAL(true, ntru_keypool_take(pool, &pair));
+		ntru_delete_keypair(&pair);
+	}
+
+	ntru_keypool_get_stats(pool, &stats);
+	CU_ASSERT_EQUAL(stats.hits, 4);
+	CU_ASSERT(stats.generated >= 4);
+	CU_ASSERT(stats.refill_ns_total >= stats.refill_ns_max);
+
+	ntru_keypool_delete(pool);
+}
+
+/**
+ * Test error handling of invalid watermarks.
+ */
+void test_keypool_take2(void)
+{
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	CU_ASSERT_PTR_NULL(ntru_keypool_new(&params, 4, 2, NULL));
+	CU_ASSERT_PTR_NULL(ntru_keypool_new(&params, 0, 0, NULL));
+	CU_ASSERT_PTR_NULL(ntru_keypool_new(&params, 0, 4, NULL));
+}
+
+/**
+ * Test that failed key generations are counted and retried
+ * instead of stopping the refill thread.
+ */
+void test_keypool_take3(void)
+{
+	ntru_keypool *pool;
+	ntru_keypool_stats stats;
+	keypair pair;
+	struct timespec delay = { 0, 10000000 };
+	ntru_params params;
+	/* q is no power of 2, so f never has an inverse mod q */
+	params.N = 11;
+	params.p = 3;
+	params.q = 3;
+
+	pool = ntru_keypool_new(&params, 1, 1, NULL);
+	CU_ASSERT_PTR_NOT_NULL(pool);
+
+	for (uint32_t i = 0; i < 1000; i++) {
+		ntru_keypool_get_stats(pool, &stats);
+		if (stats.failures >= 2)
+			break;
+		nanosleep(&delay, NULL);
+	}
+	CU_ASSERT(stats.failures >= 2);
+	CU_ASSERT_EQUAL(stats.generated, 0);
+	CU_ASSERT_EQUAL(false, ntru_keypool_take(pool, &pair));
+
+	ntru_keypool_delete(pool);
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keyring_cunit.c
+ * Test cases for keyrings of public keys.
+ * @brief tests for ntru_keyring.c
+ */
+
+#include "ntru.h"
+#include "ntru_keypair.h"
+#include "ntru_keyring.h"
+#include "ntru_rnd.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/**
+ * Test adding and looking up keys in the unindexed tail.
+ */
+void test_keyring_add1(void)
+{
+	ntru_keyring *ring;
+	keypair pair[3];
+	uint64_t fp[3];
+	fmpz_poly_t pub;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(pub);
+
+	CU_ASSERT_EQUAL(true, ntru_keyring_create("keys.ring", &params));
+	ring = ntru_keyring_open("keys.ring");
+	CU_ASSERT_PTR_NOT_NULL(ring);
+
+	for (uint32_t i = 0; i < 3; i++) {
+		ntru_generate_keypair(&pair[i], &params, 1, NULL);
+		CU_ASSERT_EQUAL(true, ntru_keyring_add(ring, pair[i].pub, &fp[i]));
+		CU_ASSERT_EQUAL(fp[i], ntru_key_fingerprint(pair[i].pub, &params));
+	}
+	/* adding a key twice is a no-op */
+	ntru_keyring_add(ring, pair[0].pub, NULL);
+	CU_ASSERT_EQUAL(ntru_keyring_count(ring), 3);
+
+	for (uint32_t i = 0; i < 3; i++) {
+		CU_ASSERT_EQUAL(true, ntru_keyring_get_public_key(pub, ring,
+					fp[i]));
+		CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair[i].pub));
+		ntru_delete_keypair(&pair[i]);
+	}
+	CU_ASSERT_PTR_NULL(ntru_keyring_lookup(ring, fp[0] ^ 1));
+
+	ntru_keyring_close(ring);
+	remove("keys.ring");
+
+	CU_ASSERT_PTR_NULL(ntru_keyring_open("to-encrypt.txt"));
+}
+
+/**
+ * Test that a key is refused if a different key with the
+ * same fingerprint is in the keyring.
+ */
+void test_keyring_add2(void)
+{
+	ntru_keyring *ring;
+	keypair pair;
+	uint64_t fp;
+	FILE *file;
+	long size;
+	int c;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	ntru_keyring_create("keys.ring", &params);
+	ring = ntru_keyring_open("keys.ring");
+	ntru_generate_keypair(&pair, &params, 1, NULL);
+	CU_ASSERT_EQUAL(true, ntru_keyring_add(ring, pair.pub, &fp));
+	ntru_keyring_close(ring);
+
+	/* change the first coefficient of the only record, which
+	 * is 64 bytes long and the last thing in the file, but
+	 * keep its fingerprint */
+	file = fopen("keys.ring", "r+b");
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, size - 64 + 8, SEEK_SET);
+	c = fgetc(file);
+	fseek(file, size - 64 + 8, SEEK_SET);
+	fputc(c ^ 1, file);
+	fclose(file);
+
+	ring = ntru_keyring_open("keys.ring");
+	CU_ASSERT_PTR_NOT_NULL(ntru_keyring_lookup(ring, fp));
+	CU_ASSERT_EQUAL(false, ntru_keyring_add(ring, pair.pub, NULL));
+	CU_ASSERT_EQUAL(ntru_keyring_count(ring), 1);
+
+	ntru_keyring_close(ring);
+	ntru_delete_keypair(&pair);
+	remove("keys.ring");
+}
+
+/**
+ * Test that adding to a keyring whose last append was torn
+ * drops the partial record instead of misaligning the new one.
+ */
+void test_keyring_add3(void)
+{
+	ntru_keyring *ring;
+	keypair pair[2];
+	uint64_t fp[2];
+	fmpz_poly_t pub;
+	FILE *file;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(pub);
+
+	ntru_keyring_create("keys.ring", &params);
+	ring = ntru_keyring_open("keys.ring");
+	ntru_generate_keypair(&pair[0], &params, 1, NULL);
+	ntru_keyring_add(ring, pair[0].pub, &fp[0]);
+	ntru_keyring_close(ring);
+
+	file = fopen("keys.ring", "ab");
+	fwrite("torn!", 1, 5, file);
+	fclose(file);
+
+	ring = ntru_keyring_open("keys.ring");
+	CU_ASSERT_PTR_NOT_NULL(ring);
+	CU_ASSERT_EQUAL(ntru_keyring_count(ring), 1);
+	ntru_generate_keypair(&pair[1], &params, 1, NULL);
+	CU_ASSERT_EQUAL(true, ntru_keyring_add(ring, pair[1].pub, &fp[1]));
+	CU_ASSERT_EQUAL(ntru_keyring_count(ring), 2);
+	ntru_keyring_close(ring);
+
+	ring = ntru_keyring_open("keys.ring");
+	for (uint32_t i = 0; i < 2; i++) {
+		CU_ASSERT_EQUAL(true, ntru_keyring_get_public_key(pub, ring,
+					fp[i]));
+		CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair[i].pub));
+		ntru_delete_keypair(&pair[i]);
+	}
+
+	ntru_keyring_close(ring);
+	fmpz_poly_clear(pub);
+	remove("keys.ring");
+}
+
+/**
+ * Test that keys are still found through the hash index
+ * after compaction and after reopening the keyring.
+ */
+void test_keyring_compact1(void)
+{
+	ntru_keyring *ring;
+	keypair pair[20];
+	uint64_t fp[20];
+	fmpz_poly_t pub;
+	ntru_params params,
+				ring_params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(pub);
+
+	ntru_keyring_create("keys.ring", &params);
+	ring = ntru_keyring_open("keys.ring");
+
+	for (uint32_t i = 0; i < 19; i++) {
+		ntru_generate_keypair(&pair[i], &params, 1, NULL);
+		ntru_keyring_add(ring, pair[i].pub, &fp[i]);
+	}
+	CU_ASSERT_EQUAL(true, ntru_keyring_compact(ring));
+	ntru_keyring_close(ring);
+
+	ring = ntru_keyring_open("keys.ring");
+	CU_ASSERT_PTR_NOT_NULL(ring);
+
+	/* appended after compaction */
+	ntru_generate_keypair(&pair[19], &params, 1, NULL);
+	ntru_keyring_add(ring, pair[19].pub, &fp[19]);
+
+	ntru_keyring_get_params(ring, &ring_params);
+	CU_ASSERT_EQUAL(ring_params.N, params.N);
+	CU_ASSERT_EQUAL(ring_params.q, params.q);
+	CU_ASSERT_EQUAL(ring_params.p, params.p);
+
+	for (uint32_t i = 0; i < 20; i++) {
+		CU_ASSERT_EQUAL(true, ntru_keyring_get_public_key(pub, ring,
+					fp[i]));
+		CU_ASSERT_EQUAL(1, fmpz_poly_equal(pub, pair[i].pub));
+		ntru_delete_keypair(&pair[i]);
+	}
+
+	ntru_keyring_close(ring);
+	remove("keys.ring");
+}
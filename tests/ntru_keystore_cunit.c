@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_keystore_cunit.c
+ * Test cases for shared read-only key stores.
+ * @brief tests for ntru_keystore.c
+ */
+
+#include "ntru.h"
+#include "ntru_decrypt.h"
+#include "ntru_encrypt.h"
+#include "ntru_keypair.h"
+#include "ntru_keystore.h"
+#include "ntru_rnd.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/**
+ * Builds a store with two keypairs and one public key.
+ */
+static ntru_keystore_builder *build_store(keypair *pair,
+		const ntru_params *params)
+{
+	ntru_keystore_builder *builder = ntru_keystore_builder_new(params);
+
+	ntru_generate_keypair(&pair[0], params, 1, NULL);
+	ntru_generate_keypair(&pair[1], params, 1, NULL);
+
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_add_keypair(builder,
+				"alice", &pair[0]));
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_add_public_key(builder,
+				"bob", pair[1].pub));
+	CU_ASSERT_EQUAL(false, ntru_keystore_builder_add_keypair(builder,
+				"alice", &pair[1]));
+
+	return builder;
+}
+
+/**
+ * Checks the keys of a store built by build_store().
+ */
+static void check_store(ntru_keystore *store,
+		const keypair *pair)
+{
+	ntru_key_handle handle;
+	fmpz_poly_t poly;
+
+	fmpz_poly_init(poly);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+	CU_ASSERT_EQUAL(ntru_keystore_count(store), 2);
+
+	CU_ASSERT_EQUAL(true, ntru_keystore_get(store, "alice", &handle));
+	ntru_key_handle_get_poly(poly, handle.pub, &handle);
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(poly, pair[0].pub));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(handle.priv);
+	ntru_key_handle_get_poly(poly, handle.priv, &handle);
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(poly, pair[0].priv));
+
+	CU_ASSERT_EQUAL(true, ntru_keystore_get(store, "bob", &handle));
+	ntru_key_handle_get_poly(poly, handle.pub, &handle);
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(poly, pair[1].pub));
+	CU_ASSERT_PTR_NULL(handle.priv);
+
+	CU_ASSERT_EQUAL(false, ntru_keystore_get(store, "eve", &handle));
+
+	fmpz_poly_clear(poly);
+}
+
+/**
+ * Test a key store in a file, replaced while attached.
+ */
+void test_keystore_file1(void)
+{
+	ntru_keystore_builder *builder;
+	ntru_keystore *store;
+	keypair pair[2];
+	struct stat s;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	builder = build_store(pair, &params);
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_write_file(builder,
+				"keys.store"));
+	ntru_keystore_builder_delete(builder);
+
+	/* it holds private keys */
+	CU_ASSERT_EQUAL(0, stat("keys.store", &s));
+	CU_ASSERT_EQUAL(0600, s.st_mode & 0777);
+
+	store = ntru_keystore_attach_file("keys.store");
+
+	/* replace it with an empty one */
+	builder = ntru_keystore_builder_new(&params);
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_write_file(builder,
+				"keys.store"));
+	ntru_keystore_builder_delete(builder);
+
+	check_store(store, pair);
+	ntru_keystore_detach(store);
+
+	store = ntru_keystore_attach_file("keys.store");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+	CU_ASSERT_EQUAL(0, ntru_keystore_count(store));
+	ntru_keystore_detach(store);
+
+	remove("keys.store");
+	CU_ASSERT_PTR_NULL(ntru_keystore_attach_file("to-encrypt.txt"));
+
+	ntru_delete_keypair(&pair[0]);
+	ntru_delete_keypair(&pair[1]);
+}
+
+/**
+ * Test a key store in shared memory, attached twice and
+ * replaced while attached.
+ */
+void test_keystore_shm1(void)
+{
+	ntru_keystore_builder *builder;
+	ntru_keystore *store1,
+				  *store2,
+				  *store3;
+	char shm_name[64];
+	keypair pair[2];
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	sprintf(shm_name, "/ntru-cunit-%ld", (long)getpid());
+
+	builder = build_store(pair, &params);
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_write_shm(builder,
+				shm_name));
+	ntru_keystore_builder_delete(builder);
+
+	store1 = ntru_keystore_attach_shm(shm_name);
+	store2 = ntru_keystore_attach_shm(shm_name);
+
+	/* replace it with an empty one */
+	builder = ntru_keystore_builder_new(&params);
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_write_shm(builder,
+				shm_name));
+	ntru_keystore_builder_delete(builder);
+	store3 = ntru_keystore_attach_shm(shm_name);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(store3);
+	CU_ASSERT_EQUAL(0, ntru_keystore_count(store3));
+	ntru_keystore_detach(store3);
+
+	CU_ASSERT_EQUAL(true, ntru_keystore_unlink_shm(shm_name));
+
+	/* still attached after replacing and unlinking */
+	check_store(store1, pair);
+	check_store(store2, pair);
+	ntru_keystore_detach(store1);
+	ntru_keystore_detach(store2);
+
+	CU_ASSERT_PTR_NULL(ntru_keystore_attach_shm(shm_name));
+
+	ntru_delete_keypair(&pair[0]);
+	ntru_delete_keypair(&pair[1]);
+}
+
+/**
+ * Test encrypting and decrypting with the mapped keys of
+ * a handle, which must give the same as with polynomials.
+ */
+void test_keystore_crypt1(void)
+{
+	ntru_keystore_builder *builder;
+	ntru_keystore *store;
+	ntru_key_handle handle;
+	keypair pair[2];
+	fmpz_poly_t rnd;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"mapped", 6);
+	char msg_c[] = "zero-copy keys straight from the mapping";
+	char enc_c[1024],
+		 enc_poly_c[1024],
+		 dec_c[1024];
+	string msg,
+		   enc;
+	ntru_params params;
+	params.N = 107;
+	params.p = 3;
+	params.q = 256;
+
+	msg.ptr = msg_c;
+	msg.len = strlen(msg_c);
+	fmpz_poly_init(rnd);
+	ntru_get_rnd_tern_poly_num(rnd, &params, 35, 35, rng);
+
+	builder = build_store(pair, &params);
+	CU_ASSERT_EQUAL(true, ntru_keystore_builder_write_file(builder,
+				"keys.store"));
+	ntru_keystore_builder_delete(builder);
+	store = ntru_keystore_attach_file("keys.store");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(store);
+	CU_ASSERT_EQUAL(true, ntru_keystore_get(store, "alice", &handle));
+
+	enc.ptr = enc_c;
+	enc.len = ntru_encrypt_string_into_mapped(&msg, handle.pub, rnd,
+			&handle.params, enc_c, sizeof(enc_c));
+	CU_ASSERT(enc.len > 0);
+	CU_ASSERT_EQUAL(enc.len, ntru_encrypt_string_into(&msg, pair[0].pub,
+				rnd, &params, enc_poly_c, sizeof(enc_poly_c)));
+	CU_ASSERT_EQUAL(0, memcmp(enc_c, enc_poly_c, enc.len));
+
+	CU_ASSERT_EQUAL(msg.len, ntru_decrypt_string_into_mapped(&enc,
+				handle.priv, handle.priv_inv, &handle.params, dec_c,
+				sizeof(dec_c)));
+	CU_ASSERT_EQUAL(0, memcmp(msg_c, dec_c, msg.len));
+
+	ntru_keystore_detach(store);
+	remove("keys.store");
+
+	fmpz_poly_clear(rnd);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair[0]);
+	ntru_delete_keypair(&pair[1]);
+}
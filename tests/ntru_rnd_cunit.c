@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_rnd_cunit.c
+ * Test cases for the random number generation.
+ * @brief tests for ntru_rnd.c
+ */
+
+#include "ntru.h"
+#include "ntru_keypair.h"
+#include "ntru_rnd.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+/**
+ * Check that a polynomial is ternary with exactly
+ * the given numbers of 1 and -1 coefficients.
+ *
+ * @param poly the polynomial
+ * @param params the NTRU context
+ * @param num_ones the expected number of 1 coefficients
+ * @param num_neg_ones the expected number of -1 coefficients
+ * @return true if it matches, false otherwise
+ */
+static bool
+check_tern_poly(fmpz_poly_t poly,
+		ntru_params *params,
+		uint32_t num_ones,
+		uint32_t num_neg_ones)
+{
+	uint32_t ones = 0,
+			 neg_ones = 0;
+
+	if (fmpz_poly_length(poly) > params->N)
+		return false;
+
+	for (uint32_t i = 0; i < params->N; i++) {
+		long coeff = fmpz_poly_get_coeff_si(poly, i);
+
+		if (coeff == 1)
+			ones++;
+		else if (coeff == -1)
+			neg_ones++;
+		else if (coeff != 0)
+			return false;
+	}
+
+	return ones == num_ones && neg_ones == num_neg_ones;
+}
+
+/**
+ * Test that bulk random bytes are not repeated, also
+ * across a reseed.
+ */
+void test_rnd_bytes1(void)
+{
+	uint8_t *buf = malloc(NTRU_RND_RESEED_INTERVAL + 64);
+	uint8_t zero[64] = { 0 };
+
+	ntru_rnd_bytes(buf, NTRU_RND_RESEED_INTERVAL + 64);
+
+	CU_ASSERT_NOT_EQUAL(0, memcmp(buf, buf + 64, 64));
+	CU_ASSERT_NOT_EQUAL(0, memcmp(buf + NTRU_RND_RESEED_INTERVAL, zero,
+				64));
+	CU_ASSERT_NOT_EQUAL(0, memcmp(buf, buf + NTRU_RND_RESEED_INTERVAL,
+				64));
+
+	free(buf);
+}
+
+/**
+ * Test that parent and child draw different
+ * bytes after fork().
+ */
+void test_rnd_fork1(void)
+{
+	uint8_t parent[32],
+			child[32];
+	int fds[2];
+	pid_t pid;
+
+	/* make sure the DRBG is seeded before forking */
+	get_urnd_int();
+
+	CU_ASSERT_EQUAL(0, pipe(fds));
+
+	if ((pid = fork()) == 0) {
+		ntru_rnd_bytes(child, sizeof(child));
+		if (write(fds[1], child, sizeof(child)) != sizeof(child))
+			_exit(1);
+		_exit(0);
+	}
+
+	ntru_rnd_bytes(parent, sizeof(parent));
+	CU_ASSERT_EQUAL(sizeof(child), read(fds[0], child, sizeof(child)));
+	waitpid(pid, NULL, 0);
+	close(fds[0]);
+	close(fds[1]);
+
+	CU_ASSERT_NOT_EQUAL(0, memcmp(parent, child, sizeof(parent)));
+}
+
+/**
+ * Test that parent and child draw different bytes from
+ * a shared kernel-seeded rng after fork().
+ */
+void test_rng_fork1(void)
+{
+	ntru_rng *rng = ntru_rng_new();
+	uint8_t parent[32],
+			child[32];
+	int fds[2];
+	pid_t pid;
+
+	/* the DRBG is seeded before forking */
+	ntru_rng_uint32(rng);
+
+	CU_ASSERT_EQUAL(0, pipe(fds));
+
+	if ((pid = fork()) == 0) {
+		ntru_rng_bytes(rng, child, sizeof(child));
+		if (write(fds[1], child, sizeof(child)) != sizeof(child))
+			_exit(1);
+		_exit(0);
+	}
+
+	ntru_rng_bytes(rng, parent, sizeof(parent));
+	CU_ASSERT_EQUAL(sizeof(child), read(fds[0], child, sizeof(child)));
+	waitpid(pid, NULL, 0);
+	close(fds[0]);
+	close(fds[1]);
+
+	CU_ASSERT_NOT_EQUAL(0, memcmp(parent, child, sizeof(parent)));
+
+	ntru_rng_delete(rng);
+}
+
+/**
+ * Test the fixed-weight ternary sampler, including
+ * the corner cases of no and only non-zero coefficients.
+ */
+void test_rnd_tern_poly1(void)
+{
+	fmpz_poly_t poly;
+	ntru_params params;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(poly);
+
+	for (uint32_t i = 0; i < 100; i++) {
+		ntru_get_rnd_tern_poly_num(poly, &params, 4, 3, NULL);
+		CU_ASSERT_EQUAL(true, check_tern_poly(poly, &params, 4, 3));
+	}
+
+	ntru_get_rnd_tern_poly_num(poly, &params, 0, 0, NULL);
+	CU_ASSERT_EQUAL(true, check_tern_poly(poly, &params, 0, 0));
+
+	ntru_get_rnd_tern_poly_num(poly, &params, 6, 5, NULL);
+	CU_ASSERT_EQUAL(true, check_tern_poly(poly, &params, 6, 5));
+
+	fmpz_poly_clear(poly);
+}
+
+/**
+ * Test that the batch sampler fills every polynomial
+ * and that they are not all the same.
+ */
+void test_rnd_tern_poly_batch1(void)
+{
+	fmpz_poly_t polys[16];
+	ntru_params params;
+	bool all_equal = true;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	for (uint32_t i = 0; i < 16; i++)
+		fmpz_poly_init(polys[i]);
+
+	ntru_get_rnd_tern_poly_batch(polys, 16, &params, 4, 3, NULL);
+
+	for (uint32_t i = 0; i < 16; i++) {
+		CU_ASSERT_EQUAL(true, check_tern_poly(polys[i], &params, 4, 3));
+		if (!fmpz_poly_equal(polys[i], polys[0]))
+			all_equal = false;
+	}
+	CU_ASSERT_EQUAL(false, all_equal);
+
+	for (uint32_t i = 0; i < 16; i++)
+		fmpz_poly_clear(polys[i]);
+}
+
+/**
+ * Test that rngs with the same seed reproduce the
+ * same keypair and the same random polynomials.
+ */
+void test_rng_seeded1(void)
+{
+	keypair pair1,
+			pair2,
+			pair3;
+	fmpz_poly_t poly1,
+				poly2;
+	ntru_rng *rng1 = ntru_rng_new_seeded((const uint8_t *)"bench", 5),
+			 *rng2 = ntru_rng_new_seeded((const uint8_t *)"bench", 5),
+			 *rng3 = ntru_rng_new_seeded((const uint8_t *)"bench2", 6);
+	ntru_params params;
+
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	CU_ASSERT_PTR_NULL(ntru_rng_new_seeded(
+				(const uint8_t *)"0123456789abcdef0123456789abcdefX", 33));
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair1, &params, 1, rng1));
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair2, &params, 1, rng2));
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(&pair3, &params, 1, rng3));
+
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pair1.priv, pair2.priv));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pair1.pub, pair2.pub));
+	CU_ASSERT_EQUAL(0, fmpz_poly_equal(pair1.pub, pair3.pub));
+
+	fmpz_poly_init(poly1);
+	fmpz_poly_init(poly2);
+	ntru_get_rnd_tern_poly_num(poly1, &params, 4, 3, rng1);
+	ntru_get_rnd_tern_poly_num(poly2, &params, 4, 3, rng2);
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(poly1, poly2));
+	CU_ASSERT_EQUAL(ntru_rng_uint32(rng1), ntru_rng_uint32(rng2));
+
+	fmpz_poly_clear(poly1);
+	fmpz_poly_clear(poly2);
+	ntru_delete_keypair(&pair1);
+	ntru_delete_keypair(&pair2);
+	ntru_delete_keypair(&pair3);
+	ntru_rng_delete(rng1);
+	ntru_rng_delete(rng2);
+	ntru_rng_delete(rng3);
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_seedkey_cunit.c
+ * Test cases for seed-compressed private keys.
+ * @brief tests for ntru_seedkey.c
+ */
+
+#include "ntru.h"
+#include "ntru_keypair.h"
+#include "ntru_rnd.h"
+#include "ntru_seedkey.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/**
+ * Test that expanding a generated seed yields the same keys.
+ */
+void test_seed_key_expand1(void)
+{
+	keypair pair,
+			expanded;
+	uint8_t seed[NTRU_SEED_LEN];
+	fmpz_poly_t priv, priv_inv;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+
+	CU_ASSERT_EQUAL(true, ntru_generate_seed_key(seed, &pair, &params,
+				NULL));
+	CU_ASSERT_EQUAL(true, ntru_expand_seed_keypair(&expanded, seed,
+				&params));
+	CU_ASSERT_EQUAL(true, ntru_expand_seed_priv(priv, priv_inv, seed,
+				&params));
+
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pair.pub, expanded.pub));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pair.priv, priv));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(pair.priv_inv, priv_inv));
+
+	ntru_delete_keypair(&pair);
+	ntru_delete_keypair(&expanded);
+	fmpz_poly_clear(priv);
+	fmpz_poly_clear(priv_inv);
+}
+
+/**
+ * Test exporting and importing a seed, which is bound
+ * to the format version and the parameters.
+ */
+void test_seed_key_export1(void)
+{
+	uint8_t seed[NTRU_SEED_LEN],
+			imported[NTRU_SEED_LEN];
+	ntru_params params,
+				other;
+	string *file,
+		   bare;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+	other = params;
+	other.q = 64;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_seed_key(seed, NULL, &params,
+				NULL));
+	CU_ASSERT_EQUAL(true, export_seed_key("seed.key", seed, &params));
+	CU_ASSERT_EQUAL(true, import_seed_key(imported, "seed.key", &params));
+	CU_ASSERT_EQUAL(0, memcmp(seed, imported, NTRU_SEED_LEN));
+
+	CU_ASSERT_EQUAL(false, import_seed_key(imported, "seed.key", &other));
+	CU_ASSERT_EQUAL(false, import_seed_key(imported, "to-encrypt.txt",
+				&params));
+
+	file = read_file("seed.key");
+	CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+	/* unknown version */
+	file->ptr[8]++;
+	CU_ASSERT_EQUAL(true, write_file(file, "seed.key"));
+	CU_ASSERT_EQUAL(false, import_seed_key(imported, "seed.key", &params));
+
+	string_delete(file);
+
+	/* a bare seed without header */
+	bare.ptr = (char *)seed;
+	bare.len = NTRU_SEED_LEN;
+	CU_ASSERT_EQUAL(true, write_file(&bare, "seed.key"));
+	CU_ASSERT_EQUAL(false, import_seed_key(imported, "seed.key", &params));
+
+	remove("seed.key");
+}
+
+/**
+ * Test hits, misses and eviction of the seed cache.
+ */
+void test_seed_cache1(void)
+{
+	ntru_seed_cache *cache;
+	ntru_cache_stats stats;
+	uint8_t seed1[NTRU_SEED_LEN],
+			seed2[NTRU_SEED_LEN];
+	fmpz_poly_t priv, priv_inv, priv_cached, priv_inv_cached;
+	ntru_params params;
+	params.N = 11;
+	params.p = 3;
+	params.q = 32;
+
+	fmpz_poly_init(priv);
+	fmpz_poly_init(priv_inv);
+	fmpz_poly_init(priv_cached);
+	fmpz_poly_init(priv_inv_cached);
+
+	ntru_generate_seed_key(seed1, NULL, &params, NULL);
+	ntru_generate_seed_key(seed2, NULL, &params, NULL);
+
+	cache = ntru_seed_cache_new(1);
+
+	CU_ASSERT_EQUAL(true, ntru_seed_cache_get_priv(cache, priv, priv_inv,
+				seed1, &params));
+	CU_ASSERT_EQUAL(true, ntru_seed_cache_get_priv(cache, priv_cached,
+				priv_inv_cached, seed1, &params));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv, priv_cached));
+	CU_ASSERT_EQUAL(1, fmpz_poly_equal(priv_inv, priv_inv_cached));
+
+	/* pushes seed1 out */
+	ntru_seed_cache_get_priv(cache, priv, priv_inv, seed2, &params);
+
+	ntru_seed_cache_get_stats(cache, &stats);
+	CU_ASSERT_EQUAL(stats.hits, 1);
+	CU_ASSERT_EQUAL(stats.misses, 2);
+	CU_ASSERT_EQUAL(stats.evictions, 1);
+	CU_ASSERT_EQUAL(stats.entries, 1);
+
+	ntru_seed_cache_delete(cache);
+	fmpz_poly_clear(priv);
+	fmpz_poly_clear(priv_inv);
+	fmpz_poly_clear(priv_cached);
+	fmpz_poly_clear(priv_inv_cached);
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_stream_cunit.c
+ * Test cases for encrypting and decrypting in pieces.
+ * @brief tests for ntru_stream.c
+ */
+
+#include "ntru.h"
+#include "ntru_compress.h"
+#include "ntru_keypair.h"
+#include "ntru_rnd.h"
+#include "ntru_stream.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+/**
+ * Appends a piece of output to a buffer and frees it.
+ *
+ * @param buf the buffer
+ * @param len the number of bytes in buf [in, out]
+ * @param max the size of buf
+ * @param piece the output, NULL counts as failure
+ */
+static void
+append_piece(char *buf, size_t *len, size_t max, string *piece)
+{
+	CU_ASSERT_PTR_NOT_NULL_FATAL(piece);
+	CU_ASSERT(piece->len <= max - *len);
+	if (piece->len <= max - *len) {
+		memcpy(buf + *len, piece->ptr, piece->len);
+		*len += piece->len;
+	}
+	string_delete(piece);
+}
+
+/**
+ * Sets up a keypair.
+ *
+ * @param pair the keypair [out]
+ * @param params the parameters [out]
+ * @param N the degree, 107 decrypts reliably
+ */
+static void
+stream_setup(keypair *pair, ntru_params *params, uint32_t N)
+{
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"stream", 6);
+
+	params->N = N;
+	params->p = 3;
+	params->q = 256;
+
+	CU_ASSERT_EQUAL(true, ntru_generate_keypair(pair, params, 1, rng));
+	ntru_rng_delete(rng);
+}
+
+/**
+ * Test encrypting and decrypting a message of several
+ * chunks in pieces of odd sizes.
+ */
+void test_stream1(void)
+{
+	keypair pair;
+	ntru_params params;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"enc", 3);
+	ntru_encrypt_ctx *enc_ctx;
+	ntru_decrypt_ctx *dec_ctx;
+	const size_t msg_max = 3 * 512 * 1024,
+		  enc_max = 8 * msg_max;
+	char *msg_c = malloc(msg_max),
+		 *enc_c = malloc(enc_max),
+		 *dec_c = malloc(msg_max);
+	size_t msg_len = 0,
+		   enc_len = 0,
+		   dec_len = 0;
+	string piece;
+
+	stream_setup(&pair, &params, 107);
+
+	for (uint32_t i = 0; msg_len < msg_max - 64; i++)
+		msg_len += sprintf(msg_c + msg_len, "streamed line %u\n", i);
+
+	enc_ctx = ntru_encrypt_init(pair.pub, &params, rng);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(enc_ctx);
+	for (size_t off = 0; off < msg_len; off += piece.len) {
+		piece.ptr = msg_c + off;
+		piece.len = (msg_len - off > 100003) ? 100003 : msg_len - off;
+		append_piece(enc_c, &enc_len, enc_max,
+				ntru_encrypt_update(enc_ctx, &piece));
+	}
+	append_piece(enc_c, &enc_len, enc_max, ntru_encrypt_final(enc_ctx));
+	CU_ASSERT_EQUAL(0, enc_len % 4);
+
+	dec_ctx = ntru_decrypt_init(pair.priv, pair.priv_inv, &params);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec_ctx);
+	for (size_t off = 0; off < enc_len; off += piece.len) {
+		piece.ptr = enc_c + off;
+		piece.len = (enc_len - off > 777) ? 777 : enc_len - off;
+		append_piece(dec_c, &dec_len, msg_max,
+				ntru_decrypt_update(dec_ctx, &piece));
+	}
+	append_piece(dec_c, &dec_len, msg_max, ntru_decrypt_final(dec_ctx));
+
+	CU_ASSERT_EQUAL(msg_len, dec_len);
+	CU_ASSERT_EQUAL(0, memcmp(msg_c, dec_c, msg_len));
+
+	free(msg_c);
+	free(enc_c);
+	free(dec_c);
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test that truncated and extended ciphertexts are rejected.
+ */
+void test_stream2(void)
+{
+	keypair pair;
+	ntru_params params;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"enc", 3);
+	ntru_encrypt_ctx *enc_ctx;
+	ntru_decrypt_ctx *dec_ctx;
+	char msg_c[] = "a short message";
+	char enc_c[4096];
+	size_t enc_len = 0;
+	string msg,
+		   piece,
+		   *dec;
+
+	stream_setup(&pair, &params, 107);
+	msg.ptr = msg_c;
+	msg.len = strlen(msg_c);
+
+	enc_ctx = ntru_encrypt_init(pair.pub, &params, rng);
+	append_piece(enc_c, &enc_len, sizeof(enc_c) - 4,
+			ntru_encrypt_update(enc_ctx, &msg));
+	append_piece(enc_c, &enc_len, sizeof(enc_c) - 4,
+			ntru_encrypt_final(enc_ctx));
+
+	/* the message is complete, but not the stream */
+	dec_ctx = ntru_decrypt_init(pair.priv, pair.priv_inv, &params);
+	piece.ptr = enc_c;
+	piece.len = enc_len - 8;
+	dec = ntru_decrypt_update(dec_ctx, &piece);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	CU_ASSERT_EQUAL(msg.len, dec->len);
+	CU_ASSERT_EQUAL(0, memcmp(msg.ptr, dec->ptr, msg.len));
+	string_delete(dec);
+	CU_ASSERT_PTR_NULL(ntru_decrypt_final(dec_ctx));
+
+	/* nothing may follow the end */
+	memcpy(enc_c + enc_len, "AAAA", 4);
+	dec_ctx = ntru_decrypt_init(pair.priv, pair.priv_inv, &params);
+	piece.len = enc_len + 4;
+	dec = ntru_decrypt_update(dec_ctx, &piece);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dec);
+	string_delete(dec);
+	CU_ASSERT_PTR_NULL(ntru_decrypt_final(dec_ctx));
+
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
+
+/**
+ * Test that blocks with the same plaintext get different
+ * ciphertexts, as every block has its own random poly.
+ */
+void test_stream3(void)
+{
+	keypair pair;
+	ntru_params params;
+	ntru_rng *rng = ntru_rng_new_seeded((const uint8_t *)"blocks", 6);
+	ntru_compress_policy none = { NTRU_COMPRESS_NONE, 0, 0 };
+	ntru_encrypt_ctx *enc_ctx;
+	char msg_c[1000];
+	string msg,
+		   *enc;
+
+	/* with N a multiple of 3, every block is 4 * N / 3 characters */
+	stream_setup(&pair, &params, 111);
+	memset(msg_c, 0xff, sizeof(msg_c));
+	msg.ptr = msg_c;
+	msg.len = sizeof(msg_c);
+
+	/* stored, so all blocks but the first are just 1 bits */
+	CU_ASSERT_EQUAL(true, ntru_set_compress_policy(&none));
+	enc_ctx = ntru_encrypt_init(pair.pub, &params, rng);
+	string_delete(ntru_encrypt_update(enc_ctx, &msg));
+	enc = ntru_encrypt_final(enc_ctx);
+	CU_ASSERT_EQUAL(true, ntru_set_compress_policy(NULL));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(enc);
+	CU_ASSERT(enc->len >= 3 * 148);
+	CU_ASSERT_NOT_EQUAL(0, memcmp(enc->ptr + 148, enc->ptr + 2 * 148, 148));
+	string_delete(enc);
+
+	ntru_rng_delete(rng);
+	ntru_delete_keypair(&pair);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 FH Bielefeld
+ *
+ * This file is part of a FH Bielefeld project.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA  02110-1301  USA
+ */
+
+/**
+ * @file ntru_threadpool_cunit.c
+ * Test cases for the thread pool.
+ * @brief tests for ntru_threadpool.c
+ */
+
+#include "ntru_threadpool.h"
+
+#include <CUnit/Basic.h>
+#include <CUnit/Console.h>
+#include <CUnit/Automated.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/**
+ * Body of the parallel_for test, squares every element.
+ */
+static void square(size_t i, void *arg)
+{
+	uint64_t *values = arg;
+
+	values[i] = (uint64_t)i * i;
+}
+
+/**
+ * Test that parallel_for runs every iteration exactly once,
+ * with and without a pool.
+ */
+void test_thread_pool_parallel_for1(void)
+{
+	ntru_thread_pool *pool;
+	uint64_t values[1000];
+	bool ok = true;
+
+	pool = ntru_thread_pool_new(4);
+	CU_ASSERT_PTR_NOT_NULL(pool);
+	CU_ASSERT_EQUAL(ntru_thread_pool_size(pool), 4);
+
+	for (uint32_t round = 0; round < 2; round++) {
+		for (uint32_t i = 0; i < 1000; i++)
+			values[i] = 0;
+
+		ntru_thread_pool_parallel_for(round ? NULL : pool, 1000, square,
+				values);
+
+		for (uint32_t i = 0; i < 1000; i++)
+			ok = ok && values[i] == (uint64_t)i * i;
+	}
+	CU_ASSERT_EQUAL(true, ok);
+
+	ntru_thread_pool_delete(pool);
+}